@@ -0,0 +1,524 @@
+#include "file_access_patchwork_memory.h"
+
+Mutex FileAccessPatchworkMemory::files_mutex;
+HashMap<String, Vector<uint8_t>> *FileAccessPatchworkMemory::files = nullptr;
+HashSet<String> *FileAccessPatchworkMemory::dirs = nullptr;
+SafeFlag FileAccessPatchworkMemory::active;
+FileAccess::CreateFunc FileAccessPatchworkMemory::platform_create_func = nullptr;
+DirAccess::CreateFunc DirAccessPatchworkMemory::platform_create_func = nullptr;
+
+void FileAccessPatchworkMemory::initialize() {
+	MutexLock lock(files_mutex);
+	if (files) {
+		return;
+	}
+	files = memnew((HashMap<String, Vector<uint8_t>>));
+	dirs = memnew(HashSet<String>);
+	// Swapping create funcs races with threads creating file accesses, so they're only set here and in finalize(),
+	// while no loader threads are running.
+	platform_create_func = FileAccess::get_create_func(ACCESS_FILESYSTEM);
+	FileAccess::make_default<FileAccessPatchworkMemory>(ACCESS_FILESYSTEM);
+	DirAccessPatchworkMemory::_install();
+}
+
+void FileAccessPatchworkMemory::finalize() {
+	MutexLock lock(files_mutex);
+	active.clear();
+	if (!files) {
+		return;
+	}
+	FileAccess::create_func[ACCESS_FILESYSTEM] = platform_create_func;
+	DirAccessPatchworkMemory::_restore();
+	memdelete(files);
+	files = nullptr;
+	memdelete(dirs);
+	dirs = nullptr;
+}
+
+bool FileAccessPatchworkMemory::_is_routed(const String &p_path) {
+	return active.is_set() && is_memory_path(p_path);
+}
+
+bool FileAccessPatchworkMemory::is_memory_path(const String &p_path) {
+	return p_path.begins_with(SCHEME);
+}
+
+void FileAccessPatchworkMemory::register_file(const String &p_path, const Vector<uint8_t> &p_data) {
+	ERR_FAIL_COND_MSG(!is_memory_path(p_path), vformat("Not a memory path: '%s'.", p_path));
+	MutexLock lock(files_mutex);
+	ERR_FAIL_NULL(files);
+	(*files)[p_path.simplify_path()] = p_data;
+	active.set();
+}
+
+void FileAccessPatchworkMemory::remove_files(const String &p_prefix) {
+	ERR_FAIL_COND_MSG(!is_memory_path(p_prefix), vformat("Not a memory path: '%s'.", p_prefix));
+	String prefix = p_prefix.simplify_path();
+	MutexLock lock(files_mutex);
+	if (!files) {
+		return;
+	}
+	Vector<String> to_remove;
+	for (const KeyValue<String, Vector<uint8_t>> &E : *files) {
+		if (E.key.begins_with(prefix)) {
+			to_remove.push_back(E.key);
+		}
+	}
+	for (const String &path : to_remove) {
+		files->erase(path);
+	}
+	to_remove.clear();
+	for (const String &dir : *dirs) {
+		if (dir.begins_with(prefix)) {
+			to_remove.push_back(dir);
+		}
+	}
+	for (const String &dir : to_remove) {
+		dirs->erase(dir);
+	}
+	if (files->is_empty() && dirs->is_empty()) {
+		active.clear();
+	}
+}
+
+// Called with files_mutex held.
+bool FileAccessPatchworkMemory::_dir_exists(const String &p_dir) {
+	if (!files) {
+		return false;
+	}
+	if (dirs->has(p_dir)) {
+		return true;
+	}
+	String prefix = p_dir.ends_with("/") ? p_dir : p_dir + "/";
+	for (const KeyValue<String, Vector<uint8_t>> &E : *files) {
+		if (E.key.begins_with(prefix)) {
+			return true;
+		}
+	}
+	for (const String &dir : *dirs) {
+		if (dir.begins_with(prefix)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Writes the file back to the table, so importers can write their output to memory.
+void FileAccessPatchworkMemory::_commit() {
+	if (!writable) {
+		return;
+	}
+	MutexLock lock(files_mutex);
+	ERR_FAIL_NULL(files);
+	(*files)[memory_path] = data;
+}
+
+Error FileAccessPatchworkMemory::open_internal(const String &p_path, int p_mode_flags) {
+	close();
+	if (!_is_routed(p_path)) {
+		return FileAccessPatchworkPlatform::open_internal(p_path, p_mode_flags);
+	}
+
+	String path = p_path.simplify_path();
+	bool truncate = (p_mode_flags & WRITE) && p_mode_flags != READ_WRITE;
+	if (truncate) {
+		data.clear();
+	} else {
+		MutexLock lock(files_mutex);
+		const Vector<uint8_t> *existing = files ? files->getptr(path) : nullptr;
+		if (!existing) {
+			return ERR_FILE_NOT_FOUND;
+		}
+		// Copy-on-write, so this is cheap until someone writes to the file.
+		data = *existing;
+	}
+	memory_path = path;
+	pos = 0;
+	eof = false;
+	writable = p_mode_flags & WRITE;
+	memory_open = true;
+	return OK;
+}
+
+uint64_t FileAccessPatchworkMemory::_get_modified_time(const String &p_file) {
+	if (_is_routed(p_file)) {
+		return 0;
+	}
+	return FileAccessPatchworkPlatform::_get_modified_time(p_file);
+}
+
+uint64_t FileAccessPatchworkMemory::_get_access_time(const String &p_file) {
+	if (_is_routed(p_file)) {
+		return 0;
+	}
+	return FileAccessPatchworkPlatform::_get_access_time(p_file);
+}
+
+int64_t FileAccessPatchworkMemory::_get_size(const String &p_file) {
+	if (_is_routed(p_file)) {
+		MutexLock lock(files_mutex);
+		const Vector<uint8_t> *existing = files ? files->getptr(p_file.simplify_path()) : nullptr;
+		return existing ? existing->size() : -1;
+	}
+	return FileAccessPatchworkPlatform::_get_size(p_file);
+}
+
+BitField<FileAccess::UnixPermissionFlags> FileAccessPatchworkMemory::_get_unix_permissions(const String &p_file) {
+	if (_is_routed(p_file)) {
+		return 0;
+	}
+	return FileAccessPatchworkPlatform::_get_unix_permissions(p_file);
+}
+
+Error FileAccessPatchworkMemory::_set_unix_permissions(const String &p_file, BitField<FileAccess::UnixPermissionFlags> p_permissions) {
+	if (_is_routed(p_file)) {
+		return ERR_UNAVAILABLE;
+	}
+	return FileAccessPatchworkPlatform::_set_unix_permissions(p_file, p_permissions);
+}
+
+bool FileAccessPatchworkMemory::_get_hidden_attribute(const String &p_file) {
+	if (_is_routed(p_file)) {
+		return false;
+	}
+	return FileAccessPatchworkPlatform::_get_hidden_attribute(p_file);
+}
+
+Error FileAccessPatchworkMemory::_set_hidden_attribute(const String &p_file, bool p_hidden) {
+	if (_is_routed(p_file)) {
+		return ERR_UNAVAILABLE;
+	}
+	return FileAccessPatchworkPlatform::_set_hidden_attribute(p_file, p_hidden);
+}
+
+bool FileAccessPatchworkMemory::_get_read_only_attribute(const String &p_file) {
+	if (_is_routed(p_file)) {
+		return false;
+	}
+	return FileAccessPatchworkPlatform::_get_read_only_attribute(p_file);
+}
+
+Error FileAccessPatchworkMemory::_set_read_only_attribute(const String &p_file, bool p_ro) {
+	if (_is_routed(p_file)) {
+		return ERR_UNAVAILABLE;
+	}
+	return FileAccessPatchworkPlatform::_set_read_only_attribute(p_file, p_ro);
+}
+
+bool FileAccessPatchworkMemory::is_open() const {
+	return memory_open || FileAccessPatchworkPlatform::is_open();
+}
+
+String FileAccessPatchworkMemory::get_path() const {
+	if (!memory_open) {
+		return FileAccessPatchworkPlatform::get_path();
+	}
+	return memory_path;
+}
+
+String FileAccessPatchworkMemory::get_path_absolute() const {
+	if (!memory_open) {
+		return FileAccessPatchworkPlatform::get_path_absolute();
+	}
+	return memory_path;
+}
+
+void FileAccessPatchworkMemory::seek(uint64_t p_position) {
+	if (!memory_open) {
+		FileAccessPatchworkPlatform::seek(p_position);
+		return;
+	}
+	pos = MIN(p_position, (uint64_t)data.size());
+	eof = false;
+}
+
+void FileAccessPatchworkMemory::seek_end(int64_t p_position) {
+	if (!memory_open) {
+		FileAccessPatchworkPlatform::seek_end(p_position);
+		return;
+	}
+	seek(data.size() + p_position);
+}
+
+uint64_t FileAccessPatchworkMemory::get_position() const {
+	if (!memory_open) {
+		return FileAccessPatchworkPlatform::get_position();
+	}
+	return pos;
+}
+
+uint64_t FileAccessPatchworkMemory::get_length() const {
+	if (!memory_open) {
+		return FileAccessPatchworkPlatform::get_length();
+	}
+	return data.size();
+}
+
+bool FileAccessPatchworkMemory::eof_reached() const {
+	if (!memory_open) {
+		return FileAccessPatchworkPlatform::eof_reached();
+	}
+	return eof;
+}
+
+uint64_t FileAccessPatchworkMemory::get_buffer(uint8_t *p_dst, uint64_t p_length) const {
+	if (!memory_open) {
+		return FileAccessPatchworkPlatform::get_buffer(p_dst, p_length);
+	}
+	ERR_FAIL_COND_V(!p_dst && p_length > 0, -1);
+
+	uint64_t available = data.size() - pos;
+	uint64_t read = MIN(p_length, available);
+	if (read < p_length) {
+		eof = true;
+	}
+	memcpy(p_dst, data.ptr() + pos, read);
+	pos += read;
+	return read;
+}
+
+Error FileAccessPatchworkMemory::resize(int64_t p_length) {
+	if (!memory_open) {
+		return FileAccessPatchworkPlatform::resize(p_length);
+	}
+	ERR_FAIL_COND_V(!writable, ERR_FILE_CANT_WRITE);
+	data.resize(p_length);
+	pos = MIN(pos, (uint64_t)p_length);
+	return OK;
+}
+
+Error FileAccessPatchworkMemory::get_error() const {
+	if (!memory_open) {
+		return FileAccessPatchworkPlatform::get_error();
+	}
+	return eof ? ERR_FILE_EOF : OK;
+}
+
+void FileAccessPatchworkMemory::flush() {
+	if (!memory_open) {
+		FileAccessPatchworkPlatform::flush();
+		return;
+	}
+	_commit();
+}
+
+bool FileAccessPatchworkMemory::store_buffer(const uint8_t *p_src, uint64_t p_length) {
+	if (!memory_open) {
+		return FileAccessPatchworkPlatform::store_buffer(p_src, p_length);
+	}
+	ERR_FAIL_COND_V(!writable, false);
+	ERR_FAIL_COND_V(!p_src && p_length > 0, false);
+
+	if (pos + p_length > (uint64_t)data.size()) {
+		data.resize(pos + p_length);
+	}
+	memcpy(data.ptrw() + pos, p_src, p_length);
+	pos += p_length;
+	return true;
+}
+
+bool FileAccessPatchworkMemory::file_exists(const String &p_name) {
+	if (_is_routed(p_name)) {
+		MutexLock lock(files_mutex);
+		return files && files->has(p_name.simplify_path());
+	}
+	return FileAccessPatchworkPlatform::file_exists(p_name);
+}
+
+void FileAccessPatchworkMemory::close() {
+	if (!memory_open) {
+		FileAccessPatchworkPlatform::close();
+		return;
+	}
+	_commit();
+	memory_open = false;
+	writable = false;
+	memory_path = String();
+	data.clear();
+}
+
+FileAccessPatchworkMemory::~FileAccessPatchworkMemory() {
+	close();
+}
+
+void DirAccessPatchworkMemory::_install() {
+	platform_create_func = DirAccess::create_func[ACCESS_FILESYSTEM];
+	DirAccess::make_default<DirAccessPatchworkMemory>(ACCESS_FILESYSTEM);
+}
+
+void DirAccessPatchworkMemory::_restore() {
+	DirAccess::create_func[ACCESS_FILESYSTEM] = platform_create_func;
+}
+
+String DirAccessPatchworkMemory::_resolve(const String &p_path) const {
+	if (FileAccessPatchworkMemory::is_memory_path(p_path)) {
+		return p_path.simplify_path();
+	}
+	return memory_dir.path_join(p_path).simplify_path();
+}
+
+Error DirAccessPatchworkMemory::list_dir_begin() {
+	if (memory_dir.is_empty()) {
+		return DirAccessPatchworkPlatform::list_dir_begin();
+	}
+	list_dir_end();
+	String prefix = memory_dir + "/";
+	HashMap<String, bool> children;
+	{
+		MutexLock lock(FileAccessPatchworkMemory::files_mutex);
+		if (!FileAccessPatchworkMemory::files) {
+			return ERR_CANT_OPEN;
+		}
+		auto add_child = [&](const String &p_path, bool p_is_dir) {
+			if (!p_path.begins_with(prefix)) {
+				return;
+			}
+			String rest = p_path.substr(prefix.length());
+			int slash = rest.find_char('/');
+			if (slash != -1) {
+				children[rest.substr(0, slash)] = true;
+			} else if (!children.has(rest)) {
+				children[rest] = p_is_dir;
+			}
+		};
+		for (const KeyValue<String, Vector<uint8_t>> &E : *FileAccessPatchworkMemory::files) {
+			add_child(E.key, false);
+		}
+		for (const String &dir : *FileAccessPatchworkMemory::dirs) {
+			add_child(dir, true);
+		}
+	}
+	for (const KeyValue<String, bool> &E : children) {
+		listing.push_back(E.key);
+		listing_is_dir.push_back(E.value);
+	}
+	listing_pos = -1;
+	return OK;
+}
+
+String DirAccessPatchworkMemory::get_next() {
+	if (memory_dir.is_empty()) {
+		return DirAccessPatchworkPlatform::get_next();
+	}
+	listing_pos++;
+	if (listing_pos >= listing.size()) {
+		return String();
+	}
+	return listing[listing_pos];
+}
+
+bool DirAccessPatchworkMemory::current_is_dir() const {
+	if (memory_dir.is_empty()) {
+		return DirAccessPatchworkPlatform::current_is_dir();
+	}
+	return listing_pos >= 0 && listing_pos < listing_is_dir.size() && listing_is_dir[listing_pos];
+}
+
+bool DirAccessPatchworkMemory::current_is_hidden() const {
+	if (memory_dir.is_empty()) {
+		return DirAccessPatchworkPlatform::current_is_hidden();
+	}
+	return false;
+}
+
+void DirAccessPatchworkMemory::list_dir_end() {
+	if (memory_dir.is_empty()) {
+		DirAccessPatchworkPlatform::list_dir_end();
+		return;
+	}
+	listing.clear();
+	listing_is_dir.clear();
+	listing_pos = -1;
+}
+
+Error DirAccessPatchworkMemory::change_dir(String p_dir) {
+	if (memory_dir.is_empty() && !FileAccessPatchworkMemory::_is_routed(p_dir)) {
+		return DirAccessPatchworkPlatform::change_dir(p_dir);
+	}
+	String dir = _resolve(p_dir);
+	if (!FileAccessPatchworkMemory::is_memory_path(dir)) {
+		// Left the scheme with a relative path.
+		memory_dir = String();
+		return DirAccessPatchworkPlatform::change_dir(dir);
+	}
+	{
+		MutexLock lock(FileAccessPatchworkMemory::files_mutex);
+		if (!FileAccessPatchworkMemory::_dir_exists(dir)) {
+			return ERR_INVALID_PARAMETER;
+		}
+	}
+	list_dir_end();
+	memory_dir = dir;
+	return OK;
+}
+
+String DirAccessPatchworkMemory::get_current_dir(bool p_include_drive) const {
+	if (memory_dir.is_empty()) {
+		return DirAccessPatchworkPlatform::get_current_dir(p_include_drive);
+	}
+	return memory_dir;
+}
+
+Error DirAccessPatchworkMemory::make_dir(String p_dir) {
+	if (memory_dir.is_empty() && !FileAccessPatchworkMemory::_is_routed(p_dir)) {
+		return DirAccessPatchworkPlatform::make_dir(p_dir);
+	}
+	String dir = _resolve(p_dir);
+	MutexLock lock(FileAccessPatchworkMemory::files_mutex);
+	ERR_FAIL_NULL_V(FileAccessPatchworkMemory::dirs, ERR_CANT_CREATE);
+	if (FileAccessPatchworkMemory::_dir_exists(dir)) {
+		return ERR_ALREADY_EXISTS;
+	}
+	FileAccessPatchworkMemory::dirs->insert(dir);
+	return OK;
+}
+
+bool DirAccessPatchworkMemory::file_exists(String p_file) {
+	if (memory_dir.is_empty() && !FileAccessPatchworkMemory::_is_routed(p_file)) {
+		return DirAccessPatchworkPlatform::file_exists(p_file);
+	}
+	MutexLock lock(FileAccessPatchworkMemory::files_mutex);
+	return FileAccessPatchworkMemory::files && FileAccessPatchworkMemory::files->has(_resolve(p_file));
+}
+
+bool DirAccessPatchworkMemory::dir_exists(String p_dir) {
+	if (memory_dir.is_empty() && !FileAccessPatchworkMemory::_is_routed(p_dir)) {
+		return DirAccessPatchworkPlatform::dir_exists(p_dir);
+	}
+	MutexLock lock(FileAccessPatchworkMemory::files_mutex);
+	return FileAccessPatchworkMemory::_dir_exists(_resolve(p_dir));
+}
+
+Error DirAccessPatchworkMemory::rename(String p_path, String p_new_path) {
+	if (memory_dir.is_empty() && !FileAccessPatchworkMemory::_is_routed(p_path)) {
+		return DirAccessPatchworkPlatform::rename(p_path, p_new_path);
+	}
+	String from = _resolve(p_path);
+	String to = _resolve(p_new_path);
+	ERR_FAIL_COND_V_MSG(!FileAccessPatchworkMemory::is_memory_path(to), ERR_UNAVAILABLE, "Can't move a memory file out of memory.");
+	MutexLock lock(FileAccessPatchworkMemory::files_mutex);
+	ERR_FAIL_NULL_V(FileAccessPatchworkMemory::files, ERR_FILE_NOT_FOUND);
+	Vector<uint8_t> *data = FileAccessPatchworkMemory::files->getptr(from);
+	if (!data) {
+		return ERR_FILE_NOT_FOUND;
+	}
+	Vector<uint8_t> moved = *data;
+	FileAccessPatchworkMemory::files->erase(from);
+	(*FileAccessPatchworkMemory::files)[to] = moved;
+	return OK;
+}
+
+Error DirAccessPatchworkMemory::remove(String p_path) {
+	if (memory_dir.is_empty() && !FileAccessPatchworkMemory::_is_routed(p_path)) {
+		return DirAccessPatchworkPlatform::remove(p_path);
+	}
+	String path = _resolve(p_path);
+	MutexLock lock(FileAccessPatchworkMemory::files_mutex);
+	if (FileAccessPatchworkMemory::files && FileAccessPatchworkMemory::files->erase(path)) {
+		return OK;
+	}
+	if (FileAccessPatchworkMemory::dirs && FileAccessPatchworkMemory::dirs->erase(path)) {
+		return OK;
+	}
+	return ERR_FILE_NOT_FOUND;
+}
@@ -0,0 +1,141 @@
+#ifndef FILE_ACCESS_PATCHWORK_MEMORY_H
+#define FILE_ACCESS_PATCHWORK_MEMORY_H
+
+#include "core/io/dir_access.h"
+#include "core/io/file_access.h"
+#include "core/os/mutex.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/hash_set.h"
+#include "core/templates/safe_refcount.h"
+
+#if defined(WINDOWS_ENABLED)
+#include "drivers/windows/dir_access_windows.h"
+#include "drivers/windows/file_access_windows.h"
+typedef FileAccessWindows FileAccessPatchworkPlatform;
+typedef DirAccessWindows DirAccessPatchworkPlatform;
+#elif defined(UNIX_ENABLED)
+#include "drivers/unix/dir_access_unix.h"
+#include "drivers/unix/file_access_unix.h"
+typedef FileAccessUnix FileAccessPatchworkPlatform;
+typedef DirAccessUnix DirAccessPatchworkPlatform;
+#endif
+
+// Serves paths under `patchworkmem://` from an in-memory file table, so Patchwork can load and import history
+// resources without a round-trip through the temp dir.
+//
+// Godot only dispatches file access by scheme for res://, user:// and pipe://, so there's no way to register
+// `patchworkmem://` on its own without an engine change. Instead, the filesystem create funcs point at these classes
+// from module init, before any loader thread runs, and are never swapped while the editor is up. Memory paths are only
+// served while memory files are registered, i.e. while a history load is in flight; until then an atomic flag skips
+// straight to the platform implementation. Both classes extend it, so regular paths run it in place: no extra
+// allocation, and the per-path queries are plain base calls.
+class FileAccessPatchworkMemory : public FileAccessPatchworkPlatform {
+	GDSOFTCLASS(FileAccessPatchworkMemory, FileAccessPatchworkPlatform);
+
+	friend class DirAccessPatchworkMemory;
+
+	static Mutex files_mutex;
+	static HashMap<String, Vector<uint8_t>> *files;
+	// Directories made under the scheme. Directories that hold files exist implicitly.
+	static HashSet<String> *dirs;
+	// Set while memory files are registered.
+	static SafeFlag active;
+	static FileAccess::CreateFunc platform_create_func;
+
+	// State of an open memory file.
+	String memory_path;
+	Vector<uint8_t> data;
+	mutable uint64_t pos = 0;
+	bool memory_open = false;
+	bool writable = false;
+	mutable bool eof = false;
+
+	static bool _is_routed(const String &p_path);
+	static bool _dir_exists(const String &p_dir);
+	void _commit();
+
+protected:
+	virtual Error open_internal(const String &p_path, int p_mode_flags) override;
+	virtual uint64_t _get_modified_time(const String &p_file) override;
+	virtual uint64_t _get_access_time(const String &p_file) override;
+	virtual int64_t _get_size(const String &p_file) override;
+	virtual BitField<FileAccess::UnixPermissionFlags> _get_unix_permissions(const String &p_file) override;
+	virtual Error _set_unix_permissions(const String &p_file, BitField<FileAccess::UnixPermissionFlags> p_permissions) override;
+	virtual bool _get_hidden_attribute(const String &p_file) override;
+	virtual Error _set_hidden_attribute(const String &p_file, bool p_hidden) override;
+	virtual bool _get_read_only_attribute(const String &p_file) override;
+	virtual Error _set_read_only_attribute(const String &p_file, bool p_ro) override;
+
+public:
+	static constexpr const char *SCHEME = "patchworkmem://";
+
+	static void initialize();
+	static void finalize();
+	static bool is_memory_path(const String &p_path);
+	// Registering the first file routes memory paths to the memory table until every file is removed again.
+	static void register_file(const String &p_path, const Vector<uint8_t> &p_data);
+	static void remove_files(const String &p_prefix);
+
+	virtual bool is_open() const override;
+	virtual String get_path() const override;
+	virtual String get_path_absolute() const override;
+
+	virtual void seek(uint64_t p_position) override;
+	virtual void seek_end(int64_t p_position) override;
+	virtual uint64_t get_position() const override;
+	virtual uint64_t get_length() const override;
+	virtual bool eof_reached() const override;
+	virtual uint64_t get_buffer(uint8_t *p_dst, uint64_t p_length) const override;
+	virtual Error resize(int64_t p_length) override;
+	virtual Error get_error() const override;
+
+	virtual void flush() override;
+	virtual bool store_buffer(const uint8_t *p_src, uint64_t p_length) override;
+
+	virtual bool file_exists(const String &p_name) override;
+	virtual void close() override;
+
+	FileAccessPatchworkMemory() {}
+	~FileAccessPatchworkMemory();
+};
+
+// Lists and makes directories under `patchworkmem://`, so importers that walk their source or output directory work
+// on memory paths. Installed and routed together with FileAccessPatchworkMemory.
+class DirAccessPatchworkMemory : public DirAccessPatchworkPlatform {
+	GDSOFTCLASS(DirAccessPatchworkMemory, DirAccessPatchworkPlatform);
+
+	friend class FileAccessPatchworkMemory;
+
+	static DirAccess::CreateFunc platform_create_func;
+
+	// Set while the current directory is a memory path.
+	String memory_dir;
+	Vector<String> listing;
+	Vector<bool> listing_is_dir;
+	int listing_pos = -1;
+
+	static void _install();
+	static void _restore();
+	String _resolve(const String &p_path) const;
+
+public:
+	virtual Error list_dir_begin() override;
+	virtual String get_next() override;
+	virtual bool current_is_dir() const override;
+	virtual bool current_is_hidden() const override;
+	virtual void list_dir_end() override;
+
+	virtual Error change_dir(String p_dir) override;
+	virtual String get_current_dir(bool p_include_drive = true) const override;
+	virtual Error make_dir(String p_dir) override;
+
+	virtual bool file_exists(String p_file) override;
+	virtual bool dir_exists(String p_dir) override;
+
+	virtual Error rename(String p_path, String p_new_path) override;
+	virtual Error remove(String p_path) override;
+
+	DirAccessPatchworkMemory() {}
+};
+
+#endif // FILE_ACCESS_PATCHWORK_MEMORY_H
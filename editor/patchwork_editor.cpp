@@ -1,4 +1,5 @@
 #include "patchwork_editor.h"
+#include "file_access_patchwork_memory.h"
 #include "core/variant/callable.h"
 #include "core/variant/callable_bind.h"
 #include "core/version_generated.gen.h"
@@ -143,6 +144,14 @@ Error PatchworkEditor::import_and_save_resource(const String &p_path, const Stri
 	return importer->import(ResourceUID::INVALID_ID, p_path, import_base_path, params, &import_variants, &import_options, &metadata);
 }
 
+void PatchworkEditor::register_memory_file(const String &p_path, const PackedByteArray &p_data) {
+	FileAccessPatchworkMemory::register_file(p_path, p_data);
+}
+
+void PatchworkEditor::remove_memory_files(const String &p_prefix) {
+	FileAccessPatchworkMemory::remove_files(p_prefix);
+}
+
 void PatchworkEditor::save_all_scenes_and_scripts() {
 	ShaderEditorPlugin *shader_editor = Object::cast_to<ShaderEditorPlugin>(EditorNode::get_editor_data().get_editor_by_name("Shader"));
 	if (shader_editor) {
@@ -365,6 +374,8 @@ void PatchworkEditor::_bind_methods() {
 
 	ClassDB::bind_static_method(get_class_static(), D_METHOD("get_importer_by_name", "name"), &PatchworkEditor::get_importer_by_name);
 	ClassDB::bind_static_method(get_class_static(), D_METHOD("import_and_save_resource", "path", "import_file_content", "import_base_path"), &PatchworkEditor::import_and_save_resource);
+	ClassDB::bind_static_method(get_class_static(), D_METHOD("register_memory_file", "path", "data"), &PatchworkEditor::register_memory_file);
+	ClassDB::bind_static_method(get_class_static(), D_METHOD("remove_memory_files", "prefix"), &PatchworkEditor::remove_memory_files);
 
 	ClassDB::bind_static_method(get_class_static(), D_METHOD("save_all_scenes_and_scripts"), &PatchworkEditor::save_all_scenes_and_scripts);
 	ClassDB::bind_static_method(get_class_static(), D_METHOD("save_all_scripts"), &PatchworkEditor::save_all_scripts);
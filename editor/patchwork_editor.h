@@ -36,6 +36,8 @@ public:
 	static Ref<ResourceImporter> get_importer_by_name(const String &p_name);
 	// TODO: remove this once the resource loader is working
 	static Error import_and_save_resource(const String &p_path, const String &import_file_content, const String &import_base_path);
+	static void register_memory_file(const String &p_path, const PackedByteArray &p_data);
+	static void remove_memory_files(const String &p_prefix);
 
 	static Vector<String> get_unsaved_files();
 
@@ -3,14 +3,21 @@
 /*************************************************************************/
 
 #include "register_types.h"
+#include "file_access_patchwork_memory.h"
 #include "patchwork_editor.h"
 
 
 void initialize_patchwork_editor_module(ModuleInitializationLevel p_level) {
+	if (p_level == MODULE_INITIALIZATION_LEVEL_CORE) {
+		FileAccessPatchworkMemory::initialize();
+	}
 	if (p_level == MODULE_INITIALIZATION_LEVEL_SCENE) {
 		ClassDB::register_class<PatchworkEditor>();
 	}
 }
 
 void uninitialize_patchwork_editor_module(ModuleInitializationLevel p_level) {
+	if (p_level == MODULE_INITIALIZATION_LEVEL_CORE) {
+		FileAccessPatchworkMemory::finalize();
+	}
 }
@@ -54,7 +54,7 @@ func get_color_for_change_type(change_type: String) -> Color:
 
 var diff_stylebox_tex = preload("./diff_stylebox_tex.png")
 @onready var main_vbox: VBoxContainer = %DifferMainVBox
-var diff_result: Dictionary
+var diff_result: PatchworkDiff
 
 var categories: Array = []
 var sections: Array = []
@@ -67,8 +67,22 @@ var changed_files: Array = []
 var waiting_callables: Array = []
 var last_inspected_resource: Object = null
 
+const PROPERTY_LIST_META = "patchwork_property_list"
+const POOL_KEY_META = "patchwork_pool_key"
+const CHANGE_TYPE_META = "patchwork_change_type"
+const SEPARATOR_POOL_KEY = "separator"
+
+# every DiffPropertyList in the inspector, so we can show the rows that scroll into view
+var property_lists: Array = []
+# row controls that aren't shown anywhere, keyed by the kind of editor they hold, ready to be rebound
+var row_pool: Dictionary = {}
+var visible_rows_update_queued: bool = false
+
 func _ready() -> void:
-	pass
+	get_v_scroll_bar().value_changed.connect(func(_value): queue_visible_rows_update())
+	resized.connect(queue_visible_rows_update)
+	# folding a section or showing new rows changes the layout, which re-sorts the main vbox
+	main_vbox.sort_children.connect(queue_visible_rows_update)
 
 
 # Called every frame. 'delta' is the elapsed time since the previous frame.
@@ -81,6 +95,81 @@ func _process(delta: float) -> void:
 func _on_button_pressed() -> void:
 	pass
 
+func set_section_hoverable(section: DiffInspectorSection, file_path: String) -> void:
+	section.connect("section_mouse_entered", func(_section): self._on_parent_node_box_hovered(section, file_path))
+	section.connect("section_mouse_exited", func(_section): self._on_parent_node_box_unhovered(section, file_path))
+
+func create_section(section: String, label: String, object: Object, color: Color, indent_depth: int, level: int) -> DiffInspectorSection:
+	var inspector_section: DiffInspectorSection = DiffInspectorSection.new()
+	inspector_section.setup(section, label, object, color, true, indent_depth, level)
+	return inspector_section
+
+func queue_visible_rows_update() -> void:
+	if visible_rows_update_queued:
+		return
+	visible_rows_update_queued = true
+	_update_visible_rows.call_deferred()
+
+func _update_visible_rows() -> void:
+	visible_rows_update_queued = false
+	var view_rect = get_global_rect()
+	for list in property_lists:
+		if is_instance_valid(list):
+			list.refresh(view_rect)
+
+func get_estimated_row_height() -> float:
+	return 32.0 * EditorInterface.get_editor_scale()
+
+func get_estimated_separator_height() -> float:
+	return 4.0 * EditorInterface.get_editor_scale()
+
+func get_diff_property_list(inspector_section: DiffInspectorSection) -> DiffPropertyList:
+	var list = inspector_section.get_meta(PROPERTY_LIST_META, null)
+	if list == null:
+		list = DiffPropertyList.new(self)
+		inspector_section.get_vbox().add_child(list)
+		inspector_section.set_meta(PROPERTY_LIST_META, list)
+		property_lists.append(list)
+	return list
+
+func _get_row_pool_key(value: Variant) -> String:
+	# instance_property_diff picks the editor from the value's type, so any editor with the same key can be rebound
+	if value is Object:
+		return "%d:%s" % [TYPE_OBJECT, value.get_class()]
+	return str(typeof(value))
+
+# Returns a control for a DiffPropertyList row, reusing a pooled one if there is one.
+func take_row_control(row: Dictionary) -> Control:
+	var pool: Array
+	if row["kind"] == DiffPropertyList.ROW_SEPARATOR:
+		pool = row_pool.get(SEPARATOR_POOL_KEY, [])
+		if !pool.is_empty():
+			return pool.pop_back()
+		var separator = HSeparator.new()
+		separator.set_meta(POOL_KEY_META, SEPARATOR_POOL_KEY)
+		return separator
+
+	var fake_object: MissingResource = row["object"]
+	var prop_name: String = row["prop_name"]
+	if !row["recorded"]:
+		record_prop_value(fake_object, prop_name, get_real_val(row["value"]))
+		row["recorded"] = true
+	var key = _get_row_pool_key(fake_object.get(prop_name))
+	pool = row_pool.get(key, [])
+	if !pool.is_empty():
+		var panel_container: PanelContainer = pool.pop_back()
+		rebind_prop_editor(panel_container, fake_object, prop_name, row["change_type"], row["label"])
+		return panel_container
+	var new_panel_container = get_prop_editor(fake_object, prop_name, row["change_type"], row["label"])
+	new_panel_container.set_meta(POOL_KEY_META, key)
+	return new_panel_container
+
+func release_row_control(control: Control) -> void:
+	var key = control.get_meta(POOL_KEY_META)
+	if !row_pool.has(key):
+		row_pool[key] = []
+	row_pool[key].append(control)
+
 # no type annotation for this because editor_property is ambiguously typed
 func update_property_editor(editor_property) -> void:
 	editor_property.set_read_only(true)
@@ -104,6 +193,7 @@ func get_modified_stylebox() -> StyleBoxTexture:
 
 
 func add_color_marker(change_type: String, panel_container: PanelContainer) -> void:
+	panel_container.set_meta(CHANGE_TYPE_META, change_type)
 	var color_rect: ColorRect = ColorRect.new()
 	color_rect.color = get_color_for_change_type(change_type)
 	color_rect.custom_minimum_size = Vector2(10, 10)
@@ -115,10 +205,11 @@ func add_color_marker(change_type: String, panel_container: PanelContainer) -> v
 	margin_container.add_theme_constant_override("margin_right", 20)
 	margin_container.add_child(color_rect)
 	panel_container.add_child(margin_container)
+	# the panel may be rebound to another change type, so read it back when the theme changes
 	var update_color_rect = func():
 		if !is_instance_valid(color_rect):
 			return
-		color_rect.color = get_color_for_change_type(change_type)
+		color_rect.color = get_color_for_change_type(panel_container.get_meta(CHANGE_TYPE_META))
 		color_rect.theme_changed.emit()
 		panel_container.queue_redraw()
 	self.theme_changed.connect(update_color_rect)
@@ -138,12 +229,13 @@ func snake_case_to_human_readable(snake_case_string: String) -> String:
 	return " ".join(title_case_words)
 
 
-func get_prop_editor(fake_object: MissingResource, prop_name: String, prop_value: Variant, change_type: String, prop_label: String) -> PanelContainer:
-	# print("!!! getting prop editor for ", prop_name, " with value ", prop_value)
+func record_prop_value(fake_object: MissingResource, prop_name: String, prop_value: Variant) -> void:
 	fake_object.recording_properties = true
 	fake_object.set(prop_name, prop_value)
 	fake_object.recording_properties = false
-	# print("!!! fake_object prop value: ", fake_object.get(prop_name))
+
+# The panel's children are the label, the color marker, and the editor property, in that order.
+func get_prop_editor(fake_object: MissingResource, prop_name: String, change_type: String, prop_label: String) -> PanelContainer:
 	if prop_label == null:
 		prop_label = snake_case_to_human_readable(prop_name)
 	var editor_property: EditorProperty = DiffInspectorSection.instance_property_diff(fake_object, prop_name, false)
@@ -153,9 +245,18 @@ func get_prop_editor(fake_object: MissingResource, prop_name: String, prop_value
 	add_label(prop_label, panel_container)
 	add_color_marker(change_type, panel_container)
 	panel_container.add_child(editor_property)
-	changed_resources.append(fake_object)
 	return panel_container
 
+func rebind_prop_editor(panel_container: PanelContainer, fake_object: MissingResource, prop_name: String, change_type: String, prop_label: String) -> void:
+	var label_node: Label = panel_container.get_child(0)
+	label_node.text = prop_label
+	panel_container.set_meta(CHANGE_TYPE_META, change_type)
+	var color_rect: ColorRect = panel_container.get_child(1).get_child(0)
+	color_rect.color = get_color_for_change_type(change_type)
+	var editor_property: EditorProperty = panel_container.get_child(2)
+	editor_property.set_object_and_property(fake_object, prop_name)
+	update_property_editor(editor_property)
+
 func get_real_val(prop_value: Variant) -> Variant:
 	if prop_value is LazyLoadToken:
 		# TODO: make this get called asynchronously
@@ -165,18 +266,27 @@ func get_real_val(prop_value: Variant) -> Variant:
 func add_old_and_new(inspector_section: DiffInspectorSection, change_type: String, prop_name: String, old_prop_value: Variant, new_prop_value: Variant, label: String) -> void:
 	var has_old = change_type != "added"
 	var has_new = change_type != "removed"
-	old_prop_value = get_real_val(old_prop_value)
-	new_prop_value = get_real_val(new_prop_value)
 	if label == null:
 		label = snake_case_to_human_readable(prop_name)
+	# the editors are only created once the rows scroll into view
+	var list = get_diff_property_list(inspector_section)
+	var fake_object: MissingResource = inspector_section.get_object()
+	changed_resources.append(fake_object)
 	if has_old:
-		var prop_editor = get_prop_editor(inspector_section.get_object(), prop_name + "_old", old_prop_value, "removed", label)
-		inspector_section.get_vbox().add_child(prop_editor)
+		list.add_property(fake_object, prop_name + "_old", old_prop_value, "removed", label)
 	if has_new:
-		var prop_editor = get_prop_editor(inspector_section.get_object(), prop_name + "_new", new_prop_value, "added", label if !has_old else "")
-		inspector_section.get_vbox().add_child(prop_editor)
+		list.add_property(fake_object, prop_name + "_new", new_prop_value, "added", label if !has_old else "")
+
+# default values by [node_type, prop_name]; the same pairs come up for every node of a type
+var default_val_cache: Dictionary = {}
 
 func get_default_val_for_class(node_type: String, prop_name):
+	var key = [node_type, prop_name]
+	if !default_val_cache.has(key):
+		default_val_cache[key] = _get_default_val_for_class(node_type, prop_name)
+	return default_val_cache[key]
+
+func _get_default_val_for_class(node_type: String, prop_name):
 	# We can't get the default value for a script instance
 	if node_type.begins_with("Resource("):
 		var path = node_type.trim_prefix("Resource(").trim_suffix(")").trim_prefix('"').trim_suffix('"')
@@ -349,19 +459,17 @@ func _on_parent_node_box_unhovered(node: DiffInspectorSection, file_path: String
 	node_unhovered.emit(file_path, child_paths)
 	# print("!!! parent node box unhovered: ", child_paths)
 
-func create_node_diff_section(file_section: DiffInspectorSection, node_diff: Dictionary, parent_file_path: String, node_label: String):
-	var node_name: String = node_diff["node_path"] # remove the leading "./"
-	var change_type: String = node_diff["change_type"]
+func create_node_diff_section(file_section: DiffInspectorSection, node_diff: PatchworkNodeDiff, parent_file_path: String, node_label: String):
+	var node_name: String = node_diff.get_node_path() # remove the leading "./"
+	var change_type: String = node_diff.get_change_type()
 	# print("!!! adding node diff result for ", node_name, " with type ", change_type)
 
-	var prop_diffs: Dictionary
-	var inspector_section: DiffInspectorSection = DiffInspectorSection.new()
-	var vbox = inspector_section.get_vbox()
+	var prop_names: PackedStringArray
 	var fake_node = MissingResource.new()
 
-	var node_type: String = node_diff.get("type", "")
+	var node_type: String = node_diff.get_node_type()
 	if (node_type == ""):
-		print(node_diff)
+		print(node_name)
 	var color: Color = added_color
 	if change_type == "added":
 		color = added_color
@@ -378,25 +486,23 @@ func create_node_diff_section(file_section: DiffInspectorSection, node_diff: Dic
 		color = modified_color
 		node_label += " (Modified)"
 		changed_nodes.append(fake_node)
-	prop_diffs = node_diff.get("changed_props", {})
-	if prop_diffs.size() == 0:
+	prop_names = node_diff.get_property_names()
+	if prop_names.size() == 0:
 		return null
 
-	inspector_section.setup(node_name, node_label, fake_node, color, true, 1, 2)
+	var inspector_section: DiffInspectorSection = create_section(node_name, node_label, fake_node, color, 1, 2)
 	inspector_section.set_type(change_type)
 	# fake_node.original_class = node_type
 	var i = 0
-	# get the length of the prop_diffs dictionary
-	for prop_name in prop_diffs.keys():
+	# property diffs are only converted as they're added
+	for prop_name in prop_names:
 		if i > 0:
-			var divider = HSeparator.new()
-			vbox.add_child(divider)
-		add_PropertyDiffResult(inspector_section, prop_diffs[prop_name], node_type)
+			get_diff_property_list(inspector_section).add_separator()
+		add_PropertyDiffResult(inspector_section, node_diff.get_property(prop_name), node_type)
 		i += 1
 	inspector_section.unfold()
 	inspector_section.connect("box_clicked", func(section): self._on_node_box_clicked(inspector_section, parent_file_path, section))
-	inspector_section.connect("section_mouse_entered", func(_section): self._on_parent_node_box_hovered(inspector_section, parent_file_path))
-	inspector_section.connect("section_mouse_exited", func(_section): self._on_parent_node_box_unhovered(inspector_section, parent_file_path))
+	set_section_hoverable(inspector_section, parent_file_path)
 	sections.append(inspector_section)
 	# file_section.get_vbox().add_child(inspector_section)
 	return inspector_section
@@ -404,22 +510,22 @@ func create_node_diff_section(file_section: DiffInspectorSection, node_diff: Dic
 
 func add_resource_diff(inspector_section: DiffInspectorSection, change_type: String, file_path: String, old_resource: Variant, new_resource: Variant) -> void:
 	# print("adding resource diff for ", file_path)
-	var old = get_real_val(old_resource);
-	var new = get_real_val(new_resource);
 	if !is_instance_valid(old_resource) && !is_instance_valid(new_resource):
 		return
 	var prop_label = snake_case_to_human_readable(file_path)
-	var has_old = is_instance_valid(old)
-	var has_new = is_instance_valid(new)
+	# the resources are only loaded once their rows scroll into view
 	var fake_node: MissingResource = MissingResource.new()
 	fake_node.original_class = "Resource"
 	changed_resources.append(fake_node)
-	add_old_and_new(inspector_section, change_type, "Resource", old, new, prop_label)
+	add_old_and_new(inspector_section, change_type, "Resource", old_resource, new_resource, prop_label)
 
-func add_text_diff(inspector_section: DiffInspectorSection, unified_diff: Dictionary) -> void:
+func add_text_diff(inspector_section: DiffInspectorSection, file_diff: PatchworkFileDiff) -> void:
 	# print("adding text diff")
-	var text_diff = TextDifferView.get_text_diff_view(unified_diff, false)
-	text_diff.custom_minimum_size = Vector2(100, 500)
+	# the view scrolls on its own, and sizes itself to the diff up to a maximum height
+	var text_diff = TextDifferView.get_text_diff_view(file_diff, false)
+	if text_diff == null:
+		return
+	text_diff.custom_minimum_size = Vector2(100, 0)
 	inspector_section.get_vbox().add_child(text_diff)
 
 
@@ -436,7 +542,7 @@ func add_text_diff(inspector_section: DiffInspectorSection, unified_diff: Dictio
 func count_children(sec: DiffInspectorSection) -> int:
 	var count = 0
 	for child in sec.get_vbox().get_children():
-		if child is DiffInspectorSection or child is PanelContainer:
+		if child is DiffInspectorSection or child is PanelContainer or child is DiffPropertyList:
 			count += 1
 	return count
 
@@ -462,15 +568,13 @@ func pop_node_sections(name: String, map: Dictionary, parent_section: DiffInspec
 				return
 		if sec == null:
 			var fake_node: MissingResource = MissingResource.new()
-			sec = DiffInspectorSection.new()
-			sec.setup(name, override_label, fake_node, modified_color, true, 0, 1)
+			sec = create_section(name, override_label, fake_node, modified_color, 0, 1)
 			sec.set_type("modified")
 			sec.get_vbox().add_child(HSeparator.new())
 			changed_nodes.append(fake_node)
 
 			sec.connect("box_clicked", func(section): self._on_node_box_clicked(sec, file_path, section))
-			sec.connect("section_mouse_entered", func(_section): self._on_parent_node_box_hovered(sec, file_path))
-			sec.connect("section_mouse_exited", func(_section): self._on_parent_node_box_unhovered(sec, file_path))
+			set_section_hoverable(sec, file_path)
 
 		for key in map.keys():
 			if key == "_diff":
@@ -499,7 +603,7 @@ func _pop_child_map(node_diffs: Array) -> Dictionary:
 	var to_remove: Array = []
 	# node_diffs.sort_custom(func(a, b): return a["node_path"] > b["node_path"])
 	for node_diff in node_diffs:
-		var node_path: String = node_diff["node_path"]
+		var node_path: String = node_diff.get_node_path()
 		# skip temporary nodes created by the instance
 		if (node_path.contains("@")):
 			continue
@@ -531,8 +635,7 @@ func _pop_child_map(node_diffs: Array) -> Dictionary:
 
 func add_node_diff(file_section: DiffInspectorSection, file_path: String, node_diffs: Array) -> void:
 	file_section.get_vbox().add_child(HSeparator.new())
-	file_section.connect("section_mouse_entered", func(section): self._on_parent_node_box_hovered(file_section, file_path))
-	file_section.connect("section_mouse_exited", func(section): self._on_parent_node_box_unhovered(file_section, file_path))
+	set_section_hoverable(file_section, file_path)
 
 	file_section.unfold()
 	var child_map = _pop_child_map(node_diffs)
@@ -540,20 +643,20 @@ func add_node_diff(file_section: DiffInspectorSection, file_path: String, node_d
 		pop_node_sections(key, child_map[key], file_section, file_path)
 
 
-func add_text_resource_diff(inspector_section: DiffInspectorSection, changed_sub_resources: Array, changed_main_resource: Dictionary) -> void:
+func add_text_resource_diff(inspector_section: DiffInspectorSection, changed_sub_resources: Array, changed_main_resource: PatchworkSubResourceDiff) -> void:
 	inspector_section.get_vbox().add_child(HSeparator.new())
-	if changed_main_resource is Dictionary and changed_main_resource.size() > 0:
-		add_sub_resource_diff(inspector_section, changed_main_resource["change_type"], changed_main_resource["sub_resource_id"], changed_main_resource["resource_type"], changed_main_resource["changed_props"])
+	if changed_main_resource != null:
+		add_sub_resource_diff(inspector_section, changed_main_resource)
 
 	for sub_resource in changed_sub_resources:
-		var change_type = sub_resource["change_type"]
-		var sub_resource_id = sub_resource["sub_resource_id"]
-		var sub_resource_type = sub_resource["resource_type"]
-		var changed_properties = sub_resource["changed_props"]
-		add_sub_resource_diff(inspector_section, change_type, sub_resource_id, sub_resource_type, changed_properties)
-
-func add_sub_resource_diff(inspector_section: DiffInspectorSection, change_type: String, sub_resource_id: String, sub_resource_type: String, changed_properties: Dictionary) -> void:
-	if (changed_properties.size() == 0 and change_type == "modified"):
+		add_sub_resource_diff(inspector_section, sub_resource)
+
+func add_sub_resource_diff(inspector_section: DiffInspectorSection, sub_resource: PatchworkSubResourceDiff) -> void:
+	var change_type: String = sub_resource.get_change_type()
+	var sub_resource_id: String = sub_resource.get_sub_resource_id()
+	var sub_resource_type: String = sub_resource.get_resource_type()
+	var prop_names: PackedStringArray = sub_resource.get_property_names()
+	if (prop_names.size() == 0 and change_type == "modified"):
 		print("!!! no prop diffs for ", sub_resource_id, " with type ", change_type)
 		return
 	var color: Color = modified_color
@@ -571,29 +674,26 @@ func add_sub_resource_diff(inspector_section: DiffInspectorSection, change_type:
 		subresource_label += " (Modified)"
 
 	var i = 0
-	var child_section: DiffInspectorSection = DiffInspectorSection.new()
 	var fake_node: MissingResource = MissingResource.new()
 	fake_node.original_class = sub_resource_type
-	child_section.setup(sub_resource_id, subresource_label, fake_node, color, true, 1, 2)
+	var child_section: DiffInspectorSection = create_section(sub_resource_id, subresource_label, fake_node, color, 1, 2)
 	child_section.set_type(change_type)
-	var vbox = child_section.get_vbox()
-	vbox.add_child(HSeparator.new())
-	# get the length of the prop_diffs dictionary
-	for prop_name in changed_properties.keys():
+	child_section.get_vbox().add_child(HSeparator.new())
+	# property diffs are only converted as they're added
+	for prop_name in prop_names:
 		if i > 0:
-			var divider = HSeparator.new()
-			vbox.add_child(divider)
-		add_PropertyDiffResult(child_section, changed_properties[prop_name], sub_resource_type)
+			get_diff_property_list(child_section).add_separator()
+		add_PropertyDiffResult(child_section, sub_resource.get_property(prop_name), sub_resource_type)
 		i += 1
 	inspector_section.get_vbox().add_child(child_section)
 
 
 
-func add_FileDiffResult(file_path: String, file_diff: Dictionary) -> void:
+func add_FileDiffResult(file_path: String, file_diff: PatchworkFileDiff) -> void:
 	file_path = file_path.simplify_path()
 	var label = file_path
-	var type = file_diff.get("diff_type", "added_or_removed")
-	var change_type = file_diff["change_type"]
+	var type = file_diff.get_diff_type()
+	var change_type = file_diff.get_change_type()
 	# print("!!! adding file diff result for ", file_path, " with change_type ", change_type, " and type ", type)
 	var color: Color
 	if (change_type == "added"):
@@ -608,8 +708,7 @@ func add_FileDiffResult(file_path: String, file_diff: Dictionary) -> void:
 	changed_files.append(file_path)
 	var fake_node: MissingResource = MissingResource.new()
 	changed_files.append(fake_node)
-	var inspector_section: DiffInspectorSection = DiffInspectorSection.new()
-	inspector_section.setup(file_path, label, fake_node, color, true, 0, 1)
+	var inspector_section: DiffInspectorSection = create_section(file_path, label, fake_node, color, 0, 1)
 	inspector_section.set_type(change_type)
 	var vbox = inspector_section.get_vbox()
 	if type == "added_or_removed":
@@ -618,22 +717,21 @@ func add_FileDiffResult(file_path: String, file_diff: Dictionary) -> void:
 		elif change_type == "removed":
 			vbox.add_child(get_node_deleted_box("File"))
 	elif type == "resource_changed":
-		var res_old = file_diff.get("old_resource", null)
-		var res_new = file_diff.get("new_resource", null)
+		var res_old = file_diff.get_old_resource()
+		var res_new = file_diff.get_new_resource()
 		add_resource_diff(inspector_section, change_type, file_path, res_old, res_new)
 		inspector_section.connect("box_clicked", self._on_resource_box_clicked)
 	elif type == "text_changed":
-		var text_diff = file_diff["text_diff"]
-		add_text_diff(inspector_section, text_diff)
+		add_text_diff(inspector_section, file_diff)
 		inspector_section.connect("box_clicked", self._on_text_box_clicked)
 	elif type == "text_resource_changed":
-		var changed_sub_resources = file_diff["changed_sub_resources"]
-		var changed_main_resource = file_diff["changed_main_resource"]
+		var changed_sub_resources = file_diff.get_changed_sub_resources()
+		var changed_main_resource = file_diff.get_changed_main_resource()
 		add_text_resource_diff(inspector_section, changed_sub_resources, changed_main_resource)
 		inspector_section.connect("box_clicked", self._on_resource_box_clicked)
 	elif type == "scene_changed":
-		var node_diffs: Array = file_diff["changed_nodes"]
-		node_diffs.sort_custom(func(a, b): return a["node_path"] < b["node_path"])
+		# already sorted by node path
+		var node_diffs: Array = file_diff.get_changed_nodes()
 		inspector_section.connect("box_clicked", func(section): self._on_scene_resource_box_clicked(inspector_section, section))
 		add_node_diff(inspector_section, file_path, node_diffs)
 		# print("node_diff size: ", node_diffs.size())
@@ -648,14 +746,12 @@ func add_FileDiffResult(file_path: String, file_diff: Dictionary) -> void:
 	main_vbox.add_child(inspector_section)
 
 # defs for these are in editor/diff_result.h
-func add_diff(diff: Dictionary) -> void:
+func add_diff(diff: PatchworkDiff) -> void:
 	# print("ADDING DIFF!!!")
 	diff_result = diff
-	var size = diff_result.size()
-	# print("Diff size: ", size)
-	for file in diff_result.keys():
+	for file in diff_result.get_file_paths():
 		# print("Adding file diff result for ", file)
-		add_FileDiffResult(file, diff_result[file])
+		add_FileDiffResult(file, diff_result.get_file_diff(file))
 
 
 func reset() -> void:
@@ -667,6 +763,12 @@ func reset() -> void:
 		section.queue_free()
 	for child in main_vbox.get_children():
 		child.queue_free()
+	# pooled rows aren't in the tree, so nothing else will free them
+	for pool in row_pool.values():
+		for control in pool:
+			control.free()
+	row_pool.clear()
+	property_lists.clear()
 	sections.clear()
 	categories.clear()
 	changed_nodes.clear()
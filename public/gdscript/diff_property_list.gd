@@ -0,0 +1,124 @@
+@tool
+class_name DiffPropertyList
+extends Control
+
+# The property rows of one DiffInspectorSection.
+# Only the rows scrolled into view get controls; the rest are just an entry in `rows` and a height.
+# Row controls are borrowed from the DiffInspectorContainer, and handed back when they scroll out of view
+# so another list can rebind them instead of building new ones.
+
+const ROW_PROPERTY = "property"
+const ROW_SEPARATOR = "separator"
+
+# How far outside the view rows are still shown, so a little scrolling doesn't churn controls.
+const OVERSCAN = 200.0
+
+var container: DiffInspectorContainer
+# One Dictionary per row, see add_property() and add_separator().
+var rows: Array[Dictionary] = []
+# Row heights are estimated until the row has been shown once.
+var heights: PackedFloat32Array = []
+# offsets[i] is the top of row i; the last entry is the total height.
+var offsets: PackedFloat32Array = [0.0]
+# row index -> row control, for the rows currently shown.
+var shown_rows: Dictionary = {}
+
+
+func _init(p_container: DiffInspectorContainer) -> void:
+	container = p_container
+	# let scroll and hover events through to the sections and the inspector
+	mouse_filter = MOUSE_FILTER_PASS
+	resized.connect(_layout_shown_rows)
+
+
+func add_property(object: MissingResource, prop_name: String, value: Variant, change_type: String, label: String) -> void:
+	_add_row({
+		"kind": ROW_PROPERTY,
+		"object": object,
+		"prop_name": prop_name,
+		# LazyLoadTokens are only resolved once the row is first shown
+		"value": value,
+		"change_type": change_type,
+		"label": label,
+		"recorded": false,
+	}, container.get_estimated_row_height())
+
+
+func add_separator() -> void:
+	_add_row({"kind": ROW_SEPARATOR}, container.get_estimated_separator_height())
+
+
+func is_empty() -> bool:
+	return rows.is_empty()
+
+
+func _add_row(row: Dictionary, estimated_height: float) -> void:
+	rows.append(row)
+	heights.append(estimated_height)
+	offsets.append(offsets[offsets.size() - 1] + estimated_height)
+	custom_minimum_size.y = offsets[offsets.size() - 1]
+
+
+func _update_offsets() -> void:
+	var y = 0.0
+	for i in rows.size():
+		offsets[i] = y
+		y += heights[i]
+	offsets[rows.size()] = y
+	custom_minimum_size.y = y
+
+
+# Shows the rows that intersect view_rect (in global coordinates), and hands back the ones that don't.
+func refresh(view_rect: Rect2) -> void:
+	if rows.is_empty():
+		return
+	if !is_visible_in_tree():
+		release_all()
+		return
+	var rect = get_global_rect()
+	var top = view_rect.position.y - rect.position.y - OVERSCAN
+	var bottom = view_rect.end.y - rect.position.y + OVERSCAN
+	var first = 0
+	var last = 0
+	if bottom > 0 and top < offsets[rows.size()]:
+		first = maxi(offsets.bsearch(top, false) - 1, 0)
+		last = mini(offsets.bsearch(bottom, true), rows.size())
+
+	for index in shown_rows.keys():
+		if index < first or index >= last:
+			_release_row(index)
+
+	var heights_changed = false
+	for index in range(first, last):
+		if shown_rows.has(index):
+			continue
+		var control: Control = container.take_row_control(rows[index])
+		add_child(control)
+		shown_rows[index] = control
+		var height = control.get_combined_minimum_size().y
+		if height != heights[index]:
+			heights[index] = height
+			heights_changed = true
+	# this changes our minimum size, which re-sorts the inspector and refreshes us again with the real offsets
+	if heights_changed:
+		_update_offsets()
+	_layout_shown_rows()
+
+
+func release_all() -> void:
+	for index in shown_rows.keys():
+		_release_row(index)
+
+
+func _release_row(index: int) -> void:
+	var control: Control = shown_rows[index]
+	shown_rows.erase(index)
+	remove_child(control)
+	container.release_row_control(control)
+
+
+func _layout_shown_rows() -> void:
+	for index in shown_rows:
+		var control: Control = shown_rows[index]
+		control.position = Vector2(0, offsets[index])
+		control.size = Vector2(size.x, heights[index])
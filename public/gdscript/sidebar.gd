@@ -67,6 +67,16 @@ var deferred_highlight_update = null
 var all_changes_count = 0
 var history_item_count = 0
 var history_saved_selection = null # hash string
+# Whether the diff section is waiting on a diff that was still loading.
+var showing_loading_diff = false
+
+# The version of GodotProject's UI state we're showing; state_changed deltas apply on top of it.
+var ui_state_version = -1
+var main_branch_id = null
+var branches: Dictionary = {} # branch id -> branch dictionary
+var history_hashes: PackedStringArray = []
+var history_items: Dictionary = {} # change hash -> TreeItem
+var unresolved_merges: Dictionary = {} # change hash -> merged branch id, for merges whose branch isn't known yet
 
 const CREATE_BRANCH_IDX = 1
 const MERGE_BRANCH_IDX = 2
@@ -74,9 +84,16 @@ const MERGE_BRANCH_IDX = 2
 signal reload_ui();
 signal user_name_dialog_closed();
 
-func _update_ui_on_state_change():
-	print("Patchwork: Updating UI due to state change...")
-	update_ui()
+func _update_ui_on_state_change(delta: Dictionary):
+	# we already rebuilt the UI from a newer state
+	if delta.to_version <= ui_state_version:
+		return
+	# we missed a delta somewhere, so we can't apply this one
+	if delta.from_version != ui_state_version:
+		print("Patchwork: Updating UI due to state change...")
+		update_ui()
+		return
+	apply_state_delta(delta)
 
 func _update_ui_on_branch_checked_out():
 	print("Patchwork: Updating UI due to branch checked out...")
@@ -209,6 +226,7 @@ func bind_listeners(godot_project):
 
 	godot_project.state_changed.connect(self._update_ui_on_state_change);
 	godot_project.checked_out_branch.connect(self._update_ui_on_branch_checked_out);
+	godot_project.diff_loaded.connect(self._on_diff_loaded);
 
 	merge_button.pressed.connect(create_merge_preview_branch)
 	fork_button.pressed.connect(create_new_branch)
@@ -482,85 +500,164 @@ func fold_section(section_header: Button, section_body: Control):
 
 func update_history_tree():
 	if !GodotProject.has_project(): return
-	var history = GodotProject.get_branch_history()
+	history_hashes = GodotProject.get_branch_history()
 
 	history_tree.clear()
+	history_items.clear()
+	unresolved_merges.clear()
 	history_item_count = 0
+	setup_history_columns()
 
 	# create root item
 	var root = history_tree.create_item()
-	var selection = null
 
-	for i in range(history.size() - 1, -1, -1):
-		var change = GodotProject.get_change(history[i])
+	for i in range(history_hashes.size() - 1, -1, -1):
 		var item = history_tree.create_item(root)
+		history_items[history_hashes[i]] = item
 		history_item_count += 1
-		var editor_scale = EditorInterface.get_editor_scale()
-
-		# if we're a dev, we need another column for the commit hash
-		history_tree.columns = HistoryColumns.COUNT
-		if DEV_MODE:
-			item.set_text(HistoryColumns.HASH, Utils.short_hash(change.hash))
-			item.set_tooltip_text(HistoryColumns.HASH, change.hash)
-			item.set_selectable(HistoryColumns.HASH, false)
-			history_tree.set_column_expand(HistoryColumns.HASH, true)
-			history_tree.set_column_expand_ratio(HistoryColumns.HASH, 0)
-			history_tree.set_column_custom_minimum_width(HistoryColumns.HASH, 80 * editor_scale)
-
-		set_history_item_hash(item, change.hash)
-		set_history_item_enabled(item, true)
-		history_tree.set_column_expand(HistoryColumns.TEXT, true)
-		history_tree.set_column_expand_ratio(HistoryColumns.TEXT, 2)
-		item.set_selectable(HistoryColumns.TEXT, true)
-
-		var text_color = Color.WHITE
-
-		if change.is_merge:
-			var merged_branch = GodotProject.get_branch(change.merge_id)
-			# Sometimes this is null while starting up, before the branch has loaded in.
-			# If so the button will just appear later when we update UI.
-			if merged_branch:
-				item.add_button(HistoryColumns.TEXT, load("res://addons/patchwork/public/icons/branch-icon-history.svg"), 0,
-					false, "Checkout branch " + merged_branch.name)
-
-		item.set_text(HistoryColumns.TEXT, change.summary)
-
-		if !change.is_synced:
-			text_color = Color(0.6, 0.6, 0.6)
-
-		# disable initial commits
-		if change.is_setup:
-			set_history_item_enabled(item, false);
-
-		var is_revertable = true;
-		if change.is_setup && i == 0: is_revertable = false # we can't revert to the very first setup commit, because there's 2
-		if i == history.size() - 1: is_revertable = false # we can't revert to the current commit
-		if is_revertable:
-			item.add_button(HistoryColumns.TEXT, item_context_menu_icon, 1, false, "Open context menu")
-
-		# timestamp
-		item.set_text(HistoryColumns.TIME, change.human_timestamp)
-		item.set_tooltip_text(HistoryColumns.TIME, change.exact_timestamp)
-		item.set_selectable(HistoryColumns.TIME, false)
-		history_tree.set_column_expand(HistoryColumns.TIME, true)
-		history_tree.set_column_expand_ratio(HistoryColumns.TIME, 0)
-		history_tree.set_column_custom_minimum_width(HistoryColumns.TIME, 150 * editor_scale)
-
-		# apply the chosen color to all fields
-		item.set_custom_color(HistoryColumns.HASH, text_color)
-		item.set_custom_color(HistoryColumns.TEXT, text_color)
-		item.set_custom_color(HistoryColumns.TIME, text_color)
-
-		if change.hash == history_saved_selection:
-			selection = item
+		fill_history_item(item, GodotProject.get_change(history_hashes[i]), i)
 
 	# restore saved selection
+	var selection = history_items.get(history_saved_selection)
 	if selection != null:
 		history_tree.set_selected(selection, HistoryColumns.TEXT)
 	# otherwise, ensure any invalid saved selection is reset
 	else:
 		history_saved_selection = null
 
+func setup_history_columns() -> void:
+	var editor_scale = EditorInterface.get_editor_scale()
+
+	# if we're a dev, we need another column for the commit hash
+	history_tree.columns = HistoryColumns.COUNT
+	if DEV_MODE:
+		history_tree.set_column_expand(HistoryColumns.HASH, true)
+		history_tree.set_column_expand_ratio(HistoryColumns.HASH, 0)
+		history_tree.set_column_custom_minimum_width(HistoryColumns.HASH, 80 * editor_scale)
+
+	history_tree.set_column_expand(HistoryColumns.TEXT, true)
+	history_tree.set_column_expand_ratio(HistoryColumns.TEXT, 2)
+
+	history_tree.set_column_expand(HistoryColumns.TIME, true)
+	history_tree.set_column_expand_ratio(HistoryColumns.TIME, 0)
+	history_tree.set_column_custom_minimum_width(HistoryColumns.TIME, 150 * editor_scale)
+
+# Show a change in its history item. index is the change's position in history_hashes.
+func fill_history_item(item: TreeItem, change: Dictionary, index: int) -> void:
+	item.clear_buttons()
+
+	if DEV_MODE:
+		item.set_text(HistoryColumns.HASH, Utils.short_hash(change.hash))
+		item.set_tooltip_text(HistoryColumns.HASH, change.hash)
+		item.set_selectable(HistoryColumns.HASH, false)
+
+	set_history_item_hash(item, change.hash)
+	set_history_item_enabled(item, true)
+	item.set_selectable(HistoryColumns.TEXT, true)
+
+	var text_color = Color.WHITE
+
+	if change.is_merge:
+		var merged_branch = branches.get(change.merge_id)
+		# Sometimes this is null while starting up, before the branch has loaded in.
+		# If so the button is added once the branch shows up in a state delta.
+		if merged_branch:
+			unresolved_merges.erase(change.hash)
+			item.add_button(HistoryColumns.TEXT, load("res://addons/patchwork/public/icons/branch-icon-history.svg"), 0,
+				false, "Checkout branch " + merged_branch.name)
+		else:
+			unresolved_merges[change.hash] = change.merge_id
+
+	item.set_text(HistoryColumns.TEXT, change.summary)
+
+	if !change.is_synced:
+		text_color = Color(0.6, 0.6, 0.6)
+
+	# disable initial commits
+	if change.is_setup:
+		set_history_item_enabled(item, false);
+
+	var is_revertable = true;
+	if change.is_setup && index == 0: is_revertable = false # we can't revert to the very first setup commit, because there's 2
+	if index == history_hashes.size() - 1: is_revertable = false # we can't revert to the current commit
+	if is_revertable:
+		item.add_button(HistoryColumns.TEXT, item_context_menu_icon, 1, false, "Open context menu")
+
+	# timestamp
+	item.set_text(HistoryColumns.TIME, change.human_timestamp)
+	item.set_tooltip_text(HistoryColumns.TIME, change.exact_timestamp)
+	item.set_selectable(HistoryColumns.TIME, false)
+
+	# apply the chosen color to all fields
+	item.set_custom_color(HistoryColumns.HASH, text_color)
+	item.set_custom_color(HistoryColumns.TEXT, text_color)
+	item.set_custom_color(HistoryColumns.TIME, text_color)
+
+func refill_history_item(hash: String) -> void:
+	var item = history_items.get(hash)
+	if item:
+		fill_history_item(item, GodotProject.get_change(hash), history_hashes.find(hash))
+
+# Apply the history part of a state delta. Returns whether the history changed.
+func apply_history_delta(delta: Dictionary) -> bool:
+	if delta.history_reset or history_tree.get_root() == null:
+		update_history_tree()
+		return true
+
+	var root = history_tree.get_root()
+	var previous_size = history_hashes.size()
+	for change in delta.changes_appended:
+		history_hashes.append(change.hash)
+		# newest changes go on top
+		var item = history_tree.create_item(root, 0)
+		history_items[change.hash] = item
+		history_item_count += 1
+		fill_history_item(item, change, history_hashes.size() - 1)
+	# the previous current change can be reverted to now
+	if !delta.changes_appended.is_empty() and previous_size > 0:
+		refill_history_item(history_hashes[previous_size - 1])
+
+	for change in delta.changes_updated:
+		var item = history_items.get(change.hash)
+		if item:
+			fill_history_item(item, change, history_hashes.find(change.hash))
+
+	return !delta.changes_appended.is_empty() or !delta.changes_updated.is_empty()
+
+# Apply a state_changed delta, only updating the parts of the UI that it touches.
+func apply_state_delta(delta: Dictionary) -> void:
+	ui_state_version = delta.to_version
+	main_branch_id = delta.main_branch
+	for branch in delta.branches_added:
+		branches[branch.id] = branch
+	for branch in delta.branches_updated:
+		branches[branch.id] = branch
+	for branch_id in delta.branches_removed:
+		branches.erase(branch_id)
+	var branches_changed = (delta.main_branch_changed
+			or !delta.branches_added.is_empty()
+			or !delta.branches_updated.is_empty()
+			or !delta.branches_removed.is_empty())
+
+	if branches_changed:
+		show_branch_picker()
+		update_action_buttons()
+		update_inspector()
+		update_revert_preview()
+		update_merge_preview()
+
+	var history_changed = apply_history_delta(delta)
+	if !delta.branches_added.is_empty():
+		for hash in unresolved_merges.keys():
+			if branches.has(unresolved_merges[hash]):
+				refill_history_item(hash)
+
+	if delta.sync_status:
+		show_sync_status(delta.sync_status)
+
+	if history_changed or branches_changed:
+		update_diff()
+
 func update_action_buttons():
 	if !GodotProject.has_project(): return
 	var main_branch = GodotProject.get_main_branch()
@@ -628,6 +725,7 @@ func update_inspector():
 # Refresh the entire UI, rebinding all data.
 func update_ui() -> void:
 	update_init_panel();
+	load_ui_state()
 	update_branch_picker()
 	update_history_tree()
 	update_sync_status()
@@ -639,15 +737,21 @@ func update_ui() -> void:
 	update_diff()
 
 func update_sync_status() -> void:
-	var sync_status = GodotProject.get_sync_status()
+	show_sync_status(GodotProject.get_sync_status())
 
+func show_sync_status(sync_status: Dictionary) -> void:
 	if sync_status.state == "unknown":
 		sync_status_icon.texture_normal = load("res://addons/patchwork/public/icons/circle-alert.svg")
 		sync_status_icon.tooltip_text = "Disconnected - might have unsynced changes"
 
 	elif sync_status.state == "syncing":
 		sync_status_icon.texture_normal = load("res://addons/patchwork/public/icons/circle-sync.svg")
-		sync_status_icon.tooltip_text = "Syncing"
+		var tooltip = "Syncing"
+		if sync_status.outstanding_bytes > 0:
+			tooltip += " - %s left at %s/s" % [String.humanize_size(sync_status.outstanding_bytes), String.humanize_size(sync_status.upload_bytes_per_sec)]
+		if sync_status.rtt_ms >= 0:
+			tooltip += "\nRound trip: %d ms" % sync_status.rtt_ms
+		sync_status_icon.tooltip_text = tooltip
 
 	elif sync_status.state == "up_to_date":
 		sync_status_icon.texture_normal = load("res://addons/patchwork/public/icons/circle-check.svg")
@@ -663,12 +767,25 @@ func update_sync_status() -> void:
 			sync_status_icon.tooltip_text = "Disconnected - %s local changes that haven't been synced" % [sync_status.unsynced_changes]
 	else: printerr("unknown sync status: " + sync_status.state)
 
+# Load the branches and the version of GodotProject's UI state, which later state deltas apply to.
+func load_ui_state() -> void:
+	var ui_state = GodotProject.get_ui_state()
+	ui_state_version = ui_state.version
+	main_branch_id = ui_state.main_branch
+	branches.clear()
+	for branch in ui_state.branches:
+		branches[branch.id] = branch
+
 # Update the branch selector.
 func update_branch_picker() -> void:
 	if !GodotProject.has_project(): return
+	show_branch_picker()
+
+# Rebuild the branch selector from the cached branches.
+func show_branch_picker() -> void:
 	branch_picker.clear()
 
-	var main_branch = GodotProject.get_main_branch();
+	var main_branch = branches.get(main_branch_id)
 	var checked_out_branch = GodotProject.get_checked_out_branch()
 	if !checked_out_branch or !main_branch:
 		return
@@ -690,7 +807,7 @@ func add_branch_to_picker(branch: Dictionary, selected_branch_id: String, indent
 	var branch_index = branch_picker.get_item_count()
 	branch_picker.add_item(label, branch_index)
 
-	if !GodotProject.is_branch_loaded(branch.id):
+	if !branch.is_loaded:
 		branch_picker.set_item_icon(branch_index, load("res://addons/patchwork/public/icons/warning.svg"))
 
 	branch_picker.set_item_metadata(branch_index, branch.id)
@@ -710,11 +827,14 @@ func add_branch_to_picker(branch: Dictionary, selected_branch_id: String, indent
 	for i in range(branch.children.size()):
 		var child = branch.children[i]
 		var is_last_child = i == branch.children.size() - 1
-		add_branch_to_picker(GodotProject.get_branch(child), selected_branch_id, new_indentation, is_last_child)
+		var child_branch = branches.get(child)
+		if child_branch:
+			add_branch_to_picker(child_branch, selected_branch_id, new_indentation, is_last_child)
 
-func update_highlight_changes(diff: Dictionary) -> void:
+# Highlights the given PatchworkNodeDiffs in the edited scene, or removes the highlight if there are none.
+func update_highlight_changes(node_diffs: Array) -> void:
 	if (PatchworkEditor.is_changing_scene()):
-		deferred_highlight_update = func(): update_highlight_changes(diff)
+		deferred_highlight_update = func(): update_highlight_changes(node_diffs)
 		return
 
 	var edited_root = EditorInterface.get_edited_scene_root()
@@ -722,11 +842,8 @@ func update_highlight_changes(diff: Dictionary) -> void:
 	# reflect highlight changes checkbox state
 
 	if edited_root:
-		if not (not diff || diff.is_empty()):
-			var path = edited_root.scene_file_path
-			var scene_changes = diff.dict.get(path)
-			if scene_changes:
-				HighlightChangesLayer.highlight_changes(edited_root, scene_changes)
+		if not node_diffs.is_empty():
+			HighlightChangesLayer.highlight_changes(edited_root, node_diffs)
 		else:
 			HighlightChangesLayer.remove_highlight(edited_root)
 
@@ -737,23 +854,19 @@ func _on_node_hovered(file_path: String, node_paths: Array) -> void:
 	if node.scene_file_path != file_path or !last_diff:
 		# don't highlight changes for other files
 		return
-	var new_diff = {}
-	new_diff.title = last_diff.title;
-	new_diff.dict = {}
-	# create a diff that only contains the changes for the hovered node
-	for file in last_diff.dict.keys():
-		if file == file_path:
-			new_diff.dict[file] = last_diff.dict[file].duplicate()
-			new_diff.dict[file]["changed_nodes"] = []
-			for node_change in last_diff.dict[file]["changed_nodes"]:
-				var np: String = node_change["node_path"]
-				if node_paths.has(NodePath(np)):
-					new_diff.dict[file]["changed_nodes"].append(node_change)
-			break
-	self.update_highlight_changes(new_diff)
+	var file_diff = last_diff.diff.get_file_diff(file_path)
+	if !file_diff:
+		return
+	# only highlight the changes for the hovered node
+	var hovered_node_diffs = []
+	for node_change in file_diff.get_changed_nodes():
+		var np: String = node_change.get_node_path()
+		if node_paths.has(NodePath(np)):
+			hovered_node_diffs.append(node_change)
+	self.update_highlight_changes(hovered_node_diffs)
 
 func _on_node_unhovered(file_path: String, node_path: Array) -> void:
-	self.update_highlight_changes({})
+	self.update_highlight_changes([])
 
 var context_menu_hash = null
 
@@ -854,19 +967,30 @@ func update_diff():
 			return
 		show_diff(diff, true)
 
+# A diff that was still loading is ready, so show it if it's the one we're waiting on.
+func _on_diff_loaded():
+	if showing_loading_diff:
+		update_diff()
+
 # Inspect the diff dictionary.
 func show_diff(diff, is_change) -> void:
+	showing_loading_diff = diff and diff.loading
 	if !diff:
 		inspector.visible = false
 		diff_section_header.text = "Changes"
 		%ClearDiffButton.visible = false
 		return
+	if diff.loading:
+		inspector.visible = false
+		diff_section_header.text = diff.title + " (loading...)"
+		%ClearDiffButton.visible = is_change
+		return
 	last_diff = diff
 	%ClearDiffButton.visible = is_change
 	inspector.visible = true
 	diff_section_header.text = diff.title
 	inspector.reset()
-	inspector.add_diff(diff.dict)
+	inspector.add_diff(diff.diff)
 
 # Show an invalid diff for a commit with no valid diff (e.g. setup commits)
 func show_invalid_diff() -> void:
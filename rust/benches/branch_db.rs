@@ -0,0 +1,347 @@
+//! Measures how BranchDb reads, commits, forks and merges scale with the size of the project and its history,
+//! on generated repositories.
+//!
+//! Run with `just bench-branch-db`. Pick repositories with e.g. `PATCHWORK_BENCH_REPOS=1000x100,10000x100`.
+
+use std::{
+    collections::HashSet,
+    sync::{
+        Arc,
+        atomic::{AtomicUsize, Ordering},
+    },
+    time::{Duration, Instant},
+};
+
+use criterion::{BenchmarkId, Criterion};
+use ignore::gitignore::Gitignore;
+use patchwork_rust_core::bench_api::{
+    BranchDb, ChangeIngester, DocumentWatcher, FileContent, HistoryRef, PeerWatcher,
+};
+use samod::{DocumentId, Repo};
+use tempfile::TempDir;
+use tokio::runtime::Runtime;
+
+/// Files changed by each generated commit, and by each commit being measured, like a typical save.
+const FILES_PER_COMMIT: usize = 10;
+/// Every nth generated file is a scene, the rest are scripts.
+const SCENE_EVERY: usize = 10;
+
+/// Repositories to generate, as (files, commits). Override with e.g. `PATCHWORK_BENCH_REPOS=1000x100,10000x100`.
+const DEFAULT_REPOS: &[(usize, usize)] =
+    &[(1_000, 100), (10_000, 100), (100_000, 100), (1_000, 10_000)];
+
+/// A generated project with a main branch, stored in a temp directory and tracked the way the driver tracks it.
+/// Content is a function of the file index and revision only, so every run generates the same repository.
+struct Fixture {
+    name: String,
+    files: usize,
+    branch_db: BranchDb,
+    main: DocumentId,
+    /// The ref halfway through the generated history, for diffs against the latest ref.
+    midpoint: HistoryRef,
+    /// Bumped for every edit, so each one actually changes its files.
+    revision: AtomicUsize,
+    repo: Repo,
+    _document_watcher: DocumentWatcher,
+    _storage: TempDir,
+}
+
+fn file_path(index: usize) -> String {
+    if index % SCENE_EVERY == 0 {
+        format!("res://scenes/{}/scene_{index}.tscn", index % 100)
+    } else {
+        format!("res://scripts/{}/script_{index}.gd", index % 100)
+    }
+}
+
+fn file_content(index: usize, revision: usize) -> FileContent {
+    if index % SCENE_EVERY == 0 {
+        FileContent::from_string(format!(
+            r#"[gd_scene format=3 uid="uid://bbench{index}"]
+
+[node name="Root" type="Node2D"]
+
+[node name="Sprite" type="Sprite2D" parent="."]
+position = Vector2({revision}, {index})
+"#
+        ))
+    } else {
+        FileContent::String(format!(
+            "extends Node\n\nconst ID = {index}\nvar revision = {revision}\n"
+        ))
+    }
+}
+
+impl Fixture {
+    async fn generate(files: usize, commits: usize) -> Self {
+        let storage = TempDir::new().unwrap();
+        let repo = Repo::build_tokio()
+            .with_storage(samod::storage::TokioFilesystemStorage::new(
+                storage.path().join(".patchwork"),
+            ))
+            .load()
+            .await;
+        let branch_db = BranchDb::new(
+            repo.clone(),
+            storage.path().to_path_buf(),
+            Gitignore::empty(),
+        );
+        branch_db.set_username(Some("bench".to_string())).await;
+        let metadata_handle = branch_db.create_metadata_doc().await;
+        let document_watcher =
+            DocumentWatcher::new(repo.clone(), branch_db.clone(), metadata_handle, None).await;
+        let main = branch_db.get_main_branch().await.unwrap();
+
+        let mut fixture = Self {
+            name: format!("{files}_files_{commits}_commits"),
+            files,
+            branch_db,
+            main: main.clone(),
+            midpoint: HistoryRef::new(main.clone(), Vec::new()),
+            revision: AtomicUsize::new(0),
+            repo,
+            _document_watcher: document_watcher,
+            _storage: storage,
+        };
+        fixture.wait_until_loaded(&main).await;
+
+        let start = Instant::now();
+        let check_in = (0..files)
+            .map(|i| (file_path(i), file_content(i, 0)))
+            .collect();
+        fixture.commit(&main, check_in, true).await;
+        for commit in 1..commits {
+            if commit == commits / 2 {
+                fixture.midpoint = fixture.latest(&main).await;
+            }
+            let edit = fixture.edit();
+            fixture.commit(&main, edit, false).await;
+        }
+        if commits < 2 {
+            fixture.midpoint = fixture.latest(&main).await;
+        }
+        let (branch_docs, _) = fixture.branch_db.measure_docs().await;
+        println!(
+            "Generated {} in {:.1?}; branch docs take {} bytes saved",
+            fixture.name,
+            start.elapsed(),
+            branch_docs.bytes
+        );
+        fixture
+    }
+
+    async fn wait_until_loaded(&self, branch: &DocumentId) {
+        let start = Instant::now();
+        while !self.branch_db.is_branch_loaded(branch).await {
+            assert!(
+                start.elapsed() < Duration::from_secs(60),
+                "Branch {branch} never loaded"
+            );
+            tokio::time::sleep(Duration::from_millis(1)).await;
+        }
+    }
+
+    async fn latest(&self, branch: &DocumentId) -> HistoryRef {
+        self.branch_db
+            .get_latest_ref_on_branch(branch)
+            .await
+            .unwrap()
+    }
+
+    /// New content for the next [FILES_PER_COMMIT] files, spread across the project.
+    fn edit(&self) -> Vec<(String, FileContent)> {
+        let revision = self.revision.fetch_add(1, Ordering::Relaxed) + 1;
+        (0..FILES_PER_COMMIT)
+            .map(|i| {
+                let index = (revision * FILES_PER_COMMIT + i) * 7919 % self.files;
+                (file_path(index), file_content(index, revision))
+            })
+            .collect()
+    }
+
+    async fn commit(
+        &self,
+        branch: &DocumentId,
+        files: Vec<(String, FileContent)>,
+        is_checking_in: bool,
+    ) -> HistoryRef {
+        let latest = self.latest(branch).await;
+        self.branch_db
+            .commit_fs_changes(files, &latest, None, is_checking_in)
+            .await
+            .expect("Generated commit didn't change anything")
+    }
+
+    /// Forks main, commits an edit to the fork, and returns it once it's loaded.
+    async fn edited_fork(&self) -> DocumentId {
+        let fork = self
+            .branch_db
+            .fork_branch("bench".to_string(), &self.main)
+            .await
+            .unwrap();
+        self.wait_until_loaded(&fork).await;
+        self.commit(&fork, self.edit(), false).await;
+        fork
+    }
+}
+
+/// Times [measured] alone, running [setup] before each iteration.
+async fn time_with_setup<S, M>(
+    iters: u64,
+    mut setup: impl AsyncFnMut() -> S,
+    mut measured: impl AsyncFnMut(S) -> M,
+) -> Duration {
+    let mut total = Duration::ZERO;
+    for _ in 0..iters {
+        let input = setup().await;
+        let start = Instant::now();
+        let output = measured(input).await;
+        total += start.elapsed();
+        drop(output);
+    }
+    total
+}
+
+/// Benchmarks that don't change the repository, so they're run first.
+fn bench_reads(c: &mut Criterion, rt: &Runtime, fixture: &Fixture) {
+    let latest = rt.block_on(fixture.latest(&fixture.main));
+    let mut group = c.benchmark_group("branch_db_reads");
+
+    let all_files = HashSet::new();
+    group.bench_function(BenchmarkId::new("get_files_at_ref", &fixture.name), |b| {
+        b.to_async(rt)
+            .iter(|| fixture.branch_db.get_files_at_ref(&latest, &all_files))
+    });
+    let one_file = HashSet::from([file_path(1)]);
+    group.bench_function(
+        BenchmarkId::new("get_files_at_ref_one_file", &fixture.name),
+        |b| {
+            b.to_async(rt)
+                .iter(|| fixture.branch_db.get_files_at_ref(&latest, &one_file))
+        },
+    );
+    for (name, force_slow_diff) in [("fast", false), ("slow", true)] {
+        group.bench_function(
+            BenchmarkId::new(format!("changed_files_between_refs_{name}"), &fixture.name),
+            |b| {
+                b.to_async(rt).iter(|| {
+                    fixture.branch_db.get_changed_file_content_between_refs(
+                        Some(&fixture.midpoint),
+                        &latest,
+                        force_slow_diff,
+                    )
+                })
+            },
+        );
+    }
+
+    let ingester = rt.block_on(async {
+        let peer_watcher = Arc::new(PeerWatcher::new(fixture.repo.clone()));
+        ChangeIngester::new(peer_watcher, fixture.branch_db.clone())
+    });
+    group.bench_function(BenchmarkId::new("get_changes", &fixture.name), |b| {
+        b.to_async(rt).iter(|| ingester.get_changes())
+    });
+    group.finish();
+}
+
+/// Benchmarks that add commits and branches. Each iteration changes the repository a little,
+/// so these measure a repository that grows slightly over the run.
+fn bench_writes(c: &mut Criterion, rt: &Runtime, fixture: &Fixture) {
+    let mut group = c.benchmark_group("branch_db_writes");
+
+    group.bench_function(BenchmarkId::new("commit_fs_changes", &fixture.name), |b| {
+        b.to_async(rt).iter_custom(|iters| async move {
+            time_with_setup(
+                iters,
+                async || (fixture.latest(&fixture.main).await, fixture.edit()),
+                async |(latest, edit)| {
+                    fixture
+                        .branch_db
+                        .commit_fs_changes(edit, &latest, None, false)
+                        .await
+                },
+            )
+            .await
+        })
+    });
+    group.bench_function(BenchmarkId::new("fork_branch", &fixture.name), |b| {
+        b.to_async(rt).iter(|| {
+            fixture
+                .branch_db
+                .fork_branch("bench".to_string(), &fixture.main)
+        })
+    });
+
+    let fork = &rt.block_on(fixture.edited_fork());
+    group.bench_function(
+        BenchmarkId::new("create_merge_preview_branch", &fixture.name),
+        |b| {
+            b.to_async(rt).iter_custom(|iters| async move {
+                let mut total = Duration::ZERO;
+                for _ in 0..iters {
+                    let start = Instant::now();
+                    let preview = fixture
+                        .branch_db
+                        .create_merge_preview_branch(fork, &fixture.main)
+                        .await
+                        .unwrap();
+                    total += start.elapsed();
+                    fixture.branch_db.delete_branch(&preview).await;
+                }
+                total
+            })
+        },
+    );
+    group.bench_function(BenchmarkId::new("merge_branch", &fixture.name), |b| {
+        b.to_async(rt).iter_custom(|iters| async move {
+            time_with_setup(
+                iters,
+                async || fixture.edited_fork().await,
+                async |fork| fixture.branch_db.merge_branch(&fork, &fixture.main).await,
+            )
+            .await
+        })
+    });
+    group.finish();
+}
+
+fn repos() -> Vec<(usize, usize)> {
+    let Ok(repos) = std::env::var("PATCHWORK_BENCH_REPOS") else {
+        return DEFAULT_REPOS.to_vec();
+    };
+    repos
+        .split(',')
+        .map(|repo| {
+            let (files, commits) = repo
+                .trim()
+                .split_once('x')
+                .expect("PATCHWORK_BENCH_REPOS entries look like 1000x100");
+            (files.parse().unwrap(), commits.parse().unwrap())
+        })
+        .collect()
+}
+
+fn main() {
+    let rt = Runtime::new().unwrap();
+    let mut c = Criterion::default()
+        .sample_size(10)
+        .warm_up_time(Duration::from_millis(500))
+        .measurement_time(Duration::from_secs(5))
+        .configure_from_args();
+    // Criterion compares against the previous run automatically. Name a baseline to keep it around,
+    // e.g. before and after a storage change.
+    if let Ok(baseline) = std::env::var("PATCHWORK_BENCH_BASELINE") {
+        c = c.save_baseline(baseline);
+    }
+
+    for (files, commits) in repos() {
+        let fixture = rt.block_on(Fixture::generate(files, commits));
+        bench_reads(&mut c, &rt, &fixture);
+        bench_writes(&mut c, &rt, &fixture);
+        let repo = fixture.repo.clone();
+        drop(fixture);
+        rt.block_on(repo.stop());
+    }
+    c.final_summary();
+}
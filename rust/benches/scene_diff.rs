@@ -0,0 +1,131 @@
+//! Measures scene property diffing, and checks that it doesn't allocate per node or per property.
+//! Lives in its own target because counting allocations means replacing the global allocator.
+//!
+//! Run with `just bench-scene-diff`.
+
+use std::{
+    alloc::{GlobalAlloc, Layout, System},
+    cell::Cell,
+    hint::black_box,
+};
+
+use criterion::{BenchmarkId, Criterion, criterion_group};
+use patchwork_rust_core::bench_api::{GodotScene, changed_node_properties, parse_scene};
+
+/// Counts the allocations made on the current thread.
+struct CountingAllocator;
+
+thread_local! {
+    static ALLOCATIONS: Cell<usize> = const { Cell::new(0) };
+}
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        let _ = ALLOCATIONS.try_with(|count| count.set(count.get() + 1));
+        unsafe { System.alloc(layout) }
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        unsafe { System.dealloc(ptr, layout) }
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        let _ = ALLOCATIONS.try_with(|count| count.set(count.get() + 1));
+        unsafe { System.realloc(ptr, layout, new_size) }
+    }
+}
+
+#[global_allocator]
+static ALLOCATOR: CountingAllocator = CountingAllocator;
+
+/// Runs [f] and returns its result along with the number of allocations it made on this thread.
+fn count_allocations<T>(f: impl FnOnce() -> T) -> (T, usize) {
+    let start = ALLOCATIONS.with(|count| count.get());
+    let result = f();
+    let end = ALLOCATIONS.with(|count| count.get());
+    (result, end - start)
+}
+
+const NODE_COUNTS: &[usize] = &[100, 1_000, 10_000];
+
+/// Builds a scene with [node_count] pairs of nodes, each with plain, ext resource and sub resource properties.
+/// [changed_node], if set, gets a different position.
+fn make_scene(node_count: usize, changed_node: Option<usize>) -> GodotScene {
+    let mut source = String::from(
+        r#"[gd_scene format=4 uid="uid://b6x3k8a1scene"]
+
+[ext_resource type="Texture2D" uid="uid://c1r8o0ickon" path="res://icon.svg" id="1_icon"]
+
+[sub_resource type="RectangleShape2D" id="RectangleShape2D_shape"]
+size = Vector2(16, 16)
+
+[node name="Root" type="Node2D" unique_id=1]
+"#,
+    );
+    for i in 0..node_count {
+        let x = if changed_node == Some(i) { i + 1 } else { i };
+        source.push_str(&format!(
+            r#"
+[node name="Sprite{i}" type="Sprite2D" parent="." unique_id={id}]
+position = Vector2({x}, 0)
+texture = ExtResource("1_icon")
+modulate = Color(1, 0.5, 0.5, 1)
+
+[node name="Shape{i}" type="CollisionShape2D" parent="Sprite{i}" unique_id={shape_id}]
+shape = SubResource("RectangleShape2D_shape")
+"#,
+            id = 10 + i * 2,
+            shape_id = 11 + i * 2,
+        ));
+    }
+    parse_scene(&source).expect("parse should succeed")
+}
+
+/// Allocations must not grow with the size of the scene: the only ones allowed are the sub-resource memo tables,
+/// and the changed property list and result list when something changed.
+fn check_allocations() {
+    for &node_count in NODE_COUNTS {
+        let old_scene = make_scene(node_count, None);
+        let unchanged_scene = make_scene(node_count, None);
+        let changed_scene = make_scene(node_count, Some(node_count / 2));
+
+        let (changed, allocations) = count_allocations(|| changed_node_properties(&old_scene, &unchanged_scene));
+        assert!(changed.is_empty());
+        assert!(
+            allocations <= 2,
+            "unchanged diff of {node_count} nodes: expected at most 2 allocations, got {allocations}"
+        );
+
+        let (changed, allocations) = count_allocations(|| changed_node_properties(&old_scene, &changed_scene));
+        assert_eq!(changed.len(), 1);
+        assert_eq!(changed[0].1, "position");
+        assert!(
+            allocations <= 4,
+            "diff of {node_count} nodes with one change: expected at most 4 allocations, got {allocations}"
+        );
+    }
+}
+
+fn bench_scene_diff(c: &mut Criterion) {
+    let mut group = c.benchmark_group("scene_diff");
+    for &node_count in NODE_COUNTS {
+        let old_scene = make_scene(node_count, None);
+        let unchanged_scene = make_scene(node_count, None);
+        let changed_scene = make_scene(node_count, Some(node_count / 2));
+        group.bench_with_input(BenchmarkId::new("unchanged", node_count), &unchanged_scene, |b, new_scene| {
+            b.iter(|| black_box(changed_node_properties(&old_scene, new_scene).len()))
+        });
+        group.bench_with_input(BenchmarkId::new("one_change", node_count), &changed_scene, |b, new_scene| {
+            b.iter(|| black_box(changed_node_properties(&old_scene, new_scene).len()))
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(benches, bench_scene_diff);
+
+fn main() {
+    check_allocations();
+    benches();
+    Criterion::default().configure_from_args().final_summary();
+}
@@ -1,3 +1,4 @@
+pub mod diff_cache;
 pub mod differ;
 pub mod resource_differ;
 pub mod scene_differ;
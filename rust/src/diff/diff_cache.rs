@@ -0,0 +1,342 @@
+use std::{
+    fs,
+    io::{self, Write},
+    path::{Path, PathBuf},
+    sync::{Arc, Mutex},
+    time::SystemTime,
+};
+
+use serde::{Deserialize, Serialize};
+
+use crate::{
+    diff::{
+        differ::{Diff, ProjectDiff},
+        resource_differ::BinaryResourceDiff,
+        scene_differ::{NodeDiff, PropertyDiff, SceneDiff, SubResourceDiff, TextResourceDiff, VariantValue},
+        text_differ::{TextDiff, TextDiffHunk, TextDiffLine},
+    },
+    helpers::{
+        history_ref::HistoryRef,
+        lru::Lru,
+        memory::{HeapSize, MemoryUsage},
+    },
+};
+
+/// The default memory budget for cached diffs.
+pub const DEFAULT_DIFF_CACHE_BYTES: usize = 64 * 1024 * 1024;
+/// The default disk budget for persisted diffs.
+pub const DEFAULT_DIFF_DISK_CACHE_BYTES: usize = 256 * 1024 * 1024;
+
+/// Bump this whenever the differ's output changes, so stale diffs on disk are ignored.
+const DISK_FORMAT_VERSION: u32 = 1;
+
+type DiffKey = (HistoryRef, HistoryRef);
+
+/// A byte-weighted LRU cache of [ProjectDiff]s, keyed by the (before, after) refs they were computed between.
+/// Cheap to clone and safe to share across threads. Since a pair of refs with heads always describes the same
+/// diff, entries can optionally be persisted under `.patchwork/` so they survive restarts. Both tiers are bounded,
+/// and evict their least recently used diffs first.
+#[derive(Debug, Clone)]
+pub struct DiffCache {
+    inner: Arc<DiffCacheInner>,
+}
+
+#[derive(Debug)]
+struct DiffCacheInner {
+    /// Weighted by each diff's heap size.
+    memory: Mutex<Lru<DiffKey, Arc<ProjectDiff>>>,
+    disk: Option<DiskTier>,
+}
+
+#[derive(Debug)]
+struct DiskTier {
+    dir: PathBuf,
+    capacity: usize,
+    /// Persisted diffs by file name, weighted by file size. Built from the directory on first use, since that's
+    /// blocking IO and the cache is created on the main thread.
+    index: Mutex<Option<Lru<String, ()>>>,
+}
+
+#[derive(Serialize)]
+struct DiskEntryRef<'a> {
+    before: &'a HistoryRef,
+    after: &'a HistoryRef,
+    diff: &'a ProjectDiff,
+}
+
+#[derive(Deserialize)]
+struct DiskEntry {
+    before: HistoryRef,
+    after: HistoryRef,
+    diff: ProjectDiff,
+}
+
+impl DiffCache {
+    /// Creates a cache holding up to [capacity] bytes of diffs in memory.
+    /// If [disk_dir] is set, diffs are also persisted there, up to [disk_capacity] bytes.
+    pub fn new(capacity: usize, disk_dir: Option<PathBuf>, disk_capacity: usize) -> Self {
+        Self {
+            inner: Arc::new(DiffCacheInner {
+                memory: Mutex::new(Lru::new(capacity)),
+                disk: disk_dir.map(|dir| DiskTier {
+                    dir: dir.join(format!("v{}", DISK_FORMAT_VERSION)),
+                    capacity: disk_capacity,
+                    index: Mutex::new(None),
+                }),
+            }),
+        }
+    }
+
+    /// Returns the diff between two refs if it's held in memory. Never touches the disk, so it's safe to call from
+    /// the main thread; see [Self::load] for that.
+    pub fn get(&self, before: &HistoryRef, after: &HistoryRef) -> Option<Arc<ProjectDiff>> {
+        let key = (before.clone(), after.clone());
+        self.inner.memory.lock().unwrap().get(&key).cloned()
+    }
+
+    /// Returns the cached diff between two refs, checking memory first and then disk. Diffs found on disk are kept
+    /// in memory. Does blocking IO, so keep this off the main thread.
+    pub fn load(&self, before: &HistoryRef, after: &HistoryRef) -> Option<Arc<ProjectDiff>> {
+        if let Some(diff) = self.get(before, after) {
+            return Some(diff);
+        }
+        let diff = Arc::new(self.inner.disk.as_ref()?.load(before, after)?);
+        tracing::debug!("Loaded diff {} -> {} from disk", before, after);
+        self.insert(before.clone(), after.clone(), diff.clone());
+        Some(diff)
+    }
+
+    /// Adds a diff to the memory tier, evicting the least recently used diffs to stay within budget.
+    pub fn insert(&self, before: HistoryRef, after: HistoryRef, diff: Arc<ProjectDiff>) {
+        let size = diff.heap_size();
+        let mut memory = self.inner.memory.lock().unwrap();
+        if size > memory.capacity() {
+            tracing::debug!("Diff {:?} -> {:?} is too large to cache in memory ({} bytes)", before, after, size);
+            return;
+        }
+        memory.insert((before, after), diff, size);
+    }
+
+    /// Writes a diff to the disk tier, if enabled, evicting the least recently used diffs on disk to stay within
+    /// budget. Does blocking IO, so keep this off the main thread.
+    pub fn persist(&self, before: &HistoryRef, after: &HistoryRef, diff: &ProjectDiff) {
+        if let Some(disk) = &self.inner.disk {
+            disk.persist(before, after, diff);
+        }
+    }
+
+    /// Drops every diff held in memory. Diffs on disk are kept, since they can never go stale.
+    pub fn clear(&self) {
+        self.inner.memory.lock().unwrap().clear();
+    }
+
+    /// Returns how many diffs are held in memory, and their total weight in bytes.
+    pub fn memory_usage(&self) -> MemoryUsage {
+        let memory = self.inner.memory.lock().unwrap();
+        MemoryUsage {
+            entries: memory.len(),
+            bytes: memory.weight(),
+        }
+    }
+}
+
+impl DiskTier {
+    fn file_name(before: &HistoryRef, after: &HistoryRef) -> Option<String> {
+        // Refs without heads don't point to a fixed place in history, so they can't be persisted.
+        if !before.is_valid() || !after.is_valid() {
+            return None;
+        }
+        let digest = md5::compute(format!("{}:{}", before, after));
+        Some(format!("{:x}.json", digest))
+    }
+
+    /// Runs [f] on the index of persisted diffs, building it from the directory first if needed.
+    fn with_index<R>(&self, f: impl FnOnce(&mut Lru<String, ()>) -> R) -> R {
+        let mut index = self.index.lock().unwrap();
+        let index = index.get_or_insert_with(|| self.scan());
+        f(index)
+    }
+
+    /// Lists the diffs already on disk, oldest first, and removes whatever doesn't fit the budget.
+    fn scan(&self) -> Lru<String, ()> {
+        let mut files: Vec<(SystemTime, String, usize)> = fs::read_dir(&self.dir)
+            .into_iter()
+            .flatten()
+            .flatten()
+            .filter_map(|entry| {
+                let name = entry.file_name().into_string().ok()?;
+                if !name.ends_with(".json") {
+                    return None;
+                }
+                let metadata = entry.metadata().ok()?;
+                Some((metadata.modified().ok()?, name, metadata.len() as usize))
+            })
+            .collect();
+        files.sort();
+
+        let mut index = Lru::new(self.capacity);
+        for (_, name, size) in files {
+            for (evicted, ()) in index.insert(name, (), size) {
+                let _ = fs::remove_file(self.dir.join(evicted));
+            }
+        }
+        index
+    }
+
+    fn load(&self, before: &HistoryRef, after: &HistoryRef) -> Option<ProjectDiff> {
+        let name = Self::file_name(before, after)?;
+        if !self.with_index(|index| index.get(&name).is_some()) {
+            return None;
+        }
+        let path = self.dir.join(&name);
+        let entry: Option<DiskEntry> = fs::File::open(&path).ok().and_then(|file| {
+            serde_json::from_reader(io::BufReader::new(file))
+                .inspect_err(|e| tracing::warn!("Discarding unreadable cached diff {:?}: {}", path, e))
+                .ok()
+        });
+        let Some(entry) = entry else {
+            self.with_index(|index| index.remove(&name));
+            let _ = fs::remove_file(&path);
+            return None;
+        };
+        // Guard against hash collisions.
+        if &entry.before != before || &entry.after != after {
+            return None;
+        }
+        // Keep the recency across restarts, since the index is rebuilt from modification times.
+        let _ = fs::File::options()
+            .write(true)
+            .open(&path)
+            .and_then(|file| file.set_modified(SystemTime::now()));
+        Some(entry.diff)
+    }
+
+    fn persist(&self, before: &HistoryRef, after: &HistoryRef, diff: &ProjectDiff) {
+        let Some(name) = Self::file_name(before, after) else {
+            return;
+        };
+        if self.with_index(|index| index.contains_key(&name)) {
+            return;
+        }
+        let path = self.dir.join(&name);
+        let size = match Self::write_entry(&path, &DiskEntryRef { before, after, diff }) {
+            Ok(size) => size,
+            Err(e) => {
+                tracing::warn!("Couldn't persist diff {} -> {}: {}", before, after, e);
+                return;
+            }
+        };
+        let (evicted, kept) = self.with_index(|index| {
+            let evicted = index.insert(name.clone(), (), size);
+            (evicted, index.contains_key(&name))
+        });
+        for (evicted, ()) in evicted {
+            let _ = fs::remove_file(self.dir.join(evicted));
+        }
+        // Bigger than the whole budget, so it can't be kept at all.
+        if !kept {
+            let _ = fs::remove_file(&path);
+        }
+    }
+
+    /// Writes an entry and returns its size on disk.
+    fn write_entry(path: &Path, entry: &DiskEntryRef) -> io::Result<usize> {
+        if let Some(dir) = path.parent() {
+            fs::create_dir_all(dir)?;
+        }
+        // Write to a temporary file first, so a crash never leaves a truncated entry behind.
+        let temp_path = path.with_extension("json.tmp");
+        let size = {
+            let mut writer = io::BufWriter::new(fs::File::create(&temp_path)?);
+            serde_json::to_writer(&mut writer, entry)?;
+            writer.flush()?;
+            writer.get_ref().metadata()?.len() as usize
+        };
+        fs::rename(&temp_path, path)?;
+        Ok(size)
+    }
+}
+
+impl HeapSize for ProjectDiff {
+    fn heap_size(&self) -> usize {
+        self.file_diffs.heap_size()
+    }
+}
+
+impl HeapSize for Diff {
+    fn heap_size(&self) -> usize {
+        match self {
+            Diff::Scene(diff) => diff.heap_size(),
+            Diff::TextResourceDiff(diff) => diff.heap_size(),
+            Diff::BinaryResource(diff) => diff.heap_size(),
+            Diff::Text(diff) => diff.heap_size(),
+        }
+    }
+}
+
+impl HeapSize for SceneDiff {
+    fn heap_size(&self) -> usize {
+        self.path.heap_size() + self.changed_nodes.heap_size()
+    }
+}
+
+impl HeapSize for TextResourceDiff {
+    fn heap_size(&self) -> usize {
+        self.path.heap_size()
+            + self.resource_type.heap_size()
+            + self.changed_sub_resources.heap_size()
+            + self.changed_main_resource.heap_size()
+    }
+}
+
+impl HeapSize for NodeDiff {
+    fn heap_size(&self) -> usize {
+        self.node_path.heap_size() + self.node_type.heap_size() + self.changed_properties.heap_size()
+    }
+}
+
+impl HeapSize for SubResourceDiff {
+    fn heap_size(&self) -> usize {
+        self.sub_resource_id.heap_size() + self.resource_type.heap_size() + self.changed_properties.heap_size()
+    }
+}
+
+impl HeapSize for PropertyDiff {
+    fn heap_size(&self) -> usize {
+        self.name.heap_size() + self.old_value.heap_size() + self.new_value.heap_size()
+    }
+}
+
+impl HeapSize for VariantValue {
+    fn heap_size(&self) -> usize {
+        match self {
+            VariantValue::Variant(value) => value.heap_size(),
+            VariantValue::DefaultValue(type_or_instance, name) => type_or_instance.heap_size() + name.heap_size(),
+            VariantValue::LazyLoadData(path, load_path) => path.heap_size() + load_path.heap_size(),
+        }
+    }
+}
+
+impl HeapSize for BinaryResourceDiff {
+    fn heap_size(&self) -> usize {
+        self.path.heap_size() + self.old_resource.heap_size() + self.new_resource.heap_size()
+    }
+}
+
+impl HeapSize for TextDiff {
+    fn heap_size(&self) -> usize {
+        self.path.heap_size() + self.diff_hunks.heap_size()
+    }
+}
+
+impl HeapSize for TextDiffHunk {
+    fn heap_size(&self) -> usize {
+        self.diff_lines.heap_size()
+    }
+}
+
+impl HeapSize for TextDiffLine {
+    fn heap_size(&self) -> usize {
+        self.content.heap_size() + self.status.heap_size()
+    }
+}
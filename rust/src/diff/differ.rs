@@ -5,14 +5,15 @@ use std::
 use godot::{
     classes::ResourceLoader, global, obj::{EngineEnum, Singleton}
 };
+use serde::{Deserialize, Serialize};
 use tracing::instrument;
 
 use crate::{
-    diff::{resource_differ::BinaryResourceDiff, scene_differ::{SceneDiff, TextResourceDiff}, text_differ::TextDiff}, fs::file_utils::{FileContent, FileSystemEvent}, helpers::{history_path::HistoryRefPath, history_ref::HistoryRef}, project::branch_db::BranchDb
+    diff::{resource_differ::BinaryResourceDiff, scene_differ::{SceneDiff, TextResourceDiff}, text_differ::TextDiff}, fs::file_utils::{FileContent, FileSystemEvent}, helpers::{history_path::HistoryRefPath, history_ref::HistoryRef, metrics::METRICS}, project::branch_db::BranchDb
 };
 
 /// The type of change that occurred in a diff.
-#[derive(Clone, Debug)]
+#[derive(Clone, Debug, Serialize, Deserialize)]
 pub enum ChangeType {
     /// The element was added.
     Added,
@@ -23,7 +24,7 @@ pub enum ChangeType {
 }
 
 /// A diff for a single file.
-#[derive(Clone, Debug)]
+#[derive(Clone, Debug, Serialize, Deserialize)]
 pub enum Diff {
     /// A scene file diff.
     Scene(SceneDiff),
@@ -36,7 +37,7 @@ pub enum Diff {
 }
 
 /// A diff for an entire project.
-#[derive(Clone, Default, Debug)]
+#[derive(Clone, Default, Debug, Serialize, Deserialize)]
 pub struct ProjectDiff {
     /// The file diffs in the project diff.
     pub file_diffs: Vec<Diff>,
@@ -47,6 +48,8 @@ pub struct ProjectDiff {
 pub struct Differ {
     /// The [BranchDb] we're working off.
     branch_db: BranchDb,
+    /// Whether to kick off threaded loads of changed resources while diffing.
+    start_loads: bool,
 }
 
 impl Differ {
@@ -54,6 +57,16 @@ impl Differ {
     pub fn new(branch_db: BranchDb) -> Self {
         Self {
             branch_db,
+            start_loads: true,
+        }
+    }
+
+    /// Creates a [Differ] for diffs that may never be shown, e.g. when prefetching.
+    /// It doesn't start loading resources; the LazyLoadToken starts the load once the diff is actually displayed.
+    pub fn new_speculative(branch_db: BranchDb) -> Self {
+        Self {
+            branch_db,
+            start_loads: false,
         }
     }
 
@@ -64,6 +77,9 @@ impl Differ {
         ref_: &HistoryRef
     ) -> Result<String, String> {
         let history_ref_path = HistoryRefPath::make_path_string(ref_, path).map_err(|_| "Invalid history ref path".to_string())?;
+        if !self.start_loads {
+            return Ok(history_ref_path);
+        }
 
         return match ResourceLoader::singleton().load_threaded_request(&history_ref_path) {
             global::Error::OK => Ok(history_ref_path),
@@ -78,6 +94,8 @@ impl Differ {
             tracing::debug!("no changes");
             return ProjectDiff::default();
         }
+        METRICS.diffs.increment();
+        let _timer = METRICS.diff_duration.start_timer();
 
         // TODO: refactor `get_changed_file_content_between_refs` to not globalize the paths so we don't have to re-localize them here
         // Get the set of new file content that has changed
@@ -113,6 +131,7 @@ impl Differ {
         };
 
         let mut diffs: Vec<Diff> = vec![];
+        METRICS.files_diffed.add(new_file_contents.len() as u64);
 
         for (path, new_file_content, change_type) in &new_file_contents {
             let old_file_content = old_file_contents
@@ -1,4 +1,6 @@
-use std::collections::{HashMap, HashSet};
+use std::{borrow::Cow, collections::HashMap, hash::Hash};
+
+use serde::{Deserialize, Serialize};
 
 use crate::{
     diff::differ::{ChangeType, Differ}, helpers::history_ref::HistoryRef, parser::{godot_parser::{
@@ -6,8 +8,11 @@ use crate::{
     }, parser_defs::OrderedProperty}
 };
 
+#[cfg(test)]
+mod tests;
+
 /// Represents a diff of a scene, with a scene path and a list of changed nodes.
-#[derive(Clone, Debug)]
+#[derive(Clone, Debug, Serialize, Deserialize)]
 pub struct SceneDiff {
     /// The path of the scene.
     pub path: String,
@@ -27,7 +32,7 @@ impl SceneDiff {
     }
 }
 
-#[derive(Clone, Debug)]
+#[derive(Clone, Debug, Serialize, Deserialize)]
 pub struct TextResourceDiff {
     /// The path of the scene.
     pub path: String,
@@ -53,7 +58,7 @@ impl TextResourceDiff {
 }
 
 /// Represents a diff of a single node within a scene, with a collection of changed properties.
-#[derive(Clone, Debug)]
+#[derive(Clone, Debug, Serialize, Deserialize)]
 pub struct NodeDiff {
     /// How the node has been changed.
     pub change_type: ChangeType,
@@ -83,7 +88,7 @@ impl NodeDiff {
 
 
 
-#[derive(Clone, Debug)]
+#[derive(Clone, Debug, Serialize, Deserialize)]
 pub struct SubResourceDiff {
     pub change_type: ChangeType,
     pub sub_resource_id: String,
@@ -107,7 +112,7 @@ impl SubResourceDiff {
     }
 }
 /// Represents a diff of a single Property within a Node, within a Scene.
-#[derive(Clone, Debug)]
+#[derive(Clone, Debug, Serialize, Deserialize)]
 pub struct PropertyDiff {
     /// The name of the changed property.
     pub name: String,
@@ -136,22 +141,23 @@ impl PropertyDiff {
 }
 
 /// The different types of Godot-recognized string values that can be stored in a Variant.
+/// Borrows from the property value it was parsed from, so comparing values doesn't allocate.
 #[derive(PartialEq, Debug)]
-enum VariantStrValue {
+enum VariantStrValue<'a> {
     /// A normal string that doesn't refer to a resource.
-    Variant(String),
+    Variant(&'a str),
     /// A Godot resource path string.
-    ResourcePath(String),
+    ResourcePath(&'a str),
     /// A Godot sub-resource identifier string.
-    SubResourceID(String),
+    SubResourceID(&'a str),
     /// A Godot external resource identifier string.
-    ExtResourceID(String),
+    ExtResourceID(&'a str),
     /// A default value for a property
     DefaultValue(Option<TypeOrInstance>, String),
 }
 
 
-#[derive(Clone, Debug)]
+#[derive(Clone, Debug, Serialize, Deserialize)]
 pub enum VariantValue {
     /// A normal variant string
     Variant(String),
@@ -162,7 +168,7 @@ pub enum VariantValue {
 }
 
 /// Implement the to_string method for this enum
-impl std::fmt::Display for VariantStrValue {
+impl std::fmt::Display for VariantStrValue<'_> {
     fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
         match self {
             VariantStrValue::Variant(s) => write!(f, "{}", s),
@@ -174,10 +180,40 @@ impl std::fmt::Display for VariantStrValue {
     }
 }
 
+/// Memoizes deep sub-resource comparisons for the duration of a single scene or resource diff.
+/// Keyed by (old sub-resource id, new sub-resource id), so a sub-resource shared by many properties is only
+/// compared once, no matter how many nodes reference it. The ids are borrowed from the scenes being diffed.
+#[derive(Default, Debug)]
+struct SubResourceChangeCache<'a> {
+    /// Finished comparisons.
+    results: HashMap<(&'a str, &'a str), bool>,
+    /// Comparisons currently on the stack, with their depth, used to break reference cycles.
+    in_progress: HashMap<(&'a str, &'a str), usize>,
+    /// The shallowest in-progress comparison the current one ran into, if it ran into a cycle.
+    cycle_depth: Option<usize>,
+    /// Comparisons that came out unchanged only because they assumed an in-progress comparison was unchanged.
+    /// They're kept here until the root of their cycle finishes, and only memoized if it's unchanged too.
+    provisional: Vec<(&'a str, &'a str)>,
+}
+
+/// Iterates the union of the keys of two maps without allocating: every key of [old], followed by the keys of [new]
+/// that aren't in [old].
+fn union_keys<'a, K: Eq + Hash + 'a, V: 'a>(
+    old: Option<&'a HashMap<K, V>>,
+    new: Option<&'a HashMap<K, V>>,
+) -> impl Iterator<Item = &'a K> + 'a {
+    let old_keys = old.into_iter().flat_map(|map| map.keys());
+    let new_keys = new.into_iter().flat_map(move |map| {
+        map.keys()
+            .filter(move |key| !old.is_some_and(|old| old.contains_key(*key)))
+    });
+    old_keys.chain(new_keys)
+}
+
 trait PropertyGetter {
     fn get_property(&self, prop: &str) -> Option<&OrderedProperty>;
     fn get_properties(&self) -> &HashMap<String, OrderedProperty>;
-    fn get_type_or_instance(&self) -> Option<TypeOrInstance>;
+    fn get_type_or_instance(&self) -> Option<Cow<'_, TypeOrInstance>>;
     fn is_subresource(&self) -> bool;
     fn get_id(&self) -> String;
 }
@@ -189,8 +225,8 @@ impl PropertyGetter for GodotNode {
     fn get_properties(&self) -> &HashMap<String, OrderedProperty> {
         &self.properties
     }
-    fn get_type_or_instance(&self) -> Option<TypeOrInstance> {
-        self.type_or_instance.clone()
+    fn get_type_or_instance(&self) -> Option<Cow<'_, TypeOrInstance>> {
+        self.type_or_instance.as_ref().map(Cow::Borrowed)
     }
     fn is_subresource(&self) -> bool {
         false
@@ -207,8 +243,8 @@ impl PropertyGetter for SubResourceNode {
     fn get_properties(&self) -> &HashMap<String, OrderedProperty> {
         &self.properties
     }
-    fn get_type_or_instance(&self) -> Option<TypeOrInstance> {
-        Some(TypeOrInstance::Type(self.resource_type.clone()))
+    fn get_type_or_instance(&self) -> Option<Cow<'_, TypeOrInstance>> {
+        Some(Cow::Owned(TypeOrInstance::Type(self.resource_type.clone())))
     }
     fn is_subresource(&self) -> bool {
         true
@@ -218,6 +254,27 @@ impl PropertyGetter for SubResourceNode {
     }
 }
 
+/// Runs property change detection over every node in two scenes, returning the changed (node, property) pairs, and
+/// the node itself with an empty property name if its class changed. This is the comparison [Differ] runs on nodes
+/// whose structural hashes differ, without building the diffs, so the scalability benchmarks can measure it.
+pub fn changed_node_properties<'a>(old_scene: &'a GodotScene, new_scene: &'a GodotScene) -> Vec<(&'a NodeId, &'a str)> {
+    let mut cache = SubResourceChangeCache::default();
+    let mut changed = Vec::new();
+    for node_id in union_keys(Some(&old_scene.nodes), Some(&new_scene.nodes)) {
+        let old_node = old_scene.get_node(node_id);
+        let new_node = new_scene.get_node(node_id);
+        for prop in Differ::get_changed_properties(old_node, new_node, Some(old_scene), Some(new_scene), &mut cache) {
+            changed.push((node_id, prop));
+        }
+        if let (Some(old_node), Some(new_node)) = (old_node, new_node)
+            && !Differ::is_same_class(old_node, new_node, Some(old_scene), Some(new_scene))
+        {
+            changed.push((node_id, ""));
+        }
+    }
+    changed
+}
+
 /// Implement scene-related functions on the Differ
 impl Differ {
     /// Generate a [SceneDiff] between the previous and current heads.
@@ -229,36 +286,22 @@ impl Differ {
         before: &HistoryRef,
         after: &HistoryRef,
     ) -> SceneDiff {
-        let mut node_ids = HashSet::new();
-        let mut sub_resource_ids = HashSet::new();
-        let mut ext_resource_ids = HashSet::new();
-
-        // Collect all the relevant node IDs, sub resource IDs, and ext resource IDs from both scenes.
-        if let Some(old_scene) = old_scene {
-            Self::get_ids_from_scene(
-                old_scene,
-                &mut node_ids,
-                &mut ext_resource_ids,
-                &mut sub_resource_ids,
-            );
-        }
-        if let Some(new_scene) = new_scene {
-            Self::get_ids_from_scene(
-                new_scene,
-                &mut node_ids,
-                &mut ext_resource_ids,
-                &mut sub_resource_ids,
-            );
-        }
-
         let mut node_diffs = Vec::new();
+        let mut cache = SubResourceChangeCache::default();
 
-        // Diff each node
-        for node_id in &node_ids {
+        // Diff each node present in either scene
+        for node_id in union_keys(old_scene.map(|s| &s.nodes), new_scene.map(|s| &s.nodes)) {
             let old_node = old_scene.as_ref().and_then(|s| s.get_node(node_id));
             let new_node = new_scene.as_ref().and_then(|s| s.get_node(node_id));
 
-            let Some(diff) = self.get_node_diff(node_id, old_node, new_node, old_scene, new_scene, before, after).await
+            // Matching structural hashes mean the node is unchanged, so don't bother comparing its properties.
+            if let (Some(old_node), Some(new_node)) = (old_node, new_node)
+                && old_node.structural_hash == new_node.structural_hash
+            {
+                continue;
+            }
+
+            let Some(diff) = self.get_node_diff(node_id, old_node, new_node, old_scene, new_scene, before, after, &mut cache).await
             else {
                 // If the node has no changes or is otherwise invalid, just skip this one.
                 continue;
@@ -286,38 +329,23 @@ impl Differ {
         before: &HistoryRef,
         after: &HistoryRef,
     ) -> TextResourceDiff {
-        let mut node_ids = HashSet::new();
-        let mut sub_resource_ids = HashSet::new();
-        let mut ext_resource_ids = HashSet::new();
-
-        let mut resource_type: String = "".to_string();
-        // Collect all the relevant node IDs, sub resource IDs, and ext resource IDs from both scenes.
-        if let Some(old_scene) = old_scene {
-            resource_type = old_scene.resource_type.clone();
-            Self::get_ids_from_scene(
-                old_scene,
-                &mut node_ids,
-                &mut ext_resource_ids,
-                &mut sub_resource_ids,
-            );
-        }
-        if let Some(new_scene) = new_scene {
-            resource_type = new_scene.resource_type.clone();
-            Self::get_ids_from_scene(
-                new_scene,
-                &mut node_ids,
-                &mut ext_resource_ids,
-                &mut sub_resource_ids,
-            );
-        }
+        let resource_type = new_scene
+            .or(old_scene)
+            .map(|s| s.resource_type.clone())
+            .unwrap_or_default();
 
         let mut changed_sub_resources = Vec::new();
-        // Diff each node
-        for sub_resource_id in &sub_resource_ids {
+        let mut cache = SubResourceChangeCache::default();
+        // Diff each sub resource present in either scene
+        for sub_resource_id in union_keys(old_scene.map(|s| &s.sub_resources), new_scene.map(|s| &s.sub_resources)) {
             let old_sub_resource = old_scene.as_ref().and_then(|s| s.sub_resources.get(sub_resource_id));
             let new_sub_resource = new_scene.as_ref().and_then(|s| s.sub_resources.get(sub_resource_id));
 
-            let Some(diff) = self.get_sub_resource_diff(sub_resource_id, old_sub_resource, new_sub_resource, old_scene, new_scene, before, after).await
+            if Self::is_structurally_unchanged(old_sub_resource, new_sub_resource) {
+                continue;
+            }
+
+            let Some(diff) = self.get_sub_resource_diff(sub_resource_id, old_sub_resource, new_sub_resource, old_scene, new_scene, before, after, &mut cache).await
             else {
                 // If the node has no changes or is otherwise invalid, just skip this one.
                 continue;
@@ -325,7 +353,13 @@ impl Differ {
 
             changed_sub_resources.push(diff);
         }
-        let changed_main_resource = self.get_sub_resource_diff("", old_scene.and_then(|s| s.main_resource.as_ref()), new_scene.and_then(|s| s.main_resource.as_ref()), old_scene, new_scene, before, after).await;
+        let old_main_resource = old_scene.and_then(|s| s.main_resource.as_ref());
+        let new_main_resource = new_scene.and_then(|s| s.main_resource.as_ref());
+        let changed_main_resource = if Self::is_structurally_unchanged(old_main_resource, new_main_resource) {
+            None
+        } else {
+            self.get_sub_resource_diff("", old_main_resource, new_main_resource, old_scene, new_scene, before, after, &mut cache).await
+        };
 
         TextResourceDiff::new(
             path.clone(),
@@ -341,43 +375,33 @@ impl Differ {
 
     }
 
-    async fn get_sub_resource_diff(
+    /// Returns true if both sub-resources exist and have the same structural hash, meaning they can't have changed.
+    fn is_structurally_unchanged(old: Option<&SubResourceNode>, new: Option<&SubResourceNode>) -> bool {
+        matches!((old, new), (Some(old), Some(new)) if old.structural_hash == new.structural_hash)
+    }
+
+    async fn get_sub_resource_diff<'a>(
         &self,
         sub_resource_id: &str,
-        old_node: Option<&SubResourceNode>,
-        new_node: Option<&SubResourceNode>,
-        old_scene: Option<&GodotScene>,
-        new_scene: Option<&GodotScene>,
+        old_node: Option<&'a SubResourceNode>,
+        new_node: Option<&'a SubResourceNode>,
+        old_scene: Option<&'a GodotScene>,
+        new_scene: Option<&'a GodotScene>,
         before: &HistoryRef,
         after: &HistoryRef,
+        cache: &mut SubResourceChangeCache<'a>,
     ) -> Option<SubResourceDiff> {
         if old_node.is_none() && new_node.is_none() {
             return None;
         }
 
-        let mut changed_properties = HashMap::new();
+        let changed_props = Self::get_changed_properties(old_node, new_node, old_scene, new_scene, cache);
         let old_class_name = old_node.and_then(|n| n.get_type_or_instance().map(|t| t.to_string()));
         let new_class_name = new_node.and_then(|n| n.get_type_or_instance().map(|t| t.to_string()));
 
-        // Collect all properties from new and old scenes
-        let mut props: HashSet<String> = HashSet::new();
-        if let Some(node) = old_node {
-            for (key, _) in node.get_properties() {
-                let _ = props.insert(key.to_string());
-            }
-        }
-        if let Some(node) = new_node {
-            for (key, _) in node.get_properties() {
-                let _ = props.insert(key.to_string());
-            }
-        }
-        for prop in &props {
-            if let Some(prop_diff) =
-                self.get_property_diff(prop, old_node, new_node, old_scene, new_scene, before, after).await
-            {
-                changed_properties.insert(prop.clone(), prop_diff);
-            }
-        }
+        let changed_properties = self
+            .get_property_diffs(&changed_props, old_node, new_node, old_scene, new_scene, before, after)
+            .await;
         Some(SubResourceDiff::new(
             match (old_node, new_node) {
                 (None, Some(_)) => ChangeType::Added,
@@ -391,65 +415,36 @@ impl Differ {
     }
 
     /// Generate a [NodeDiff] between two nodes.
-    async fn get_node_diff(
+    async fn get_node_diff<'a>(
         &self,
         node_id: &NodeId,
-        old_node: Option<&impl PropertyGetter>,
-        new_node: Option<&impl PropertyGetter>,
-        old_scene: Option<&GodotScene>,
-        new_scene: Option<&GodotScene>,
+        old_node: Option<&'a impl PropertyGetter>,
+        new_node: Option<&'a impl PropertyGetter>,
+        old_scene: Option<&'a GodotScene>,
+        new_scene: Option<&'a GodotScene>,
         before: &HistoryRef,
         after: &HistoryRef,
+        cache: &mut SubResourceChangeCache<'a>,
     ) -> Option<NodeDiff> {
         if old_node.is_none() && new_node.is_none() {
             return None;
         }
 
-        let old_class_name = old_node.map(|n| {
-            n.get_type_or_instance()
-                .as_ref()
-                .map(|t| Self::get_class_name(t, old_scene))
-                .unwrap_or_default()
-        });
-        let new_class_name = new_node.map(|n| {
-            n.get_type_or_instance()
-                .as_ref()
-                .map(|t| Self::get_class_name(t, new_scene))
-                .unwrap_or_default()
-        });
-
-        let mut changed_properties = HashMap::new();
-
-        // Collect all properties from new and old scenes
-        let mut props: HashSet<String> = HashSet::new();
-        if let Some(node) = old_node {
-            for (key, _) in node.get_properties() {
-                let _ = props.insert(key.to_string());
-            }
-        }
-        if let Some(node) = new_node {
-            for (key, _) in node.get_properties() {
-                let _ = props.insert(key.to_string());
-            }
-        }
+        let changed_props = Self::get_changed_properties(old_node, new_node, old_scene, new_scene, cache);
 
-        // Iterate through the props
-        for prop in &props {
-            if let Some(prop_diff) =
-                self.get_property_diff(prop, old_node, new_node, old_scene, new_scene, before, after).await
-            {
-                changed_properties.insert(prop.clone(), prop_diff);
+        // If there wasn't any real changes, there's no actual difference!
+        if let (Some(old), Some(new)) = (old_node, new_node) {
+            if changed_props.is_empty() && Self::is_same_class(old, new, old_scene, new_scene) {
+                return None;
             }
         }
 
-        // If there wasn't any real changes, there's no actual difference!
-        if old_node.is_some()
-            && new_node.is_some()
-            && changed_properties.is_empty()
-            && old_class_name == new_class_name
-        {
-            return None;
-        }
+        let old_class_name = old_node.map(|n| Self::get_class_name(n.get_type_or_instance().as_deref(), old_scene));
+        let new_class_name = new_node.map(|n| Self::get_class_name(n.get_type_or_instance().as_deref(), new_scene));
+
+        let changed_properties = self
+            .get_property_diffs(&changed_props, old_node, new_node, old_scene, new_scene, before, after)
+            .await;
 
         Some(NodeDiff::new(
             match (old_node, new_node) {
@@ -469,44 +464,104 @@ impl Differ {
     }
 
     /// Get a class name [String] from a [TypeOrInstance] and the [GodotScene] it is from.
-    fn get_class_name(type_or_instance: &TypeOrInstance, scene: Option<&GodotScene>) -> String {
+    fn get_class_name(type_or_instance: Option<&TypeOrInstance>, scene: Option<&GodotScene>) -> String {
+        match Self::get_class_key(type_or_instance, scene) {
+            (true, path) => format!("Resource(\"{}\")", path),
+            (false, type_name) => type_name.to_string(),
+        }
+    }
+
+    /// Borrowed form of [Self::get_class_name]: (is an instance, type name or instanced scene path).
+    fn get_class_key<'a>(type_or_instance: Option<&'a TypeOrInstance>, scene: Option<&'a GodotScene>) -> (bool, &'a str) {
         match type_or_instance {
-            TypeOrInstance::Type(type_name) => type_name.clone(),
-            TypeOrInstance::Instance(instance_id) => {
-                if let Some(scene) = scene {
-                    // strip the "ExtResource(" and ")" from the instance_id
-                    let instance_id = instance_id
-                        .trim_start_matches("ExtResource(\"")
-                        .trim_end_matches("\")");
-                    if let Some(ext_resource) = scene.ext_resources.get(instance_id) {
-                        return format!("Resource(\"{}\")", ext_resource.path);
-                    }
+            Some(TypeOrInstance::Type(type_name)) => (false, type_name.as_str()),
+            Some(TypeOrInstance::Instance(instance_id)) => {
+                // strip the "ExtResource(" and ")" from the instance_id
+                let instance_id = instance_id
+                    .trim_start_matches("ExtResource(\"")
+                    .trim_end_matches("\")");
+                match scene.and_then(|scene| scene.ext_resources.get(instance_id)) {
+                    Some(ext_resource) => (true, ext_resource.path.as_str()),
+                    None => (false, ""),
                 }
-                String::new()
             }
+            None => (false, ""),
         }
     }
 
+    /// Returns true if both nodes have the same class, without formatting the class names.
+    fn is_same_class(
+        old_node: &impl PropertyGetter,
+        new_node: &impl PropertyGetter,
+        old_scene: Option<&GodotScene>,
+        new_scene: Option<&GodotScene>,
+    ) -> bool {
+        let old_type = old_node.get_type_or_instance();
+        let new_type = new_node.get_type_or_instance();
+        Self::get_class_key(old_type.as_deref(), old_scene) == Self::get_class_key(new_type.as_deref(), new_scene)
+    }
 
     /// Returns the [VariantStrValue] of a property on a node, or the default value if the property doesn't
     /// exist on the node.
     /// If the node itself doesn't exist, returns [None].
-    fn get_varstr_or_default(prop: &str, node: Option<&impl PropertyGetter>) -> Option<VariantStrValue> {
+    fn get_varstr_or_default<'a>(prop: &str, node: Option<&'a impl PropertyGetter>) -> Option<VariantStrValue<'a>> {
         // If this node never existed, don't provide a value.
         let Some(node) = node else {
             return None;
         };
         match node.get_property(prop) {
-            Some(val) => Some(Self::get_varstr_value(val.get_value())),
+            Some(val) => Some(Self::get_varstr_value(&val.value)),
             None => Some(VariantStrValue::DefaultValue(
-                node.get_type_or_instance(),
+                node.get_type_or_instance().map(Cow::into_owned),
                 prop.to_string(),
             )),
         }
     }
 
+    /// Returns the names of the properties that have meaningfully changed between two nodes.
+    /// Only borrows from the nodes and scenes, so an unchanged node is compared without allocating.
+    fn get_changed_properties<'a>(
+        old_node: Option<&'a impl PropertyGetter>,
+        new_node: Option<&'a impl PropertyGetter>,
+        old_scene: Option<&'a GodotScene>,
+        new_scene: Option<&'a GodotScene>,
+        cache: &mut SubResourceChangeCache<'a>,
+    ) -> Vec<&'a str> {
+        union_keys(old_node.map(|n| n.get_properties()), new_node.map(|n| n.get_properties()))
+            .map(String::as_str)
+            .filter(|prop| {
+                // Slightly weird hack: Diff against the default instead of the normal property.
+                let old_value = Self::get_varstr_or_default(prop, old_node);
+                let new_value = Self::get_varstr_or_default(prop, new_node);
+                Self::did_prop_change(old_value.as_ref(), new_value.as_ref(), old_scene, new_scene, cache)
+            })
+            .collect()
+    }
+
+    /// Builds the [PropertyDiff]s for a set of properties already known to have changed.
+    async fn get_property_diffs(
+        &self,
+        changed_props: &[&str],
+        old_node: Option<&impl PropertyGetter>,
+        new_node: Option<&impl PropertyGetter>,
+        old_scene: Option<&GodotScene>,
+        new_scene: Option<&GodotScene>,
+        before: &HistoryRef,
+        after: &HistoryRef,
+    ) -> HashMap<String, PropertyDiff> {
+        let mut changed_properties = HashMap::with_capacity(changed_props.len());
+        for prop in changed_props {
+            if let Some(prop_diff) =
+                self.get_property_diff(prop, old_node, new_node, old_scene, new_scene, before, after).await
+            {
+                changed_properties.insert(prop.to_string(), prop_diff);
+            }
+        }
+        changed_properties
+    }
+
     /// Returns a [PropertyDiff] comparing the old property value versus the new one.
-    /// Returns [None] if neither node is valid, or if the value has not meaningfully changed.
+    /// Returns [None] if neither node is valid. Assumes the value has already been checked for changes.
     async fn get_property_diff(
         &self,
         prop: &str,
@@ -522,15 +577,9 @@ impl Differ {
             return None;
         };
 
-        // Slightly weird hack: Diff against the default instead of the normal property.
         let old_value = Self::get_varstr_or_default(prop, old_node);
         let new_value = Self::get_varstr_or_default(prop, new_node);
 
-        // Skip in case of no changes
-        if !self.did_prop_change(old_value.as_ref(), new_value.as_ref(), old_scene, new_scene) {
-            return None;
-        }
-
         // Expensive: Load any ext resources and turn them into Variants
         let old = match &old_value {
             Some(v) => Some(self.get_prop_value(v, old_scene, true, prop == "script", before, after).await),
@@ -556,12 +605,68 @@ impl Differ {
     }
 
     /// Check deeply to see if a subresource has changed.
-    fn did_sub_resource_change(
-        &self,
-        old_resource: Option<&SubResourceNode>,
-        new_resource: Option<&SubResourceNode>,
-        old_scene: &GodotScene,
-        new_scene: &GodotScene,
+    /// Results are memoized per (old id, new id) pair in [cache], so shared sub-resources are only compared once per diff.
+    fn did_sub_resource_change<'a>(
+        old_id: &'a str,
+        new_id: &'a str,
+        old_scene: &'a GodotScene,
+        new_scene: &'a GodotScene,
+        cache: &mut SubResourceChangeCache<'a>,
+    ) -> bool {
+        let key = (old_id, new_id);
+        if let Some(changed) = cache.results.get(&key) {
+            return *changed;
+        }
+        // We're already comparing this pair further up the stack, so this is a reference cycle.
+        // Assume it's unchanged; if anything in the cycle differs, the outer comparison will find it.
+        if let Some(&depth) = cache.in_progress.get(&key) {
+            cache.cycle_depth = Some(cache.cycle_depth.map_or(depth, |cycle_depth| cycle_depth.min(depth)));
+            return false;
+        }
+
+        let depth = cache.in_progress.len();
+        cache.in_progress.insert(key, depth);
+        let outer_cycle_depth = cache.cycle_depth.take();
+        let provisional_start = cache.provisional.len();
+
+        let changed = Self::did_sub_resource_change_uncached(
+            old_scene.sub_resources.get(old_id),
+            new_scene.sub_resources.get(new_id),
+            old_scene,
+            new_scene,
+            cache,
+        );
+
+        cache.in_progress.remove(&key);
+        let cycle_depth = cache.cycle_depth.filter(|cycle_depth| *cycle_depth < depth);
+        cache.cycle_depth = match (outer_cycle_depth, cycle_depth) {
+            (Some(outer), Some(inner)) => Some(outer.min(inner)),
+            (outer, inner) => outer.or(inner),
+        };
+        if changed {
+            // Assuming part of a cycle is unchanged can only hide changes, never invent them, so this holds regardless.
+            // Anything below us that assumed we were unchanged was wrong, though.
+            cache.provisional.truncate(provisional_start);
+            cache.results.insert(key, true);
+        } else if cycle_depth.is_some() {
+            // This depends on a comparison that's still on the stack; wait for it to finish.
+            cache.provisional.push(key);
+        } else {
+            // We're the root of any cycle below us, and came out unchanged, so everything in it is unchanged too.
+            for provisional in cache.provisional.drain(provisional_start..) {
+                cache.results.insert(provisional, false);
+            }
+            cache.results.insert(key, false);
+        }
+        changed
+    }
+
+    fn did_sub_resource_change_uncached<'a>(
+        old_resource: Option<&'a SubResourceNode>,
+        new_resource: Option<&'a SubResourceNode>,
+        old_scene: &'a GodotScene,
+        new_scene: &'a GodotScene,
+        cache: &mut SubResourceChangeCache<'a>,
     ) -> bool {
         let (old_resource, new_resource) = match (old_resource, new_resource) {
             (None, None) => return false,         // subresource never existed
@@ -585,16 +690,17 @@ impl Differ {
         for (path, new_prop) in &new_resource.properties {
             let Some(old_prop) = old_resource.properties.get(path) else {
                 // prop added
-                return false;
+                return true;
             };
 
-            let old_prop = Self::get_varstr_value(old_prop.get_value());
-            let new_prop = Self::get_varstr_value(new_prop.get_value());
-            if self.did_prop_change(
+            let old_prop = Self::get_varstr_value(&old_prop.value);
+            let new_prop = Self::get_varstr_value(&new_prop.value);
+            if Self::did_prop_change(
                 Some(&old_prop),
                 Some(&new_prop),
                 Some(old_scene),
                 Some(new_scene),
+                cache,
             ) {
                 // prop changed
                 return true;
@@ -606,7 +712,6 @@ impl Differ {
     /// Check shallowly to see if an ext resource changed. Returns true if the path, type, etc has changed, but not
     /// the contents itself.
     fn did_ext_resource_reference_change(
-        &self,
         old_resource: Option<&ExternalResourceNode>,
         new_resource: Option<&ExternalResourceNode>,
     ) -> bool {
@@ -623,12 +728,12 @@ impl Differ {
     }
 
     /// Check to see if a property has changed, including deep lookups of subresources and shallow lookup of extresources.
-    fn did_prop_change(
-        &self,
-        old_value: Option<&VariantStrValue>,
-        new_value: Option<&VariantStrValue>,
-        old_scene: Option<&GodotScene>,
-        new_scene: Option<&GodotScene>,
+    fn did_prop_change<'a>(
+        old_value: Option<&VariantStrValue<'a>>,
+        new_value: Option<&VariantStrValue<'a>>,
+        old_scene: Option<&'a GodotScene>,
+        new_scene: Option<&'a GodotScene>,
+        cache: &mut SubResourceChangeCache<'a>,
     ) -> bool {
         // If either are null, or both are none, easy exit
         let (old_value, new_value) = match (old_value, new_value) {
@@ -650,19 +755,14 @@ impl Differ {
             (
                 VariantStrValue::SubResourceID(old_value),
                 VariantStrValue::SubResourceID(new_value),
-            ) => self.did_sub_resource_change(
-                old_scene.sub_resources.get(old_value),
-                new_scene.sub_resources.get(new_value),
-                old_scene,
-                new_scene,
-            ),
+            ) => Self::did_sub_resource_change(*old_value, *new_value, old_scene, new_scene, cache),
             // Shallowly lookup extresource references
             (
                 VariantStrValue::ExtResourceID(old_value),
                 VariantStrValue::ExtResourceID(new_value),
-            ) => self.did_ext_resource_reference_change(
-                old_scene.ext_resources.get(old_value),
-                new_scene.ext_resources.get(new_value),
+            ) => Self::did_ext_resource_reference_change(
+                old_scene.ext_resources.get(*old_value),
+                new_scene.ext_resources.get(*new_value),
             ),
             // No special lookup needed for regular Variants (definitely) or ResourcePaths (I think?)
             (
@@ -682,7 +782,7 @@ impl Differ {
     /// it loads and returns the resource content as a Variant.
     async fn get_prop_value(
         &self,
-        prop_value: &VariantStrValue,
+        prop_value: &VariantStrValue<'_>,
         scene: Option<&GodotScene>,
         is_old: bool,
         is_script: bool,
@@ -693,10 +793,10 @@ impl Differ {
         if is_script {
             return VariantValue::Variant("<Script changed>".to_string());
         }
-        let path;
+        let path: &str;
         match prop_value {
             VariantStrValue::Variant(variant) => {
-                return VariantValue::Variant(variant.clone());
+                return VariantValue::Variant(variant.to_string());
             }
             VariantStrValue::SubResourceID(sub_resource_id) => {
                 // TODO: add this for scene diffs; for scene diffs we want to display the subresource diffs as child nodes of the parent node.
@@ -704,14 +804,14 @@ impl Differ {
                 return VariantValue::Variant(format!("\"<SubResource {} changed>\"", sub_resource_id));
             }
             VariantStrValue::ResourcePath(resource_path) => {
-                path = resource_path;
+                path = *resource_path;
             }
             VariantStrValue::ExtResourceID(ext_resource_id) => {
                 let p = scene.and_then(|scene| {
                     scene
                         .ext_resources
                         .get(ext_resource_id)
-                        .map(|ext_resource| &ext_resource.path)
+                        .map(|ext_resource| ext_resource.path.as_str())
                 });
                 let Some(p) = p else {
                     return VariantValue::Variant("\"<ExtResource not found>\"".to_string());
@@ -723,34 +823,15 @@ impl Differ {
             }
         }
 
-        match self.start_load_ext_resource(&path, if is_old { before } else { after }).await{
-            Ok(load_path) => VariantValue::LazyLoadData(path.clone(), load_path),
+        match self.start_load_ext_resource(path, if is_old { before } else { after }).await{
+            Ok(load_path) => VariantValue::LazyLoadData(path.to_string(), load_path),
             Err(e) => VariantValue::Variant(format!("\"<ExtResource {} load failed ({})>\"", path, e)),
         }
     }
 
-    /// Populates [node_ids], [ext_resource_ids], and [sub_resource_ids] from the
-    /// given scene.
-    fn get_ids_from_scene(
-        scene: &GodotScene,
-        node_ids: &mut HashSet<NodeId>,
-        ext_resource_ids: &mut HashSet<String>,
-        sub_resource_ids: &mut HashSet<String>,
-    ) {
-        for (ext_id, _) in scene.ext_resources.iter() {
-            ext_resource_ids.insert(ext_id.clone());
-        }
-        for (node_id, _) in scene.nodes.iter() {
-            node_ids.insert(node_id.clone());
-        }
-        for (sub_id, _) in scene.sub_resources.iter() {
-            sub_resource_ids.insert(sub_id.clone());
-        }
-    }
-
     /// Parse a prop_value string into a [VariantStrValue] enum.
     // Ideally, the parser would do this for us... but for now, we're doing it ourselves.
-    fn get_varstr_value(prop_value: String) -> VariantStrValue {
+    fn get_varstr_value(prop_value: &str) -> VariantStrValue<'_> {
         if prop_value.starts_with("Resource(")
             || prop_value.starts_with("SubResource(")
             || prop_value.starts_with("ExtResource(")
@@ -762,8 +843,7 @@ impl Differ {
                 .split("\")")
                 .nth(0)
                 .unwrap()
-                .trim()
-                .to_string();
+                .trim();
             if prop_value.contains("SubResource(") {
                 return VariantStrValue::SubResourceID(id);
             } else if prop_value.contains("ExtResource(") {
@@ -773,7 +853,7 @@ impl Differ {
                 // if this is a Resource() with the format "Resource(uid, path)", we need to extract the path
                 if id.contains("\", \"") {
                     // discard the uid
-                    id = id.split("\", \"").nth(1).unwrap().trim().to_string();
+                    id = id.split("\", \"").nth(1).unwrap().trim();
                 }
                 return VariantStrValue::ResourcePath(id);
             }
@@ -0,0 +1,119 @@
+use super::*;
+use crate::parser::godot_parser::parse_scene;
+
+const NODE_COUNT: usize = 1000;
+
+/// Builds a scene with [NODE_COUNT] nodes, each with plain, ext resource and sub resource properties.
+/// [changed_node], if set, gets a different position.
+fn make_scene(changed_node: Option<usize>) -> GodotScene {
+    let mut source = String::from(
+        r#"[gd_scene format=4 uid="uid://b6x3k8a1scene"]
+
+[ext_resource type="Texture2D" uid="uid://c1r8o0ickon" path="res://icon.svg" id="1_icon"]
+
+[sub_resource type="RectangleShape2D" id="RectangleShape2D_shape"]
+size = Vector2(16, 16)
+
+[node name="Root" type="Node2D" unique_id=1]
+"#,
+    );
+    for i in 0..NODE_COUNT {
+        let x = if changed_node == Some(i) { i + 1 } else { i };
+        source.push_str(&format!(
+            r#"
+[node name="Sprite{i}" type="Sprite2D" parent="." unique_id={id}]
+position = Vector2({x}, 0)
+texture = ExtResource("1_icon")
+modulate = Color(1, 0.5, 0.5, 1)
+
+[node name="Shape{i}" type="CollisionShape2D" parent="Sprite{i}" unique_id={shape_id}]
+shape = SubResource("RectangleShape2D_shape")
+"#,
+            id = 10 + i * 2,
+            shape_id = 11 + i * 2,
+        ));
+    }
+    parse_scene(&source).expect("parse should succeed")
+}
+
+#[test]
+fn test_union_keys() {
+    let old = HashMap::from([("a", 1), ("b", 2)]);
+    let new = HashMap::from([("b", 3), ("c", 4)]);
+    let mut keys: Vec<_> = union_keys(Some(&old), Some(&new)).copied().collect();
+    keys.sort();
+    assert_eq!(keys, vec!["a", "b", "c"]);
+    assert_eq!(union_keys(None, Some(&new)).count(), 2);
+    assert_eq!(union_keys::<&str, i32>(None, None).count(), 0);
+}
+
+#[test]
+fn test_changed_node_properties_finds_only_the_change() {
+    let old_scene = make_scene(None);
+    assert!(changed_node_properties(&old_scene, &make_scene(None)).is_empty());
+
+    let new_scene = make_scene(Some(NODE_COUNT / 2));
+    let changed = changed_node_properties(&old_scene, &new_scene);
+    assert_eq!(changed.len(), 1);
+    assert_eq!(changed[0].1, "position");
+}
+
+#[test]
+fn test_structural_hashes_track_referenced_sub_resources() {
+    let old_scene = make_scene(None);
+    let new_scene = parse_scene(
+        &old_scene
+            .serialize()
+            .replace("size = Vector2(16, 16)", "size = Vector2(32, 32)"),
+    )
+    .expect("parse should succeed");
+
+    let mut changed_nodes = 0;
+    for (node_id, old_node) in &old_scene.nodes {
+        let new_node = new_scene.get_node(node_id).expect("node should exist in both scenes");
+        let references_shape = old_node.properties.contains_key("shape");
+        // Only the nodes pointing at the edited shape should need a full comparison.
+        assert_eq!(old_node.structural_hash != new_node.structural_hash, references_shape, "node {}", node_id);
+        if references_shape {
+            changed_nodes += 1;
+        }
+    }
+    assert_eq!(changed_nodes, NODE_COUNT);
+}
+
+/// Builds a scene whose two sub-resources reference each other, with [value] set on the first.
+fn make_cyclic_scene(value: i32) -> GodotScene {
+    parse_scene(&format!(
+        r#"[gd_scene format=4 uid="uid://b6x3k8a1cycle"]
+
+[sub_resource type="Resource" id="Resource_a"]
+next = SubResource("Resource_b")
+value = {value}
+
+[sub_resource type="Resource" id="Resource_b"]
+next = SubResource("Resource_a")
+
+[node name="Root" type="Node" unique_id=1]
+"#
+    ))
+    .expect("parse should succeed")
+}
+
+#[test]
+fn test_sub_resource_cycle_is_not_memoized_as_unchanged() {
+    let old_scene = make_cyclic_scene(1);
+    let new_scene = make_cyclic_scene(2);
+    let mut cache = SubResourceChangeCache::default();
+
+    // Comparing a may visit b, which only looks unchanged because a is assumed unchanged while in progress.
+    assert!(Differ::did_sub_resource_change("Resource_a", "Resource_a", &old_scene, &new_scene, &mut cache));
+    assert!(Differ::did_sub_resource_change("Resource_b", "Resource_b", &old_scene, &new_scene, &mut cache));
+    assert!(cache.in_progress.is_empty());
+    assert!(cache.provisional.is_empty());
+
+    let unchanged_scene = make_cyclic_scene(1);
+    let mut cache = SubResourceChangeCache::default();
+    assert!(!Differ::did_sub_resource_change("Resource_a", "Resource_a", &old_scene, &unchanged_scene, &mut cache));
+    // Once the root of the cycle is known to be unchanged, the rest of the cycle is memoized with it.
+    assert_eq!(cache.results.get(&("Resource_b", "Resource_b")), Some(&false));
+}
@@ -1,11 +1,13 @@
 use std::fmt::Display;
 
+use serde::{Deserialize, Serialize};
+
 use crate::{
     diff::differ::{ChangeType, Differ},
     fs::file_utils::FileContent,
 };
 
-#[derive(Clone, Debug)]
+#[derive(Clone, Debug, Serialize, Deserialize)]
 pub struct TextDiffLine {
     pub new_line_no: i64,
     pub old_line_no: i64,
@@ -13,7 +15,7 @@ pub struct TextDiffLine {
     pub status: String,
 }
 
-#[derive(Clone, Debug)]
+#[derive(Clone, Debug, Serialize, Deserialize)]
 pub struct TextDiffHunk {
     pub new_start: i64,
     pub old_start: i64,
@@ -22,7 +24,7 @@ pub struct TextDiffHunk {
     pub diff_lines: Vec<TextDiffLine>,
 }
 
-#[derive(Clone, Debug)]
+#[derive(Clone, Debug, Serialize, Deserialize)]
 pub struct TextDiff {
     pub path: String,
     pub diff_hunks: Vec<TextDiffHunk>,
@@ -8,6 +8,7 @@ use automerge::ObjId;
 use md5::Digest;
 use samod::{DocumentId};
 use crate::helpers::doc_utils::SimpleDocReader;
+use crate::helpers::metrics::METRICS;
 use crate::helpers::utils::{parse_automerge_url};
 
 use crate::parser::godot_parser::{GodotScene, parse_scene, recognize_scene};
@@ -66,6 +67,7 @@ impl FileContent {
 		if result.is_err() {
 			return Err(std::io::Error::new(std::io::ErrorKind::Other, "Failed to write file"));
 		}
+		METRICS.bytes_written.add(buf.len() as u64);
 		Ok(hash)
 	}
 
@@ -118,7 +120,9 @@ impl FileContent {
 	}
 
 	// NOTE: Probably not appropriate to put here, should have this in BranchState
-	pub fn hydrate_content_at(file_entry: ObjId, doc: &Automerge, path: &str, heads: &Vec<ChangeHash>) -> Result<FileContent, Result<DocumentId, io::Error>> {
+	/// Reads a file entry's content. Binary files live in linked docs, so for those this returns the linked doc,
+	/// and the content hash of the blob inside it if the doc is a bundle of blobs.
+	pub fn hydrate_content_at(file_entry: ObjId, doc: &Automerge, path: &str, heads: &Vec<ChangeHash>) -> Result<FileContent, Result<(DocumentId, Option<String>), io::Error>> {
 		let structured_content = doc
 		.get_at(&file_entry, "structured_content", heads)
 		.unwrap()
@@ -164,7 +168,8 @@ impl FileContent {
 		.get_string_at(&file_entry, "url", &heads)
 		.map(|url| parse_automerge_url(&url)).flatten();
 		if linked_file_content.is_some() {
-			return Err(Ok(linked_file_content.unwrap()));
+			let blob = doc.get_string_at(&file_entry, "blob", &heads);
+			return Err(Ok((linked_file_content.unwrap(), blob)));
 		}
 		Err(Err(io::Error::new(io::ErrorKind::Other, "Failed to url!")))
 
@@ -194,6 +199,8 @@ pub async fn calculate_file_hash(path: &PathBuf) -> Option<Digest> {
 		Err(_) => return None,
 	};
 
+	METRICS.files_hashed.increment();
+	METRICS.bytes_hashed.add(file.len() as u64);
 	return Some(md5::compute(&mut file));
 }
 
@@ -207,6 +214,8 @@ pub async fn get_buffer_and_hash(path: &PathBuf) -> Result<(Vec<u8>, Digest), to
 		return Err(io::Error::new(io::ErrorKind::Other, "Failed to read file"));
 	}
 	let buf = buf.unwrap();
+	METRICS.files_hashed.increment();
+	METRICS.bytes_hashed.add(buf.len() as u64);
 	let hash = md5::compute(&buf);
 	Ok((buf, hash))
 }
@@ -1,4 +1,8 @@
 pub mod tracing;
+pub mod metrics;
+pub mod memory;
+pub mod lock_watch;
+pub mod lru;
 pub mod doc_utils;
 pub mod utils;
 pub mod branch;
@@ -22,6 +22,9 @@ pub struct BranchesMetadataDoc {
     pub main_doc_id: DocumentId,
     #[autosurgeon(with = "crate::helpers::autosurgeon_utils::autosurgeon_branch_map")]
     pub branches: HashMap<DocumentId, Branch>,
+    /// Which storage format every client writes. Missing on projects from before the format was versioned, which
+    /// counts as 0. Only ever raised, and only once every collaborator's client reads the newer format.
+    pub format_version: Option<u64>,
 }
 
 #[derive(Debug, Clone, Reconcile, Hydrate, PartialEq)]
@@ -38,6 +38,11 @@ impl HistoryRef {
         &self.branch
     }
 
+    /// The bytes this ref holds on the heap, for memory accounting.
+    pub fn heap_size(&self) -> usize {
+        self.heads.len() * std::mem::size_of::<ChangeHash>()
+    }
+
     pub fn is_valid(&self) -> bool {
         return !self.heads.is_empty();
     }
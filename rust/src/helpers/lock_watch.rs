@@ -0,0 +1,310 @@
+use std::{
+    backtrace::{Backtrace, BacktraceStatus},
+    collections::HashMap,
+    future::Future,
+    ops::{Deref, DerefMut},
+    panic::Location,
+    sync::{
+        LazyLock, Mutex as StdMutex,
+        atomic::{AtomicBool, AtomicU64, Ordering},
+    },
+    thread::Thread,
+    time::{Duration, Instant},
+};
+
+use tokio::sync::{Mutex, MutexGuard, RwLock, RwLockReadGuard, RwLockWriteGuard};
+use tokio_util::sync::CancellationToken;
+
+use crate::helpers::metrics::METRICS;
+
+/// How long a lock can be waited on or held before we warn about it, in milliseconds. Can be overridden by user configuration.
+pub const DEFAULT_LOCK_HOLD_WARN_MS: u64 = 500;
+/// How long the main thread can block before we warn about it, in milliseconds. Can be overridden by user configuration.
+pub const DEFAULT_MAIN_THREAD_STALL_WARN_MS: u64 = 50;
+/// How often the watchdog checks on held locks and the runtime.
+const WATCHDOG_TICK: Duration = Duration::from_millis(250);
+/// How many independently locked parts the holder registry is split into, so acquires on different threads rarely
+/// contend on it.
+const HOLDER_SHARDS: usize = 16;
+
+static LOCK_HOLD_WARN_MS: AtomicU64 = AtomicU64::new(DEFAULT_LOCK_HOLD_WARN_MS);
+static MAIN_THREAD_STALL_WARN_MS: AtomicU64 = AtomicU64::new(DEFAULT_MAIN_THREAD_STALL_WARN_MS);
+static CAPTURE_BACKTRACES: AtomicBool = AtomicBool::new(false);
+
+pub fn set_thresholds(lock_hold_warn_ms: u64, main_thread_stall_warn_ms: u64) {
+    LOCK_HOLD_WARN_MS.store(lock_hold_warn_ms, Ordering::Relaxed);
+    MAIN_THREAD_STALL_WARN_MS.store(main_thread_stall_warn_ms, Ordering::Relaxed);
+}
+
+/// Whether every lock acquire captures a backtrace, so the watchdog can show where long holds were taken.
+/// Capturing is expensive, so it's off unless configured.
+pub fn set_capture_backtraces(capture: bool) {
+    CAPTURE_BACKTRACES.store(capture, Ordering::Relaxed);
+}
+
+fn lock_hold_threshold() -> Duration {
+    Duration::from_millis(LOCK_HOLD_WARN_MS.load(Ordering::Relaxed))
+}
+
+fn main_thread_stall_threshold() -> Duration {
+    Duration::from_millis(MAIN_THREAD_STALL_WARN_MS.load(Ordering::Relaxed))
+}
+
+/// Who holds a tracked lock, so the watchdog can name them.
+struct Holder {
+    lock: &'static str,
+    location: &'static Location<'static>,
+    thread: Thread,
+    span: Option<&'static str>,
+    since: Instant,
+    /// Only captured when [set_capture_backtraces] is on, since it's expensive.
+    backtrace: Option<Backtrace>,
+    reported: bool,
+}
+
+static HOLDERS: LazyLock<[StdMutex<HashMap<u64, Holder>>; HOLDER_SHARDS]> =
+    LazyLock::new(|| std::array::from_fn(|_| Default::default()));
+static NEXT_HOLD_ID: AtomicU64 = AtomicU64::new(0);
+
+fn holder_shard(id: u64) -> &'static StdMutex<HashMap<u64, Holder>> {
+    &HOLDERS[id as usize % HOLDER_SHARDS]
+}
+
+/// Registers a lock as held until dropped, and records how long it was held.
+struct Hold {
+    id: u64,
+    lock: &'static str,
+    location: &'static Location<'static>,
+    since: Instant,
+}
+
+impl Hold {
+    fn start(
+        lock: &'static str,
+        location: &'static Location<'static>,
+        wait_start: Instant,
+    ) -> Self {
+        let since = Instant::now();
+        let waited = since - wait_start;
+        METRICS.lock_wait_duration.record(waited.as_micros() as u64);
+        if waited > lock_hold_threshold() {
+            tracing::warn!("Waited {waited:?} for lock {lock} at {location}");
+        }
+
+        let id = NEXT_HOLD_ID.fetch_add(1, Ordering::Relaxed);
+        holder_shard(id).lock().unwrap().insert(
+            id,
+            Holder {
+                lock,
+                location,
+                thread: std::thread::current(),
+                span: tracing::Span::current()
+                    .metadata()
+                    .map(|metadata| metadata.name()),
+                since,
+                backtrace: CAPTURE_BACKTRACES
+                    .load(Ordering::Relaxed)
+                    .then(Backtrace::force_capture),
+                reported: false,
+            },
+        );
+        Self {
+            id,
+            lock,
+            location,
+            since,
+        }
+    }
+}
+
+impl Drop for Hold {
+    fn drop(&mut self) {
+        holder_shard(self.id).lock().unwrap().remove(&self.id);
+        let held = self.since.elapsed();
+        METRICS.lock_hold_duration.record(held.as_micros() as u64);
+        if held > lock_hold_threshold() {
+            METRICS.long_lock_holds.increment();
+            tracing::warn!(
+                "Lock {} was held for {held:?} at {}",
+                self.lock,
+                self.location
+            );
+        }
+    }
+}
+
+/// A guard of a tracked lock. Derefs to the guarded value.
+pub struct Tracked<G> {
+    guard: G,
+    _hold: Hold,
+}
+
+impl<G: Deref> Deref for Tracked<G> {
+    type Target = G::Target;
+
+    fn deref(&self) -> &Self::Target {
+        &self.guard
+    }
+}
+
+impl<G: DerefMut> DerefMut for Tracked<G> {
+    fn deref_mut(&mut self) -> &mut Self::Target {
+        &mut self.guard
+    }
+}
+
+/// A tokio [Mutex] that records how long it's waited on and held, and tells the watchdog who holds it.
+#[derive(Debug)]
+pub struct TrackedMutex<T> {
+    name: &'static str,
+    inner: Mutex<T>,
+}
+
+impl<T> TrackedMutex<T> {
+    pub fn new(name: &'static str, value: T) -> Self {
+        Self {
+            name,
+            inner: Mutex::new(value),
+        }
+    }
+
+    #[track_caller]
+    pub fn lock(&self) -> impl Future<Output = Tracked<MutexGuard<'_, T>>> {
+        let location = Location::caller();
+        async move {
+            let start = Instant::now();
+            let guard = self.inner.lock().await;
+            Tracked {
+                guard,
+                _hold: Hold::start(self.name, location, start),
+            }
+        }
+    }
+
+    /// Locks from outside the runtime, e.g. in [tokio::task::spawn_blocking].
+    #[track_caller]
+    pub fn blocking_lock(&self) -> Tracked<MutexGuard<'_, T>> {
+        let location = Location::caller();
+        let start = Instant::now();
+        let guard = self.inner.blocking_lock();
+        Tracked {
+            guard,
+            _hold: Hold::start(self.name, location, start),
+        }
+    }
+}
+
+/// A tokio [RwLock] that records how long it's waited on and held, and tells the watchdog who holds it.
+#[derive(Debug)]
+pub struct TrackedRwLock<T> {
+    name: &'static str,
+    inner: RwLock<T>,
+}
+
+impl<T> TrackedRwLock<T> {
+    pub fn new(name: &'static str, value: T) -> Self {
+        Self {
+            name,
+            inner: RwLock::new(value),
+        }
+    }
+
+    #[track_caller]
+    pub fn read(&self) -> impl Future<Output = Tracked<RwLockReadGuard<'_, T>>> {
+        let location = Location::caller();
+        async move {
+            let start = Instant::now();
+            let guard = self.inner.read().await;
+            Tracked {
+                guard,
+                _hold: Hold::start(self.name, location, start),
+            }
+        }
+    }
+
+    #[track_caller]
+    pub fn write(&self) -> impl Future<Output = Tracked<RwLockWriteGuard<'_, T>>> {
+        let location = Location::caller();
+        async move {
+            let start = Instant::now();
+            let guard = self.inner.write().await;
+            Tracked {
+                guard,
+                _hold: Hold::start(self.name, location, start),
+            }
+        }
+    }
+}
+
+/// Times something that blocks the main thread, and warns if it stalled the editor for too long.
+pub struct MainThreadStall<'a> {
+    operation: &'a str,
+    start: Instant,
+}
+
+impl<'a> MainThreadStall<'a> {
+    pub fn start(operation: &'a str) -> Self {
+        Self {
+            operation,
+            start: Instant::now(),
+        }
+    }
+}
+
+impl Drop for MainThreadStall<'_> {
+    fn drop(&mut self) {
+        let elapsed = self.start.elapsed();
+        METRICS
+            .main_thread_block_duration
+            .record(elapsed.as_micros() as u64);
+        if elapsed > main_thread_stall_threshold() {
+            METRICS.main_thread_stalls.increment();
+            tracing::warn!("Main thread stalled for {elapsed:?} on {}", self.operation);
+        }
+    }
+}
+
+/// Reports locks held past the threshold, with their owners, and notices when the runtime stops polling tasks.
+/// Runs until [token] is cancelled.
+pub async fn run_watchdog(token: CancellationToken) {
+    loop {
+        let expected = Instant::now() + WATCHDOG_TICK;
+        tokio::select! {
+            _ = token.cancelled() => break,
+            _ = tokio::time::sleep(WATCHDOG_TICK) => {}
+        }
+        // If we woke up late, something kept the runtime from polling us.
+        let late = Instant::now().saturating_duration_since(expected);
+        if late > lock_hold_threshold() {
+            tracing::warn!("Runtime stalled for {late:?}; a task is blocking a worker thread");
+        }
+        report_long_holds();
+    }
+}
+
+fn report_long_holds() {
+    let threshold = lock_hold_threshold();
+    for shard in HOLDERS.iter() {
+        let mut holders = shard.lock().unwrap();
+        for holder in holders.values_mut() {
+            let held = holder.since.elapsed();
+            if holder.reported || held <= threshold {
+                continue;
+            }
+            holder.reported = true;
+            let backtrace = match &holder.backtrace {
+                Some(backtrace) if backtrace.status() == BacktraceStatus::Captured => {
+                    format!("\n{backtrace}")
+                }
+                _ => String::new(),
+            };
+            tracing::warn!(
+                "Lock {} has been held for {held:?} at {}, on thread {}, in span {}{backtrace}",
+                holder.lock,
+                holder.location,
+                holder.thread.name().unwrap_or("unnamed"),
+                holder.span.unwrap_or("none"),
+            );
+        }
+    }
+}
@@ -0,0 +1,249 @@
+use std::{borrow::Borrow, collections::HashMap, hash::Hash};
+
+/// Marks the end of the recency list.
+const NIL: usize = usize::MAX;
+
+/// A least recently used map, bounded by the total weight of its entries.
+/// Lookups, promotions, inserts and evictions are all O(1): entries live in a slab, linked from most to least recently
+/// used, and the map only points into the slab.
+#[derive(Debug)]
+pub struct Lru<K, V> {
+    index: HashMap<K, usize>,
+    slots: Vec<Option<Slot<K, V>>>,
+    /// Slots freed by removals, reused before the slab grows.
+    free: Vec<usize>,
+    /// The most recently used entry.
+    head: usize,
+    /// The least recently used entry, which is evicted first.
+    tail: usize,
+    weight: usize,
+    capacity: usize,
+}
+
+#[derive(Debug)]
+struct Slot<K, V> {
+    key: K,
+    value: V,
+    weight: usize,
+    prev: usize,
+    next: usize,
+}
+
+impl<K: Hash + Eq + Clone, V> Lru<K, V> {
+    /// Creates a map that evicts entries once their total weight passes [capacity].
+    pub fn new(capacity: usize) -> Self {
+        Self {
+            index: HashMap::new(),
+            slots: Vec::new(),
+            free: Vec::new(),
+            head: NIL,
+            tail: NIL,
+            weight: 0,
+            capacity,
+        }
+    }
+
+    pub fn len(&self) -> usize {
+        self.index.len()
+    }
+
+    /// The total weight of every entry.
+    pub fn weight(&self) -> usize {
+        self.weight
+    }
+
+    pub fn capacity(&self) -> usize {
+        self.capacity
+    }
+
+    pub fn contains_key<Q>(&self, key: &Q) -> bool
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        self.index.contains_key(key)
+    }
+
+    /// Returns an entry and marks it as the most recently used.
+    pub fn get<Q>(&mut self, key: &Q) -> Option<&V>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        let slot = *self.index.get(key)?;
+        self.unlink(slot);
+        self.push_front(slot);
+        self.slots[slot].as_ref().map(|slot| &slot.value)
+    }
+
+    /// Returns an entry without changing its recency.
+    #[cfg(test)]
+    pub fn peek<Q>(&self, key: &Q) -> Option<&V>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        let slot = *self.index.get(key)?;
+        self.slots[slot].as_ref().map(|slot| &slot.value)
+    }
+
+    /// Adds or replaces an entry as the most recently used, then evicts the least recently used entries until the map
+    /// is back within capacity. Returns the evicted entries. An entry heavier than the whole capacity isn't added.
+    pub fn insert(&mut self, key: K, value: V, weight: usize) -> Vec<(K, V)> {
+        self.remove(&key);
+        if weight > self.capacity {
+            return Vec::new();
+        }
+        let slot = Slot {
+            key: key.clone(),
+            value,
+            weight,
+            prev: NIL,
+            next: NIL,
+        };
+        let index = match self.free.pop() {
+            Some(index) => {
+                self.slots[index] = Some(slot);
+                index
+            }
+            None => {
+                self.slots.push(Some(slot));
+                self.slots.len() - 1
+            }
+        };
+        self.index.insert(key, index);
+        self.push_front(index);
+        self.weight += weight;
+
+        let mut evicted = Vec::new();
+        while self.weight > self.capacity {
+            match self.pop_lru() {
+                Some(entry) => evicted.push(entry),
+                None => break,
+            }
+        }
+        evicted
+    }
+
+    pub fn remove<Q>(&mut self, key: &Q) -> Option<V>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        let slot = self.index.remove(key)?;
+        self.take_slot(slot).map(|(_, value)| value)
+    }
+
+    /// Removes and returns the least recently used entry.
+    pub fn pop_lru(&mut self) -> Option<(K, V)> {
+        if self.tail == NIL {
+            return None;
+        }
+        let slot = self.tail;
+        let entry = self.take_slot(slot)?;
+        self.index.remove(&entry.0);
+        Some(entry)
+    }
+
+    pub fn clear(&mut self) {
+        self.index.clear();
+        self.slots.clear();
+        self.free.clear();
+        self.head = NIL;
+        self.tail = NIL;
+        self.weight = 0;
+    }
+
+    fn take_slot(&mut self, slot: usize) -> Option<(K, V)> {
+        self.unlink(slot);
+        let taken = self.slots[slot].take()?;
+        self.free.push(slot);
+        self.weight -= taken.weight;
+        Some((taken.key, taken.value))
+    }
+
+    fn unlink(&mut self, slot: usize) {
+        let Some((prev, next)) = self.slots[slot].as_ref().map(|slot| (slot.prev, slot.next))
+        else {
+            return;
+        };
+        match prev {
+            NIL => self.head = next,
+            prev => self.slots[prev].as_mut().unwrap().next = next,
+        }
+        match next {
+            NIL => self.tail = prev,
+            next => self.slots[next].as_mut().unwrap().prev = prev,
+        }
+    }
+
+    fn push_front(&mut self, slot: usize) {
+        let head = self.head;
+        if let Some(entry) = self.slots[slot].as_mut() {
+            entry.prev = NIL;
+            entry.next = head;
+        }
+        match head {
+            NIL => self.tail = slot,
+            head => self.slots[head].as_mut().unwrap().prev = slot,
+        }
+        self.head = slot;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_evicts_least_recently_used() {
+        let mut lru = Lru::new(3);
+        lru.insert("a", 1, 1);
+        lru.insert("b", 2, 1);
+        lru.insert("c", 3, 1);
+        assert_eq!(lru.get("a"), Some(&1));
+
+        let evicted = lru.insert("d", 4, 1);
+        assert_eq!(evicted, vec![("b", 2)]);
+        assert!(!lru.contains_key("b"));
+        assert_eq!(lru.len(), 3);
+        assert_eq!(lru.pop_lru(), Some(("c", 3)));
+        assert_eq!(lru.pop_lru(), Some(("a", 1)));
+        assert_eq!(lru.pop_lru(), Some(("d", 4)));
+        assert_eq!(lru.pop_lru(), None);
+    }
+
+    #[test]
+    fn test_weighs_entries() {
+        let mut lru = Lru::new(10);
+        lru.insert("a", (), 4);
+        lru.insert("b", (), 4);
+        assert_eq!(lru.weight(), 8);
+
+        // Replacing an entry replaces its weight.
+        lru.insert("a", (), 2);
+        assert_eq!(lru.weight(), 6);
+
+        let evicted = lru.insert("c", (), 6);
+        assert_eq!(evicted, vec![("b", ())]);
+        assert_eq!(lru.weight(), 8);
+
+        // Too heavy to ever fit, so it's dropped rather than flushing everything else.
+        assert!(lru.insert("d", (), 11).is_empty());
+        assert!(!lru.contains_key("d"));
+        assert_eq!(lru.len(), 2);
+    }
+
+    #[test]
+    fn test_reuses_removed_slots() {
+        let mut lru = Lru::new(usize::MAX);
+        for i in 0..100 {
+            lru.insert(i, i, 1);
+            assert_eq!(lru.remove(&i), Some(i));
+        }
+        assert_eq!(lru.slots.len(), 1);
+        assert_eq!(lru.peek(&0), None);
+        assert_eq!(lru.len(), 0);
+        assert_eq!(lru.weight(), 0);
+    }
+}
@@ -0,0 +1,128 @@
+use std::{collections::HashMap, mem::size_of, ops::AddAssign};
+
+use automerge::ChangeHash;
+use samod::DocumentId;
+use serde::Serialize;
+
+use crate::{fs::file_utils::FileContent, helpers::metrics::METRICS};
+
+/// Roughly how much memory one subsystem holds. Sizes count the payload, not allocator or map overhead.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Serialize)]
+pub struct MemoryUsage {
+    pub entries: usize,
+    pub bytes: usize,
+}
+
+impl MemoryUsage {
+    /// Counts one entry of [bytes].
+    pub fn add(&mut self, bytes: usize) {
+        self.entries += 1;
+        self.bytes += bytes;
+    }
+}
+
+impl AddAssign for MemoryUsage {
+    fn add_assign(&mut self, other: Self) {
+        self.entries += other.entries;
+        self.bytes += other.bytes;
+    }
+}
+
+/// Memory held by each subsystem, so a growing editor can be pinned on one of them.
+#[derive(Debug, Clone, Default, Serialize)]
+pub struct MemoryReport {
+    /// Shadow and canonical branch docs, by saved size, which understates their size in memory but grows with it.
+    /// Saving walks every doc, so this is only measured on request.
+    pub branch_docs: Option<MemoryUsage>,
+    /// Binary docs, by saved size. Only measured on request, like [Self::branch_docs].
+    pub binary_docs: Option<MemoryUsage>,
+    /// Paths and hashes of every file the filesystem watcher is tracking.
+    pub fs_watcher: MemoryUsage,
+    /// File contents read by the watcher and waiting to be committed.
+    pub pending_changes: MemoryUsage,
+    /// The change ingester's history of the checked out branch.
+    pub history: MemoryUsage,
+    pub diff_cache: MemoryUsage,
+    /// Resource metadata and import settings cached for the resource loader.
+    pub loader_caches: MemoryUsage,
+}
+
+impl MemoryReport {
+    /// Copies the report into the `memory_*` gauges, so it shows up in metrics snapshots.
+    /// Docs that weren't measured keep their last measurement.
+    pub fn publish(&self) {
+        if let Some(branch_docs) = self.branch_docs {
+            METRICS.memory_branch_docs.set(branch_docs.bytes as i64);
+        }
+        if let Some(binary_docs) = self.binary_docs {
+            METRICS.memory_binary_docs.set(binary_docs.bytes as i64);
+        }
+        METRICS.memory_fs_watcher.set(self.fs_watcher.bytes as i64);
+        METRICS
+            .memory_pending_changes
+            .set(self.pending_changes.bytes as i64);
+        METRICS.memory_history.set(self.history.bytes as i64);
+        METRICS.memory_diff_cache.set(self.diff_cache.bytes as i64);
+        METRICS
+            .memory_loader_caches
+            .set(self.loader_caches.bytes as i64);
+    }
+}
+
+/// The bytes a value holds on the heap, for memory accounting. Only walks the value, so it's much cheaper than
+/// measuring its serialized size.
+pub trait HeapSize {
+    fn heap_size(&self) -> usize;
+}
+
+/// Types that keep everything inline, or close enough for accounting.
+macro_rules! impl_inline_heap_size {
+    ($($ty:ty),*) => {
+        $(impl HeapSize for $ty {
+            fn heap_size(&self) -> usize {
+                0
+            }
+        })*
+    };
+}
+
+impl_inline_heap_size!(bool, i32, i64, u64, ChangeHash, DocumentId);
+
+impl HeapSize for String {
+    fn heap_size(&self) -> usize {
+        self.capacity()
+    }
+}
+
+impl<T: HeapSize> HeapSize for Option<T> {
+    fn heap_size(&self) -> usize {
+        self.as_ref().map_or(0, T::heap_size)
+    }
+}
+
+impl<T: HeapSize> HeapSize for Vec<T> {
+    fn heap_size(&self) -> usize {
+        self.capacity() * size_of::<T>() + self.iter().map(T::heap_size).sum::<usize>()
+    }
+}
+
+impl<K: HeapSize, V: HeapSize> HeapSize for HashMap<K, V> {
+    fn heap_size(&self) -> usize {
+        self.capacity() * size_of::<(K, V)>()
+            + self
+                .iter()
+                .map(|(key, value)| key.heap_size() + value.heap_size())
+                .sum::<usize>()
+    }
+}
+
+impl HeapSize for FileContent {
+    fn heap_size(&self) -> usize {
+        match self {
+            FileContent::String(s) => s.heap_size(),
+            FileContent::Binary(bytes) => bytes.capacity(),
+            FileContent::Scene(scene) => scene.heap_size(),
+            FileContent::Deleted => 0,
+        }
+    }
+}
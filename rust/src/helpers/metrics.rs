@@ -0,0 +1,269 @@
+use std::{
+    path::Path,
+    sync::atomic::{AtomicI64, AtomicU64, Ordering},
+    time::Instant,
+};
+
+use indexmap::IndexMap;
+use serde::Serialize;
+
+/// A count that only goes up, e.g. commits made.
+#[derive(Debug)]
+pub struct Counter(AtomicU64);
+
+impl Counter {
+    const fn new() -> Self {
+        Self(AtomicU64::new(0))
+    }
+
+    pub fn increment(&self) {
+        self.add(1);
+    }
+
+    pub fn add(&self, n: u64) {
+        self.0.fetch_add(n, Ordering::Relaxed);
+    }
+
+    pub fn get(&self) -> u64 {
+        self.0.load(Ordering::Relaxed)
+    }
+}
+
+/// A value that goes up and down, e.g. binary docs we're waiting on.
+#[derive(Debug)]
+pub struct Gauge(AtomicI64);
+
+impl Gauge {
+    const fn new() -> Self {
+        Self(AtomicI64::new(0))
+    }
+
+    pub fn set(&self, value: i64) {
+        self.0.store(value, Ordering::Relaxed);
+    }
+
+    pub fn add(&self, delta: i64) {
+        self.0.fetch_add(delta, Ordering::Relaxed);
+    }
+
+    pub fn get(&self) -> i64 {
+        self.0.load(Ordering::Relaxed)
+    }
+}
+
+/// Bucket `i` holds values below `2^i`, so 32 buckets cover durations up to about 35 minutes in microseconds.
+const HISTOGRAM_BUCKETS: usize = 32;
+
+/// A distribution of durations, in microseconds, kept in power-of-two buckets.
+/// Percentiles are approximate: they report the upper bound of the bucket they fall in.
+#[derive(Debug)]
+pub struct Histogram {
+    buckets: [AtomicU64; HISTOGRAM_BUCKETS],
+    sum: AtomicU64,
+    max: AtomicU64,
+}
+
+impl Histogram {
+    const fn new() -> Self {
+        Self {
+            buckets: [const { AtomicU64::new(0) }; HISTOGRAM_BUCKETS],
+            sum: AtomicU64::new(0),
+            max: AtomicU64::new(0),
+        }
+    }
+
+    pub fn record(&self, micros: u64) {
+        let bucket = (u64::BITS - micros.leading_zeros()) as usize;
+        self.buckets[bucket.min(HISTOGRAM_BUCKETS - 1)].fetch_add(1, Ordering::Relaxed);
+        self.sum.fetch_add(micros, Ordering::Relaxed);
+        self.max.fetch_max(micros, Ordering::Relaxed);
+    }
+
+    /// Records the time until the returned timer is dropped.
+    pub fn start_timer(&self) -> HistogramTimer<'_> {
+        HistogramTimer {
+            histogram: self,
+            start: Instant::now(),
+        }
+    }
+
+    fn snapshot(&self) -> HistogramSnapshot {
+        let buckets: Vec<u64> = self
+            .buckets
+            .iter()
+            .map(|bucket| bucket.load(Ordering::Relaxed))
+            .collect();
+        let count: u64 = buckets.iter().sum();
+        let percentile = |p: f64| -> u64 {
+            let rank = (count as f64 * p).ceil() as u64;
+            let mut seen = 0;
+            for (i, bucket) in buckets.iter().enumerate() {
+                seen += bucket;
+                if seen >= rank && *bucket > 0 {
+                    return (1u64 << i) - 1;
+                }
+            }
+            0
+        };
+        let sum = self.sum.load(Ordering::Relaxed);
+        HistogramSnapshot {
+            count,
+            sum,
+            mean: if count > 0 { sum / count } else { 0 },
+            p50: percentile(0.5),
+            p90: percentile(0.9),
+            p99: percentile(0.99),
+            max: self.max.load(Ordering::Relaxed),
+        }
+    }
+}
+
+/// Records how long it was alive into a [Histogram].
+pub struct HistogramTimer<'a> {
+    histogram: &'a Histogram,
+    start: Instant,
+}
+
+impl Drop for HistogramTimer<'_> {
+    fn drop(&mut self) {
+        self.histogram
+            .record(self.start.elapsed().as_micros() as u64);
+    }
+}
+
+/// A [Histogram] at one point in time. All values are in microseconds.
+#[derive(Debug, Clone, Serialize)]
+pub struct HistogramSnapshot {
+    pub count: u64,
+    pub sum: u64,
+    pub mean: u64,
+    pub p50: u64,
+    pub p90: u64,
+    pub p99: u64,
+    pub max: u64,
+}
+
+/// Every metric at one point in time.
+#[derive(Debug, Clone, Serialize)]
+pub struct MetricsSnapshot {
+    /// Seconds since the Unix epoch.
+    pub timestamp: u64,
+    pub counters: IndexMap<&'static str, u64>,
+    pub gauges: IndexMap<&'static str, i64>,
+    pub histograms: IndexMap<&'static str, HistogramSnapshot>,
+}
+
+macro_rules! metrics {
+    (
+        counters { $($(#[$counter_doc:meta])* $counter:ident,)* }
+        gauges { $($(#[$gauge_doc:meta])* $gauge:ident,)* }
+        histograms { $($(#[$histogram_doc:meta])* $histogram:ident,)* }
+    ) => {
+        /// Counters, gauges and histograms for the sync, commit, diff and watcher pipelines.
+        /// Every metric is a plain atomic, so recording never takes a lock.
+        #[derive(Debug)]
+        pub struct Metrics {
+            $($(#[$counter_doc])* pub $counter: Counter,)*
+            $($(#[$gauge_doc])* pub $gauge: Gauge,)*
+            $($(#[$histogram_doc])* pub $histogram: Histogram,)*
+        }
+
+        impl Metrics {
+            const fn new() -> Self {
+                Self {
+                    $($counter: Counter::new(),)*
+                    $($gauge: Gauge::new(),)*
+                    $($histogram: Histogram::new(),)*
+                }
+            }
+
+            pub fn snapshot(&self) -> MetricsSnapshot {
+                MetricsSnapshot {
+                    timestamp: std::time::SystemTime::now()
+                        .duration_since(std::time::UNIX_EPOCH)
+                        .map(|duration| duration.as_secs())
+                        .unwrap_or_default(),
+                    counters: IndexMap::from([$((stringify!($counter), self.$counter.get()),)*]),
+                    gauges: IndexMap::from([$((stringify!($gauge), self.$gauge.get()),)*]),
+                    histograms: IndexMap::from([$((stringify!($histogram), self.$histogram.snapshot()),)*]),
+                }
+            }
+        }
+    };
+}
+
+metrics! {
+    counters {
+        /// Commits made to a branch, see [crate::project::branch_db::BranchDb::commit_fs_changes].
+        commits,
+        files_committed,
+        binary_docs_created,
+        binary_bytes_created,
+        /// Small binary files packed into bundle docs instead of docs of their own.
+        binary_files_bundled,
+        reconciles,
+        /// Files read and hashed by the filesystem watcher.
+        files_hashed,
+        bytes_hashed,
+        /// Meaningful filesystem changes the watcher emitted.
+        fs_events,
+        checkouts,
+        files_written,
+        bytes_written,
+        files_deleted,
+        /// Files a checkout didn't write because they were already up to date.
+        writes_skipped,
+        /// Times the change ingester rebuilt the history.
+        ingests,
+        diffs,
+        files_diffed,
+        /// Tracked locks held longer than the warning threshold, see [crate::helpers::lock_watch].
+        long_lock_holds,
+        /// Blocking operations on the main thread that took longer than the warning threshold.
+        main_thread_stalls,
+    }
+    gauges {
+        /// Binary docs that branches are waiting on before they can reconcile.
+        binary_docs_waiting,
+        /// Branch and binary docs queued to be fetched from the repo, see [crate::project::document_watcher].
+        docs_queued_for_fetch,
+        /// Bytes the server hasn't acknowledged, and bytes it acknowledges per second, see [crate::project::connection::ConnectionMonitor].
+        connection_outstanding_bytes,
+        connection_upload_rate,
+        /// Filesystem changes waiting to be committed.
+        pending_fs_changes,
+        /// Bytes held by each subsystem, see [crate::helpers::memory::MemoryReport].
+        memory_branch_docs,
+        memory_binary_docs,
+        memory_fs_watcher,
+        memory_pending_changes,
+        memory_history,
+        memory_diff_cache,
+        memory_loader_caches,
+    }
+    histograms {
+        commit_duration,
+        reconcile_duration,
+        checkout_duration,
+        ingest_duration,
+        diff_duration,
+        /// How long tracked locks are waited on and held.
+        lock_wait_duration,
+        lock_hold_duration,
+        /// How long the main thread blocks on the runtime each time it does.
+        main_thread_block_duration,
+        /// How long the server takes to acknowledge a document we send.
+        connection_rtt,
+    }
+}
+
+impl Metrics {
+    /// Writes a snapshot to [path] as JSON, replacing the previous one.
+    pub fn dump(&self, path: &Path) -> std::io::Result<()> {
+        let json = serde_json::to_string_pretty(&self.snapshot())?;
+        std::fs::write(path, json)
+    }
+}
+
+/// The global metrics. Recording is lock-free, so this is safe to use from any thread, including hot paths.
+pub static METRICS: Metrics = Metrics::new();
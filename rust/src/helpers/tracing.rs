@@ -1,5 +1,9 @@
 use std::fmt;
 use std::io::Write;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicU32, Ordering};
+use std::sync::{Arc, Mutex, OnceLock};
+use std::time::Duration;
 
 use godot::classes::ProjectSettings;
 use godot::obj::Singleton;
@@ -8,9 +12,15 @@ use tracing_subscriber::{
     EnvFilter, Layer,
     fmt::{format::Writer, time::FormatTime},
     layer::SubscriberExt,
+    reload,
     util::SubscriberInitExt,
 };
 
+use crate::helpers::tracing::{chrome_trace::ChromeTrace, sampling::HotSpanSampler};
+
+mod chrome_trace;
+mod sampling;
+
 fn get_user_dir() -> String {
     let user_dir = ProjectSettings::singleton()
         .globalize_path("user://")
@@ -24,6 +34,52 @@ impl FormatTime for CompactTime {
         write!(w, "{}", TimeNoDate::from(std::time::SystemTime::now()))
     }
 }
+
+/// How the tracing layers filter and sample, as set in the user's `PatchworkConfig`.
+/// Filters use the `RUST_LOG` directive syntax, e.g. `info,patchwork_rust_core=trace`.
+#[derive(Debug, Clone, PartialEq)]
+pub struct TracingConfig {
+    pub stdout_filter: String,
+    pub file_filter: String,
+    /// What a trace capture records. See [start_trace_capture].
+    pub trace_filter: String,
+    /// How many of each per-frame span are recorded per second. 0 records all of them.
+    pub hot_span_rate: u32,
+    /// If set, a trace is captured to this path from startup, for [Self::startup_trace_seconds].
+    pub startup_trace_path: String,
+    pub startup_trace_seconds: f64,
+}
+
+impl Default for TracingConfig {
+    fn default() -> Self {
+        Self {
+            stdout_filter: "info,patchwork_rust_core=debug,samod=info,samod_core=info".to_string(),
+            file_filter: "info,patchwork_rust_core=debug,samod=info,samod_core=info".to_string(),
+            trace_filter: "info,patchwork_rust_core=debug".to_string(),
+            hot_span_rate: 2,
+            startup_trace_path: String::new(),
+            startup_trace_seconds: 30.0,
+        }
+    }
+}
+
+type ReloadFilter = Box<dyn Fn(EnvFilter) -> Result<(), reload::Error> + Send + Sync>;
+
+/// What we need to change the tracing layers after they've been installed.
+struct TracingHandles {
+    stdout_filter: ReloadFilter,
+    file_filter: ReloadFilter,
+    trace_filter: ReloadFilter,
+    hot_span_rate: Arc<AtomicU32>,
+    chrome_trace: ChromeTrace,
+    config: Mutex<TracingConfig>,
+}
+
+static TRACING: OnceLock<TracingHandles> = OnceLock::new();
+
+/// The trace layer records nothing until a capture starts, so its spans aren't even created.
+const TRACE_FILTER_OFF: &str = "off";
+
 static mut M_FILE_WRITER_MUTEX: Option<WorkerGuard> = None;
 pub fn initialize_tracing() {
     let file_appender = tracing_appender::rolling::daily(get_user_dir(), "patchwork.log");
@@ -34,29 +90,27 @@ pub fn initialize_tracing() {
     }
     println!("!!! Logging to {:?}/patchwork.log", get_user_dir());
 
+    // The real config is applied once PatchworkConfig is registered, see [apply_tracing_config].
+    let config = TracingConfig::default();
+    let (stdout_filter, stdout_handle) = reload::Layer::new(EnvFilter::new(&config.stdout_filter));
+    let (file_filter, file_handle) = reload::Layer::new(EnvFilter::new(&config.file_filter));
+    let (trace_filter, trace_handle) = reload::Layer::new(EnvFilter::new(TRACE_FILTER_OFF));
+    let hot_span_rate = Arc::new(AtomicU32::new(config.hot_span_rate));
+    let chrome_trace = ChromeTrace::default();
+
+    let sampler = HotSpanSampler::new(hot_span_rate.clone());
     let stdout_layer = tracing_subscriber::fmt::layer()
         .with_timer(CompactTime)
         .compact()
         // .with_span_events(FmtSpan::ENTER | FmtSpan::CLOSE)
         .with_writer(CustomStdoutWriter::custom_stdout)
-        .with_filter(
-            EnvFilter::new("info")
-                // .add_directive("tokio=trace".parse().unwrap())
-                // .add_directive("runtime=trace".parse().unwrap())
-                .add_directive("patchwork_rust_core=debug".parse().unwrap())
-                .add_directive("samod=info".parse().unwrap())
-                .add_directive("samod_core=info".parse().unwrap()),
-        );
+        .with_filter(stdout_filter);
     let file_layer = tracing_subscriber::fmt::layer()
         .with_line_number(true)
         .with_ansi(false)
         .with_writer(non_blocking_file_writer.clone())
-        .with_filter(
-            EnvFilter::new("info")
-                .add_directive("patchwork_rust_core=trace".parse().unwrap())
-                .add_directive("samod=info".parse().unwrap())
-                .add_directive("samod_core=info".parse().unwrap()),
-        );
+        .with_filter(file_filter);
+    let trace_layer = chrome_trace.layer().with_filter(trace_filter);
 
     #[cfg(feature = "tokio-console")]
     let subscriber = tracing_subscriber::registry()
@@ -65,23 +119,120 @@ pub fn initialize_tracing() {
                 .with_default_env()
                 .spawn(),
         )
+        .with(sampler)
         .with(stdout_layer)
         .with(file_layer)
+        .with(trace_layer)
         .try_init();
 
     #[cfg(not(feature = "tokio-console"))]
     let subscriber = tracing_subscriber::registry()
+        .with(sampler)
         .with(stdout_layer)
         .with(file_layer)
+        .with(trace_layer)
         .try_init();
 
     if let Err(e) = subscriber {
         tracing::error!("Failed to initialize tracing subscriber: {:?}", e);
     } else {
+        _ = TRACING.set(TracingHandles {
+            stdout_filter: Box::new(move |filter| stdout_handle.reload(filter)),
+            file_filter: Box::new(move |filter| file_handle.reload(filter)),
+            trace_filter: Box::new(move |filter| trace_handle.reload(filter)),
+            hot_span_rate,
+            chrome_trace,
+            config: Mutex::new(config),
+        });
         tracing::info!("Tracing subscriber initialized");
     }
 }
 
+/// Parses [directives] and swaps them into a layer's filter. Bad directives leave the old filter in place.
+fn reload_filter(reload: &ReloadFilter, name: &str, directives: &str) {
+    let filter = match EnvFilter::try_new(directives) {
+        Ok(filter) => filter,
+        Err(e) => {
+            tracing::error!("Invalid {name} filter {directives:?}: {e}");
+            return;
+        }
+    };
+    if let Err(e) = reload(filter) {
+        tracing::error!("Failed to reload {name} filter: {e}");
+    }
+}
+
+/// Applies [config] to the installed tracing layers, without restarting anything.
+pub fn apply_tracing_config(config: &TracingConfig) {
+    let Some(handles) = TRACING.get() else {
+        return;
+    };
+    let mut current = handles.config.lock().unwrap();
+    if *current == *config {
+        return;
+    }
+    if current.stdout_filter != config.stdout_filter {
+        reload_filter(&handles.stdout_filter, "stdout", &config.stdout_filter);
+    }
+    if current.file_filter != config.file_filter {
+        reload_filter(&handles.file_filter, "log file", &config.file_filter);
+    }
+    if current.trace_filter != config.trace_filter && handles.chrome_trace.is_capturing() {
+        reload_filter(&handles.trace_filter, "trace", &config.trace_filter);
+    }
+    handles
+        .hot_span_rate
+        .store(config.hot_span_rate, Ordering::Relaxed);
+    *current = config.clone();
+    tracing::info!("Tracing config applied: {:?}", config);
+}
+
+/// Starts recording spans to [path] in the Chrome trace event format, which Perfetto can open.
+/// The capture stops after [seconds], or when [stop_trace_capture] is called if [seconds] isn't positive.
+pub fn start_trace_capture(path: &Path, seconds: f64) -> bool {
+    let Some(handles) = TRACING.get() else {
+        return false;
+    };
+    let duration = (seconds > 0.0).then(|| Duration::from_secs_f64(seconds));
+    if let Err(e) = handles.chrome_trace.start(path, duration) {
+        tracing::error!("Failed to start trace capture at {path:?}: {e}");
+        return false;
+    }
+    let trace_filter = handles.config.lock().unwrap().trace_filter.clone();
+    reload_filter(&handles.trace_filter, "trace", &trace_filter);
+    tracing::info!("Capturing trace to {path:?}");
+    true
+}
+
+/// Starts the capture asked for by [TracingConfig::startup_trace_path], if any, e.g. to profile a slow startup checkout.
+pub fn start_startup_trace_capture(config: &TracingConfig) {
+    if config.startup_trace_path.is_empty() {
+        return;
+    }
+    start_trace_capture(
+        &globalize_path(&config.startup_trace_path),
+        config.startup_trace_seconds,
+    );
+}
+
+/// Resolves `user://` and `res://` paths, so traces can be written next to the logs.
+pub fn globalize_path(path: &str) -> PathBuf {
+    PathBuf::from(
+        ProjectSettings::singleton()
+            .globalize_path(path)
+            .to_string(),
+    )
+}
+
+/// Stops the trace capture in progress, and returns the path it was written to.
+pub fn stop_trace_capture() -> Option<PathBuf> {
+    let handles = TRACING.get()?;
+    reload_filter(&handles.trace_filter, "trace", TRACE_FILTER_OFF);
+    let path = handles.chrome_trace.stop()?;
+    tracing::info!("Trace written to {path:?}");
+    Some(path)
+}
+
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
 pub(crate) struct TimeNoDate {
     year: i64,
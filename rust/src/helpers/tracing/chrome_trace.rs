@@ -0,0 +1,218 @@
+use std::{
+    collections::HashSet,
+    fmt::Debug,
+    fs::File,
+    io::{BufWriter, Write},
+    path::{Path, PathBuf},
+    sync::{
+        Arc, Mutex,
+        atomic::{AtomicBool, AtomicU64, Ordering},
+    },
+    time::{Duration, Instant},
+};
+
+use serde_json::{Value, json};
+use tracing::{
+    Event, Subscriber,
+    field::{Field, Visit},
+    span,
+};
+use tracing_subscriber::{Layer, layer::Context, registry::LookupSpan};
+
+use crate::helpers::tracing::sampling::Unsampled;
+
+static NEXT_THREAD_ID: AtomicU64 = AtomicU64::new(1);
+
+thread_local! {
+    /// A small, stable id for the current thread, since [std::thread::ThreadId::as_u64] isn't stable.
+    static THREAD_ID: u64 = NEXT_THREAD_ID.fetch_add(1, Ordering::Relaxed);
+}
+
+/// A trace being written to a file in the Chrome trace event format, which Perfetto and chrome://tracing can open.
+struct Capture {
+    path: PathBuf,
+    writer: BufWriter<File>,
+    start: Instant,
+    deadline: Option<Instant>,
+    /// Threads we've already written a name for.
+    named_threads: HashSet<u64>,
+    /// Whether an event needs a separating comma.
+    has_events: bool,
+}
+
+impl Capture {
+    fn write(&mut self, mut event: Value) {
+        let tid = THREAD_ID.with(|id| *id);
+        if self.named_threads.insert(tid) {
+            let thread = std::thread::current();
+            let name = thread.name().unwrap_or("unnamed");
+            self.write_raw(json!({
+                "name": "thread_name",
+                "ph": "M",
+                "pid": 1,
+                "tid": tid,
+                "args": { "name": name },
+            }));
+        }
+        event["pid"] = json!(1);
+        event["tid"] = json!(tid);
+        event["ts"] = json!(self.start.elapsed().as_secs_f64() * 1_000_000.0);
+        self.write_raw(event);
+    }
+
+    fn write_raw(&mut self, event: Value) {
+        let separator = if self.has_events { "," } else { "" };
+        self.has_events = true;
+        if let Err(e) = writeln!(self.writer, "{separator}{event}") {
+            eprintln!("Failed to write trace event to {:?}: {e}", self.path);
+        }
+    }
+
+    fn finish(mut self) -> PathBuf {
+        if let Err(e) = writeln!(self.writer, "]").and_then(|_| self.writer.flush()) {
+            eprintln!("Failed to finish trace {:?}: {e}", self.path);
+        }
+        self.path
+    }
+}
+
+#[derive(Default)]
+struct ChromeTraceState {
+    /// Checked before taking the lock, so spans cost nothing while no trace is being captured.
+    active: AtomicBool,
+    capture: Mutex<Option<Capture>>,
+}
+
+impl ChromeTraceState {
+    fn record(&self, event: impl FnOnce() -> Option<Value>) {
+        if !self.active.load(Ordering::Relaxed) {
+            return;
+        }
+        let mut capture = self.capture.lock().unwrap();
+        let Some(current) = capture.as_mut() else {
+            return;
+        };
+        if current
+            .deadline
+            .is_some_and(|deadline| Instant::now() >= deadline)
+        {
+            self.active.store(false, Ordering::Relaxed);
+            let path = capture.take().unwrap().finish();
+            eprintln!("!!! Trace written to {path:?}");
+            return;
+        }
+        if let Some(event) = event() {
+            current.write(event);
+        }
+    }
+}
+
+/// Starts and stops trace captures. Cheap to clone.
+#[derive(Clone, Default)]
+pub(crate) struct ChromeTrace {
+    state: Arc<ChromeTraceState>,
+}
+
+impl ChromeTrace {
+    pub fn layer(&self) -> ChromeTraceLayer {
+        ChromeTraceLayer {
+            state: self.state.clone(),
+        }
+    }
+
+    pub fn is_capturing(&self) -> bool {
+        self.state.active.load(Ordering::Relaxed)
+    }
+
+    /// Starts writing spans to [path], replacing any capture in progress.
+    /// The capture stops by itself after [duration], if given.
+    pub fn start(&self, path: &Path, duration: Option<Duration>) -> std::io::Result<()> {
+        let mut writer = BufWriter::new(File::create(path)?);
+        writeln!(writer, "[")?;
+        let start = Instant::now();
+        let previous = self.state.capture.lock().unwrap().replace(Capture {
+            path: path.to_path_buf(),
+            writer,
+            start,
+            deadline: duration.map(|duration| start + duration),
+            named_threads: HashSet::new(),
+            has_events: false,
+        });
+        self.state.active.store(true, Ordering::Relaxed);
+        if let Some(previous) = previous {
+            previous.finish();
+        }
+        Ok(())
+    }
+
+    /// Stops the capture in progress, and returns the path it was written to.
+    pub fn stop(&self) -> Option<PathBuf> {
+        self.state.active.store(false, Ordering::Relaxed);
+        let capture = self.state.capture.lock().unwrap().take();
+        capture.map(Capture::finish)
+    }
+}
+
+/// Records span entries and exits, and events, to the [ChromeTrace] capture in progress.
+/// Async spans are recorded per poll, on the thread that polled them.
+pub(crate) struct ChromeTraceLayer {
+    state: Arc<ChromeTraceState>,
+}
+
+impl ChromeTraceLayer {
+    fn record_span<S>(&self, id: &span::Id, ctx: Context<'_, S>, phase: &'static str)
+    where
+        S: Subscriber + for<'a> LookupSpan<'a>,
+    {
+        self.state.record(|| {
+            let span = ctx.span(id)?;
+            if span.extensions().get::<Unsampled>().is_some() {
+                return None;
+            }
+            Some(json!({
+                "name": span.name(),
+                "cat": span.metadata().target(),
+                "ph": phase,
+            }))
+        });
+    }
+}
+
+impl<S> Layer<S> for ChromeTraceLayer
+where
+    S: Subscriber + for<'a> LookupSpan<'a>,
+{
+    fn on_enter(&self, id: &span::Id, ctx: Context<'_, S>) {
+        self.record_span(id, ctx, "B");
+    }
+
+    fn on_exit(&self, id: &span::Id, ctx: Context<'_, S>) {
+        self.record_span(id, ctx, "E");
+    }
+
+    fn on_event(&self, event: &Event<'_>, _ctx: Context<'_, S>) {
+        self.state.record(|| {
+            let mut visitor = MessageVisitor::default();
+            event.record(&mut visitor);
+            Some(json!({
+                "name": visitor.message.unwrap_or_else(|| event.metadata().name().to_string()),
+                "cat": event.metadata().target(),
+                "ph": "i",
+                "s": "t",
+            }))
+        });
+    }
+}
+
+#[derive(Default)]
+struct MessageVisitor {
+    message: Option<String>,
+}
+
+impl Visit for MessageVisitor {
+    fn record_debug(&mut self, field: &Field, value: &dyn Debug) {
+        if field.name() == "message" {
+            self.message = Some(format!("{value:?}"));
+        }
+    }
+}
@@ -0,0 +1,97 @@
+use std::{
+    collections::HashMap,
+    sync::{
+        Arc, Mutex,
+        atomic::{AtomicU32, Ordering},
+    },
+    time::{Duration, Instant},
+};
+
+use tracing::{Event, Metadata, Subscriber, callsite::Identifier, span};
+use tracing_subscriber::{Layer, layer::Context, registry::LookupSpan};
+
+/// Spans that are entered every frame, as (target, name). Only some of them are recorded, see [HotSpanSampler].
+const HOT_SPANS: &[(&str, &str)] = &[
+    (
+        "patchwork_rust_core::godot_project::outer_process",
+        "process",
+    ),
+    ("patchwork_rust_core::project::project", "process"),
+];
+
+/// Marks a span that wasn't sampled, along with everything inside it.
+pub(crate) struct Unsampled;
+
+#[derive(Debug)]
+struct Window {
+    start: Instant,
+    count: u32,
+}
+
+/// Records at most [Self::rate] of each hot span per second. The rest, and the spans and events inside them,
+/// are marked [Unsampled] and dropped, so a frame loop doesn't flood the logs and traces.
+#[derive(Debug, Default)]
+pub(crate) struct HotSpanSampler {
+    /// Spans per second per hot callsite. 0 records all of them. Shared so it can be changed at runtime.
+    rate: Arc<AtomicU32>,
+    windows: Mutex<HashMap<Identifier, Window>>,
+}
+
+impl HotSpanSampler {
+    pub fn new(rate: Arc<AtomicU32>) -> Self {
+        Self {
+            rate,
+            windows: Mutex::default(),
+        }
+    }
+
+    fn is_hot(metadata: &Metadata<'_>) -> bool {
+        HOT_SPANS
+            .iter()
+            .any(|(target, name)| metadata.target() == *target && metadata.name() == *name)
+    }
+
+    fn sample(&self, metadata: &'static Metadata<'static>) -> bool {
+        let rate = self.rate.load(Ordering::Relaxed);
+        if rate == 0 {
+            return true;
+        }
+        let now = Instant::now();
+        let mut windows = self.windows.lock().unwrap();
+        let window = windows.entry(metadata.callsite()).or_insert(Window {
+            start: now,
+            count: 0,
+        });
+        if now.duration_since(window.start) >= Duration::from_secs(1) {
+            *window = Window {
+                start: now,
+                count: 0,
+            };
+        }
+        window.count += 1;
+        window.count <= rate
+    }
+}
+
+impl<S> Layer<S> for HotSpanSampler
+where
+    S: Subscriber + for<'a> LookupSpan<'a>,
+{
+    fn on_new_span(&self, attrs: &span::Attributes<'_>, id: &span::Id, ctx: Context<'_, S>) {
+        let Some(span) = ctx.span(id) else {
+            return;
+        };
+        let unsampled = span
+            .parent()
+            .is_some_and(|parent| parent.extensions().get::<Unsampled>().is_some())
+            || (Self::is_hot(attrs.metadata()) && !self.sample(attrs.metadata()));
+        if unsampled {
+            span.extensions_mut().insert(Unsampled);
+        }
+    }
+
+    fn event_enabled(&self, event: &Event<'_>, ctx: Context<'_, S>) -> bool {
+        ctx.event_span(event)
+            .is_none_or(|span| span.extensions().get::<Unsampled>().is_none())
+    }
+}
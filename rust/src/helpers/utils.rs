@@ -1,8 +1,8 @@
 use std::{
-    collections::HashSet, fmt, path::Path, str::FromStr, time::{SystemTime, UNIX_EPOCH}
+    collections::HashSet, fmt, path::Path, str::FromStr, sync::Arc, time::{SystemTime, UNIX_EPOCH}
 };
 
-use crate::{diff::differ::ProjectDiff, helpers::branch::Branch};
+use crate::{diff::differ::ProjectDiff, helpers::{branch::Branch, memory::HeapSize}};
 use automerge::{
     ChangeHash, transaction::{CommitOptions, Transaction}
 };
@@ -117,7 +117,34 @@ pub struct CommitInfo {
 	pub summary: String
 }
 
-#[derive(Debug)]
+impl HeapSize for CommitInfo {
+    fn heap_size(&self) -> usize {
+        self.metadata.heap_size() + self.summary.heap_size()
+    }
+}
+
+impl HeapSize for CommitMetadata {
+    fn heap_size(&self) -> usize {
+        self.username.heap_size()
+            + self.merge_metadata.heap_size()
+            + self.reverted_to.heap_size()
+            + self.changed_files.heap_size()
+    }
+}
+
+impl HeapSize for MergeMetadata {
+    fn heap_size(&self) -> usize {
+        self.forked_at_heads.heap_size()
+    }
+}
+
+impl HeapSize for ChangedFile {
+    fn heap_size(&self) -> usize {
+        self.path.heap_size()
+    }
+}
+
+#[derive(Debug, Clone, PartialEq)]
 pub struct BranchWrapper {
 	pub state: Branch,
 	pub children: Vec<DocumentId>
@@ -125,8 +152,10 @@ pub struct BranchWrapper {
 
 #[derive(Debug)]
 pub struct DiffWrapper {
-	pub diff: ProjectDiff,
-	pub title: String
+	pub diff: Arc<ProjectDiff>,
+	pub title: String,
+	/// The diff isn't ready yet, so [Self::diff] is empty until it's asked for again.
+	pub loading: bool
 }
 
 pub fn summarize_changes(author: &str, changes: &Vec<ChangedFile>) -> String {
@@ -6,5 +6,6 @@ mod patchwork_config;
 mod godot_diffs;
 mod text_differ_view;
 mod diff_inspector_section;
+mod highlight_changes_layer;
 mod lazy_load_token;
 mod patchwork_resource_loader;
\ No newline at end of file
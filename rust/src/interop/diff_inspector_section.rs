@@ -2,7 +2,7 @@ use godot::builtin::{Color, GString, Rect2, StringName, Variant, Vector2};
 use godot::classes::notify::ContainerNotification;
 use godot::classes::text_server::JustificationFlag;
 use godot::classes::{
-    Container, Control, EditorInspector, EditorProperty, IContainer, Input, InputEvent, InputEventMouseButton, Object, StyleBoxFlat, Texture2D, Timer, VBoxContainer
+    Container, Control, EditorInspector, EditorProperty, IContainer, Input, InputEvent, InputEventMouseButton, InputEventMouseMotion, Object, StyleBoxFlat, Texture2D, Timer, VBoxContainer
 };
 use godot::global::{HorizontalAlignment, MouseButton, PropertyHint};
 use godot::prelude::*;
@@ -187,7 +187,7 @@ impl DiffInspectorSection {
         self.section.clone()
     }
 
-    // This is currently only used in process to handle input, to mouse over the
+    // This is currently only used in gui_input to track the mouse over the
     // header. It's the same code from draw() that computes the header rect.
     // Ideally we'd factor out the dimensions.
     fn get_header_rect(&self) -> Rect2 {
@@ -328,6 +328,27 @@ impl DiffInspectorSection {
         self.dropping_unfold_timer.connect("timeout", &callable);
     }
 
+    /// Tracks whether the mouse is over the header, emitting the hover signals when it changes.
+    fn set_entered(&mut self, entered: bool) {
+        if self.entered == entered {
+            return;
+        }
+        self.entered = entered;
+        let section = self.section.clone();
+        self.base_mut().call_deferred(
+            "emit_signal",
+            &[
+                Variant::from(if entered {
+                    "section_mouse_entered"
+                } else {
+                    "section_mouse_exited"
+                }),
+                Variant::from(section),
+            ],
+        );
+        self.base_mut().queue_redraw();
+    }
+
     fn accept_and_emit_box_clicked(&mut self) {
         self.base_mut().accept_event();
         let section = self.section.clone();
@@ -346,31 +367,6 @@ impl DiffInspectorSection {
 
 #[godot_api]
 impl IContainer for DiffInspectorSection {
-    fn process(&mut self, _delta: f64) {
-        let mut base = self.base().clone();
-        let mouse_pos = self.base().get_local_mouse_position();
-
-        let entered = self.foldable && self.get_header_rect()
-            .contains_point(mouse_pos);
-        
-        if self.entered != entered {
-            let section = self.section.clone();
-            self.base_mut().call_deferred(
-                "emit_signal",
-                &[
-                    Variant::from(if entered {
-                        "section_mouse_entered"
-                    } else {
-                        "section_mouse_exited"
-                    }),
-                    Variant::from(section),
-                ],
-            );
-            self.entered = entered;
-            base.queue_redraw();
-        }
-    }
-    
     fn init(base: Base<Container>) -> Self {
         let vbox = VBoxContainer::new_alloc();
         let mut dropping_unfold_timer = Timer::new_alloc();
@@ -465,6 +461,13 @@ impl IContainer for DiffInspectorSection {
     }
 
     fn gui_input(&mut self, event: Gd<InputEvent>) {
+        // Hover is tracked from motion events rather than polling the mouse every frame.
+        // Motion over the children doesn't reach us, but that also leaves the header, see MOUSE_EXIT_SELF.
+        if let Ok(mm) = event.clone().try_cast::<InputEventMouseMotion>() {
+            let entered = self.foldable && self.get_header_rect().contains_point(mm.get_position());
+            self.set_entered(entered);
+            return;
+        }
         if let Ok(mb) = event.clone().try_cast::<InputEventMouseButton>() {
             if mb.is_pressed() && mb.get_button_index() == MouseButton::LEFT {
                 // MouseButton::LEFT
@@ -593,6 +596,10 @@ impl IContainer for DiffInspectorSection {
                 }
                 self.base_mut().queue_redraw();
             }
+            // NOTIFICATION_MOUSE_EXIT_SELF
+            ContainerNotification::MOUSE_EXIT_SELF => {
+                self.set_entered(false);
+            }
             // NOTIFICATION_MOUSE_EXIT
             ContainerNotification::MOUSE_EXIT => {
                 if self.dropping || self.dropping_for_unfold {
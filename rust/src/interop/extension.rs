@@ -1,7 +1,7 @@
 use godot::{classes::{Engine, ResourceLoader, ResourceSaver}, init::{EditorRunBehavior, ExtensionLibrary, InitLevel, gdextension}, obj::{Gd, NewAlloc, NewGd}};
 use godot::obj::Singleton;
 
-use crate::{helpers::tracing::initialize_tracing, interop::{godot_project::GodotProject, patchwork_config::PatchworkConfig, patchwork_resource_loader::{PatchworkResourceFormatSaver, PatchworkResourceLoader}}};
+use crate::{helpers::tracing::{initialize_tracing, start_startup_trace_capture, stop_trace_capture}, interop::{godot_project::GodotProject, patchwork_config::PatchworkConfig, patchwork_resource_loader::{PatchworkResourceFormatSaver, PatchworkResourceLoader}}};
 
 
 struct MyExtension;
@@ -19,6 +19,12 @@ unsafe impl ExtensionLibrary for MyExtension {
             initialize_tracing();
             tracing::info!("** on_level_init: Scene");
             Engine::singleton().register_singleton("PatchworkConfig", &PatchworkConfig::new_alloc());
+            {
+                let config = PatchworkConfig::singleton();
+                let config = config.bind();
+                config.reload_tracing();
+                start_startup_trace_capture(&config.get_tracing_config());
+            }
             Engine::singleton().register_singleton("GodotProject", &GodotProject::new_alloc());
             let loader = PatchworkResourceLoader::new_gd();
             let saver = PatchworkResourceFormatSaver::new_gd();
@@ -52,6 +58,8 @@ unsafe impl ExtensionLibrary for MyExtension {
                 PATCHWORK_RESOURCE_FORMAT_SAVER = None;
             }    
             tracing::info!("** on_level_deinit: Scene");
+            // Finish any trace in progress, so the file is complete.
+            stop_trace_capture();
             unregister_singleton("GodotProject");
             unregister_singleton("PatchworkConfig");
         }
@@ -1,5 +1,5 @@
 use godot::{
-    builtin::{GString, PackedStringArray},
+    builtin::{GString, PackedByteArray, PackedStringArray},
     classes::{ClassDb, EditorInterface, Object},
     meta::ToGodot,
     obj::Gd,
@@ -44,6 +44,9 @@ impl PatchworkConfigAccessor {
     }
 }
 
+/// Paths with this scheme are served from memory by the editor module's file access.
+pub const MEMORY_PATH_SCHEME: &str = "patchworkmem://";
+
 /// Allows Rust code to access the C++ PatchworkEditor editor module from Godot.
 pub struct PatchworkEditorAccessor {}
 
@@ -57,6 +60,26 @@ impl PatchworkEditorAccessor {
         ).to::<godot::global::Error>()
     }
 
+    /// Serves [data] at [path] through the editor's in-memory file access. [path] must start with [MEMORY_PATH_SCHEME].
+    /// The editor only routes filesystem access through the memory table while it holds files, so remove them with
+    /// [Self::remove_memory_files] as soon as the load that needed them is done.
+    pub fn register_memory_file(path: &str, data: &PackedByteArray) {
+        ClassDb::singleton().class_call_static(
+            "PatchworkEditor",
+            "register_memory_file",
+            &[path.to_variant(), data.to_variant()],
+        );
+    }
+
+    /// Drops every in-memory file whose path starts with [prefix].
+    pub fn remove_memory_files(prefix: &str) {
+        ClassDb::singleton().class_call_static(
+            "PatchworkEditor",
+            "remove_memory_files",
+            &[prefix.to_variant()],
+        );
+    }
+
     pub fn is_editor_importing() -> bool {
         return ClassDb::singleton()
             .class_call_static("PatchworkEditor", "is_editor_importing", &[])
@@ -1,83 +1,28 @@
-use std::collections::HashMap;
+use std::{
+    cell::RefCell,
+    collections::HashMap,
+    rc::Rc,
+    sync::{Arc, LazyLock, Mutex},
+};
 
+use godot::obj::Singleton;
+use godot::prelude::*;
 use godot::{
-    builtin::{Array, GString, VarDictionary, Variant, vdict, StringName}, classes::{ClassDb}, global::str_to_var, meta::{ByValue, GodotConvert, ToArg, ToGodot}
+    builtin::{Array, GString, PackedStringArray, StringName, VarDictionary, Variant, vdict},
+    classes::{ClassDb, RefCounted},
+    global::str_to_var,
+    meta::{ByValue, GodotConvert, ToArg, ToGodot},
 };
-use godot::obj::Singleton;
 
 use crate::{
     diff::{
         differ::{ChangeType, Diff, ProjectDiff},
-        resource_differ::BinaryResourceDiff,
-        scene_differ::{NodeDiff, PropertyDiff, SceneDiff, SubResourceDiff, TextResourceDiff, VariantValue},
-        text_differ::{TextDiff, TextDiffHunk, TextDiffLine},
+        scene_differ::{NodeDiff, PropertyDiff, SubResourceDiff, VariantValue},
     },
-    interop::{godot_helpers::{GodotConvertExt, ToGodotExt}, lazy_load_token::LazyLoadToken}, parser::godot_parser::TypeOrInstance,
+    interop::lazy_load_token::LazyLoadToken,
+    parser::godot_parser::TypeOrInstance,
 };
 
-impl GodotConvert for TextDiffLine {
-    type Via = VarDictionary;
-}
-
-impl ToGodot for TextDiffLine {
-    type Pass = ByValue;
-    fn to_godot(&self) -> ToArg<'_, Self::Via, Self::Pass> {
-        vdict! {
-            "new_line_no": self.new_line_no,
-            "old_line_no": self.old_line_no,
-            "content": self.content.to_godot(),
-            "status": self.status.to_godot(),
-        }
-    }
-    fn to_variant(&self) -> Variant {
-        self.to_godot().to_variant()
-    }
-}
-
-impl GodotConvert for TextDiffHunk {
-    type Via = VarDictionary;
-}
-
-impl ToGodot for TextDiffHunk {
-    type Pass = ByValue;
-    fn to_godot(&self) -> ToArg<'_, Self::Via, Self::Pass> {
-        vdict! {
-            "new_start": self.new_start,
-            "old_start": self.old_start,
-            "new_lines": self.new_lines,
-            "old_lines": self.old_lines,
-            "diff_lines": self.diff_lines.iter().map(|line| line.to_godot()).collect::<Array<VarDictionary>>(),
-        }
-    }
-    fn to_variant(&self) -> Variant {
-        self.to_godot().to_variant()
-    }
-}
-
-impl GodotConvert for TextDiff {
-    type Via = VarDictionary;
-}
-
-impl ToGodot for TextDiff {
-    type Pass = ByValue;
-    fn to_godot(&self) -> ToArg<'_, Self::Via, Self::Pass> {
-        vdict! {
-			"path": self.path.to_godot(),
-			"diff_type": "text_changed",
-			"change_type": self.change_type.to_godot(),
-			"text_diff": vdict! {
-				// In the future, if we track renames, we should use the different paths here. Currently we don't, though.
-				"new_file": self.path.to_godot(),
-				"old_file": self.path.to_godot(),
-				"diff_hunks": self.diff_hunks.iter().map(|hunk| hunk.to_godot()).collect::<Array<VarDictionary>>(),
-			}
-		}
-    }
-    fn to_variant(&self) -> Variant {
-        self.to_godot().to_variant()
-    }
-}
-
 impl GodotConvert for ChangeType {
     type Via = GString;
 }
@@ -94,231 +39,435 @@ impl ToGodot for ChangeType {
     }
 }
 
-impl GodotConvert for Diff {
+impl GodotConvert for PropertyDiff {
     type Via = VarDictionary;
 }
 
-impl ToGodot for Diff {
-    type Pass = ByValue;
-    fn to_godot(&self) -> ToArg<'_, Self::Via, Self::Pass> {
-        match self {
-            Diff::Scene(diff) => diff.to_godot(),
-            Diff::TextResourceDiff(diff) => diff.to_godot(),
-            Diff::BinaryResource(diff) => diff.to_godot(),
-            Diff::Text(diff) => diff.to_godot(),
-        }
-    }
+impl GodotConvert for VariantValue {
+    type Via = Variant;
 }
 
-impl GodotConvert for ProjectDiff {
-    type Via = VarDictionary;
+/// ClassDB default values by (class, property). Classes don't change their defaults while the editor runs,
+/// and scene diffs ask for the same few pairs over and over.
+static CLASSDB_DEFAULT_VALUES: LazyLock<Mutex<HashMap<(String, String), String>>> =
+    LazyLock::new(|| Mutex::new(HashMap::new()));
+
+fn get_classdb_default_value(class_name: &str, prop: &str) -> String {
+    let key = (class_name.to_string(), prop.to_string());
+    if let Some(value) = CLASSDB_DEFAULT_VALUES.lock().unwrap().get(&key) {
+        return value.clone();
+    }
+    // Don't remember misses; the class may not be registered yet.
+    if !ClassDb::singleton().is_instance_valid() || !ClassDb::singleton().class_exists(class_name) {
+        return "".to_string();
+    }
+    let value = ClassDb::singleton()
+        .class_get_property_default_value(&StringName::from(class_name), &StringName::from(prop))
+        .to_string();
+    CLASSDB_DEFAULT_VALUES
+        .lock()
+        .unwrap()
+        .insert(key, value.clone());
+    value
+}
+
+/// Memoizes `str_to_var` across the values of one diff. Large scene diffs repeat the same value strings
+/// (colors, vectors, default values) many times. Shared by every wrapper object of a [PatchworkDiff].
+#[derive(Clone, Default)]
+struct ParsedValues(Rc<RefCell<HashMap<String, Variant>>>);
+
+impl ParsedValues {
+    fn str_to_var(&self, s: &str) -> Variant {
+        if let Some(value) = self.0.borrow().get(s) {
+            return value.clone();
+        }
+        let value = str_to_var(s);
+        // Containers and objects are shared by reference, so every property gets its own copy of those.
+        if !matches!(
+            value.get_type(),
+            VariantType::ARRAY | VariantType::DICTIONARY | VariantType::OBJECT
+        ) {
+            self.0.borrow_mut().insert(s.to_string(), value.clone());
+        }
+        value
+    }
 }
 
-impl ToGodot for ProjectDiff {
-    type Pass = ByValue;
-    fn to_godot(&self) -> ToArg<'_, Self::Via, Self::Pass> {
-        let mut dict = vdict! {};
-        for diff in &self.file_diffs {
-            dict.set(
-                match diff {
-                    Diff::Scene(scene_diff) => scene_diff.path.clone(),
-                    Diff::TextResourceDiff(scene_diff) => scene_diff.path.clone(),
-                    Diff::BinaryResource(resource_diff) => resource_diff.path.clone(),
-                    Diff::Text(text_diff) => text_diff.path.clone(),
+fn variant_value_to_godot(value: &VariantValue, parsed: &ParsedValues) -> Variant {
+    match value {
+        VariantValue::Variant(s) => parsed.str_to_var(s),
+        VariantValue::DefaultValue(type_or_instance, property_name) => {
+            let default_value = match type_or_instance {
+                Some(TypeOrInstance::Type(class_name)) => {
+                    get_classdb_default_value(class_name, property_name)
                 }
-                .to_godot(),
-                diff.to_godot(),
-            )
+                // TODO: we have to get the class of the root instance node; right now this is likely going to be something like `ExtResource("foo")`
+                Some(TypeOrInstance::Instance(_)) => "".to_string(),
+                None => "".to_string(),
+            };
+            if default_value.is_empty() {
+                "<default_value>".to_string().to_variant()
+            } else {
+                parsed.str_to_var(&default_value)
+            }
+        }
+        VariantValue::LazyLoadData(original_path, load_path) => {
+            LazyLoadToken::new(load_path.clone(), Some(original_path.clone())).to_variant()
         }
-        dict
     }
 }
 
-impl GodotConvert for SceneDiff {
-    type Via = VarDictionary;
+fn property_diff_to_dict(property: &PropertyDiff, parsed: &ParsedValues) -> VarDictionary {
+    let to_godot = |value: &Option<VariantValue>| {
+        value
+            .as_ref()
+            .map(|v| variant_value_to_godot(v, parsed))
+            .unwrap_or(Variant::nil())
+    };
+    vdict! {
+        "change_type": property.change_type.to_godot(),
+        "name": property.name.to_godot(),
+        "new_value": to_godot(&property.new_value),
+        "old_value": to_godot(&property.old_value),
+    }
 }
 
-impl ToGodot for SceneDiff {
+impl ToGodot for VariantValue {
     type Pass = ByValue;
     fn to_godot(&self) -> ToArg<'_, Self::Via, Self::Pass> {
-        vdict! {
-            "change_type": self.change_type.to_godot(),
-            "changed_nodes": self.changed_nodes.to_godot(),
-			"diff_type": "scene_changed"
-        }
+        variant_value_to_godot(self, &ParsedValues::default())
     }
 }
 
-impl GodotConvert for TextResourceDiff {
-    type Via = VarDictionary;
-}
-
-impl ToGodot for TextResourceDiff {
+impl ToGodot for PropertyDiff {
     type Pass = ByValue;
     fn to_godot(&self) -> ToArg<'_, Self::Via, Self::Pass> {
-        vdict! {
-            "change_type": self.change_type.to_godot(),
-            "resource_type": self.resource_type.to_godot(),
-            "changed_sub_resources": self.changed_sub_resources.to_godot(),
-            "changed_main_resource": self.changed_main_resource.as_ref().map(|s| s.to_godot().to_variant()).unwrap_or(Variant::nil()),
-            "diff_type": "text_resource_changed",
-        }
+        property_diff_to_dict(self, &ParsedValues::default())
     }
 }
 
-impl GodotConvert for SubResourceDiff {
-    type Via = VarDictionary;
+fn diff_path(diff: &Diff) -> &str {
+    match diff {
+        Diff::Scene(diff) => &diff.path,
+        Diff::TextResourceDiff(diff) => &diff.path,
+        Diff::BinaryResource(diff) => &diff.path,
+        Diff::Text(diff) => &diff.path,
+    }
 }
 
-impl ToGodot for SubResourceDiff {
-    type Pass = ByValue;
-    fn to_godot(&self) -> ToArg<'_, Self::Via, Self::Pass> {
-        vdict! {
-            "change_type": self.change_type.to_godot(),
-            "sub_resource_id": self.sub_resource_id.to_godot(),
-            "resource_type": self.resource_type.to_godot(),
-            "changed_props": self.changed_properties.to_godot(),
-        }
-    }
+fn property_names(properties: &HashMap<String, PropertyDiff>) -> PackedStringArray {
+    properties.keys().map(GString::from).collect()
 }
 
-impl GodotConvertExt for Vec<SubResourceDiff> {
-    type Via = Array<VarDictionary>;
+/// Converts a single property diff, running `str_to_var` on its values only now.
+fn property_to_dict(
+    properties: &HashMap<String, PropertyDiff>,
+    name: GString,
+    parsed: &ParsedValues,
+) -> VarDictionary {
+    properties
+        .get(&name.to_string())
+        .map(|property| property_diff_to_dict(property, parsed))
+        .unwrap_or_default()
 }
 
-impl ToGodotExt for Vec<SubResourceDiff> {
-    type Pass = ByValue;
-    fn _to_godot(&self) -> Array<VarDictionary> {
-        self.iter()
-            .map(|s| s.to_godot())
-            .collect::<Array<VarDictionary>>()
+/// A [ProjectDiff] exposed to GDScript. Holds the Rust diff and only converts the fields the UI asks for,
+/// so marshalling cost scales with what's displayed rather than with the size of the diff.
+#[derive(GodotClass)]
+#[class(no_init, base = RefCounted)]
+pub struct PatchworkDiff {
+    base: Base<RefCounted>,
+    diff: Arc<ProjectDiff>,
+    parsed: ParsedValues,
+}
+
+impl PatchworkDiff {
+    pub fn from_diff(diff: Arc<ProjectDiff>) -> Gd<Self> {
+        Gd::from_init_fn(|base| Self {
+            base,
+            diff,
+            parsed: ParsedValues::default(),
+        })
     }
-    fn _to_variant(&self) -> Variant {
-        self._to_godot().to_variant()
+}
+
+#[godot_api]
+impl PatchworkDiff {
+    #[func]
+    fn is_empty(&self) -> bool {
+        self.diff.file_diffs.is_empty()
+    }
+
+    /// The paths of all changed files, in diff order.
+    #[func]
+    fn get_file_paths(&self) -> PackedStringArray {
+        self.diff
+            .file_diffs
+            .iter()
+            .map(|diff| GString::from(diff_path(diff)))
+            .collect()
+    }
+
+    #[func]
+    fn get_file_diff(&self, path: GString) -> Option<Gd<PatchworkFileDiff>> {
+        let path = path.to_string();
+        let index = self
+            .diff
+            .file_diffs
+            .iter()
+            .position(|diff| diff_path(diff) == path)?;
+        Some(Gd::from_init_fn(|base| PatchworkFileDiff {
+            base,
+            diff: self.diff.clone(),
+            parsed: self.parsed.clone(),
+            index,
+        }))
     }
 }
 
-impl GodotConvertExt for Vec<NodeDiff> {
-    type Via = Array<VarDictionary>;
+/// A single file of a [PatchworkDiff].
+#[derive(GodotClass)]
+#[class(no_init, base = RefCounted)]
+pub struct PatchworkFileDiff {
+    base: Base<RefCounted>,
+    diff: Arc<ProjectDiff>,
+    parsed: ParsedValues,
+    index: usize,
 }
 
-impl ToGodotExt for Vec<NodeDiff> {
-    type Pass = ByValue;
-    fn _to_godot(&self) -> Array<VarDictionary> {
-        self.iter()
-            .map(|s| s.to_godot())
-            .collect::<Array<VarDictionary>>()
+impl PatchworkFileDiff {
+    fn file(&self) -> &Diff {
+        &self.diff.file_diffs[self.index]
     }
-    fn _to_variant(&self) -> Variant {
-        self._to_godot().to_variant()
+
+    /// The shared diff and the index of this file in it, if this is a text diff.
+    pub(crate) fn get_text_diff_source(&self) -> Option<(Arc<ProjectDiff>, usize)> {
+        matches!(self.file(), Diff::Text(_)).then(|| (self.diff.clone(), self.index))
     }
 }
 
-impl GodotConvert for NodeDiff {
-    type Via = VarDictionary;
-}
+#[godot_api]
+impl PatchworkFileDiff {
+    #[func]
+    fn get_path(&self) -> GString {
+        GString::from(diff_path(self.file()))
+    }
 
-impl ToGodot for NodeDiff {
-    type Pass = ByValue;
-    fn to_godot(&self) -> ToArg<'_, Self::Via, Self::Pass> {
-        vdict! {
-            "change_type": self.change_type.to_godot(),
-            "changed_props": self.changed_properties.to_godot(),
-            "node_path": self.node_path.to_godot(),
-            "type": self.node_type.to_godot()
+    /// One of `scene_changed`, `text_resource_changed`, `resource_changed` or `text_changed`.
+    #[func]
+    fn get_diff_type(&self) -> GString {
+        match self.file() {
+            Diff::Scene(_) => "scene_changed",
+            Diff::TextResourceDiff(_) => "text_resource_changed",
+            Diff::BinaryResource(_) => "resource_changed",
+            Diff::Text(_) => "text_changed",
         }
+        .into()
     }
-}
 
-impl GodotConvertExt for HashMap<String, PropertyDiff> {
-    type Via = VarDictionary;
-}
+    #[func]
+    fn get_change_type(&self) -> GString {
+        match self.file() {
+            Diff::Scene(diff) => diff.change_type.to_godot(),
+            Diff::TextResourceDiff(diff) => diff.change_type.to_godot(),
+            Diff::BinaryResource(diff) => diff.change_type.to_godot(),
+            Diff::Text(diff) => diff.change_type.to_godot(),
+        }
+    }
 
-impl ToGodotExt for HashMap<String, PropertyDiff> {
-    type Pass = ByValue;
-    fn _to_godot(&self) -> VarDictionary {
-        let mut dict = vdict! {};
-        for (name, diff) in self {
-            dict.set(name.clone(), diff.to_godot());
+    #[func]
+    fn get_resource_type(&self) -> GString {
+        match self.file() {
+            Diff::TextResourceDiff(diff) => GString::from(&diff.resource_type),
+            _ => GString::new(),
         }
-        dict
     }
-    fn _to_variant(&self) -> Variant {
-        self._to_godot().to_variant()
+
+    /// The changed nodes of a scene, sorted by node path.
+    #[func]
+    fn get_changed_nodes(&self) -> Array<Gd<PatchworkNodeDiff>> {
+        let Diff::Scene(scene) = self.file() else {
+            return Array::new();
+        };
+        let mut indices: Vec<usize> = (0..scene.changed_nodes.len()).collect();
+        indices.sort_by(|a, b| {
+            scene.changed_nodes[*a]
+                .node_path
+                .cmp(&scene.changed_nodes[*b].node_path)
+        });
+        indices
+            .into_iter()
+            .map(|node| {
+                Gd::from_init_fn(|base| PatchworkNodeDiff {
+                    base,
+                    diff: self.diff.clone(),
+                    parsed: self.parsed.clone(),
+                    file: self.index,
+                    node,
+                })
+            })
+            .collect()
     }
-}
 
-impl GodotConvert for PropertyDiff {
-    type Via = VarDictionary;
+    #[func]
+    fn get_changed_sub_resources(&self) -> Array<Gd<PatchworkSubResourceDiff>> {
+        let Diff::TextResourceDiff(resource) = self.file() else {
+            return Array::new();
+        };
+        (0..resource.changed_sub_resources.len())
+            .map(|sub_resource| {
+                Gd::from_init_fn(|base| PatchworkSubResourceDiff {
+                    base,
+                    diff: self.diff.clone(),
+                    parsed: self.parsed.clone(),
+                    file: self.index,
+                    sub_resource: Some(sub_resource),
+                })
+            })
+            .collect()
+    }
+
+    #[func]
+    fn get_changed_main_resource(&self) -> Option<Gd<PatchworkSubResourceDiff>> {
+        let Diff::TextResourceDiff(resource) = self.file() else {
+            return None;
+        };
+        resource.changed_main_resource.as_ref()?;
+        Some(Gd::from_init_fn(|base| PatchworkSubResourceDiff {
+            base,
+            diff: self.diff.clone(),
+            parsed: self.parsed.clone(),
+            file: self.index,
+            sub_resource: None,
+        }))
+    }
+
+    #[func]
+    fn get_old_resource(&self) -> Variant {
+        match self.file() {
+            Diff::BinaryResource(diff) => diff
+                .old_resource
+                .as_ref()
+                .map(|v| v.to_godot())
+                .unwrap_or(Variant::nil()),
+            _ => Variant::nil(),
+        }
+    }
+
+    #[func]
+    fn get_new_resource(&self) -> Variant {
+        match self.file() {
+            Diff::BinaryResource(diff) => diff
+                .new_resource
+                .as_ref()
+                .map(|v| v.to_godot())
+                .unwrap_or(Variant::nil()),
+            _ => Variant::nil(),
+        }
+    }
 }
 
-impl GodotConvert for VariantValue {
-    type Via = Variant;
+/// A changed node of a scene in a [PatchworkDiff].
+#[derive(GodotClass)]
+#[class(no_init, base = RefCounted)]
+pub struct PatchworkNodeDiff {
+    base: Base<RefCounted>,
+    diff: Arc<ProjectDiff>,
+    parsed: ParsedValues,
+    file: usize,
+    node: usize,
 }
 
-fn get_classdb_default_value(class_name: &str, prop: &str) -> String {
-    if ClassDb::singleton().is_instance_valid() && ClassDb::singleton().class_exists(class_name) {
-        ClassDb::singleton()
-        .class_get_property_default_value(
-            &StringName::from(class_name),
-            &StringName::from(prop),
-        )
-        .to_string()
-    } else {
-        "".to_string()
+impl PatchworkNodeDiff {
+    fn node(&self) -> &NodeDiff {
+        let Diff::Scene(scene) = &self.diff.file_diffs[self.file] else {
+            unreachable!("node diffs are only created for scene diffs");
+        };
+        &scene.changed_nodes[self.node]
     }
 }
-impl ToGodot for VariantValue {
-    type Pass = ByValue;
-    fn to_godot(&self) -> ToArg<'_, Self::Via, Self::Pass> {
-        match self {
-            VariantValue::Variant(s) => str_to_var(s),
-            VariantValue::DefaultValue(type_or_instance, property_name) => {
-                let default_value = match type_or_instance {
-                    Some(TypeOrInstance::Type(class_name)) => {
-                        get_classdb_default_value(class_name, property_name)
-                    }
-                    // TODO: we have to get the class of the root instance node; right now this is likely going to be something like `ExtResource("foo")`
-                    Some(TypeOrInstance::Instance(_)) => "".to_string(),
-                    None => "".to_string(),
-                };
-                if default_value.is_empty() {
-                    "<default_value>".to_string().to_variant()
-                } else {
-                    str_to_var(&default_value)
-                }
-            }
-            VariantValue::LazyLoadData(original_path, load_path) => 
-                LazyLoadToken::new(load_path.clone(), Some(original_path.clone()))
-                .to_variant(),
-        }
+
+#[godot_api]
+impl PatchworkNodeDiff {
+    #[func]
+    pub(crate) fn get_node_path(&self) -> GString {
+        GString::from(&self.node().node_path)
+    }
+
+    #[func]
+    fn get_node_type(&self) -> GString {
+        GString::from(&self.node().node_type)
+    }
+
+    #[func]
+    pub(crate) fn get_change_type(&self) -> GString {
+        self.node().change_type.to_godot()
+    }
+
+    #[func]
+    fn get_property_names(&self) -> PackedStringArray {
+        property_names(&self.node().changed_properties)
+    }
+
+    /// Returns the diff of one property, as a dictionary with `change_type`, `name`, `old_value` and `new_value`.
+    #[func]
+    fn get_property(&self, name: GString) -> VarDictionary {
+        property_to_dict(&self.node().changed_properties, name, &self.parsed)
     }
 }
 
-impl ToGodot for PropertyDiff {
-    type Pass = ByValue;
-    fn to_godot(&self) -> ToArg<'_, Self::Via, Self::Pass> {
-        vdict! {
-            "change_type": self.change_type.to_godot(),
-            "name": self.name.to_godot(),
-            "new_value": self.new_value.as_ref().map(|v| v.to_godot()).unwrap_or(Variant::nil()),
-            "old_value": self.old_value.as_ref().map(|v| v.to_godot()).unwrap_or(Variant::nil()),
+/// A changed sub-resource, or the changed main resource, of a text resource in a [PatchworkDiff].
+#[derive(GodotClass)]
+#[class(no_init, base = RefCounted)]
+pub struct PatchworkSubResourceDiff {
+    base: Base<RefCounted>,
+    diff: Arc<ProjectDiff>,
+    parsed: ParsedValues,
+    file: usize,
+    /// [None] for the main resource.
+    sub_resource: Option<usize>,
+}
+
+impl PatchworkSubResourceDiff {
+    fn sub_resource(&self) -> &SubResourceDiff {
+        let Diff::TextResourceDiff(resource) = &self.diff.file_diffs[self.file] else {
+            unreachable!("sub-resource diffs are only created for text resource diffs");
+        };
+        match self.sub_resource {
+            Some(index) => &resource.changed_sub_resources[index],
+            None => resource
+                .changed_main_resource
+                .as_ref()
+                .expect("main resource diffs are only created when the main resource changed"),
         }
     }
 }
 
-impl GodotConvert for BinaryResourceDiff {
-    type Via = VarDictionary;
-}
+#[godot_api]
+impl PatchworkSubResourceDiff {
+    #[func]
+    fn get_sub_resource_id(&self) -> GString {
+        GString::from(&self.sub_resource().sub_resource_id)
+    }
 
-impl ToGodot for BinaryResourceDiff {
-    type Pass = ByValue;
-    fn to_godot(&self) -> ToArg<'_, Self::Via, Self::Pass> {
-        vdict! {
-            "change_type": self.change_type.to_godot(),
-            "new_resource": self.new_resource.as_ref().map(|v| v.to_godot()).unwrap_or(Variant::nil()),
-            "old_resource": self.old_resource.as_ref().map(|v| v.to_godot()).unwrap_or(Variant::nil()),
-			"diff_type": "resource_changed"
-        }
+    #[func]
+    fn get_resource_type(&self) -> GString {
+        GString::from(&self.sub_resource().resource_type)
+    }
+
+    #[func]
+    fn get_change_type(&self) -> GString {
+        self.sub_resource().change_type.to_godot()
+    }
+
+    #[func]
+    fn get_property_names(&self) -> PackedStringArray {
+        property_names(&self.sub_resource().changed_properties)
+    }
+
+    /// Returns the diff of one property, as a dictionary with `change_type`, `name`, `old_value` and `new_value`.
+    #[func]
+    fn get_property(&self, name: GString) -> VarDictionary {
+        property_to_dict(&self.sub_resource().changed_properties, name, &self.parsed)
     }
 }
@@ -5,8 +5,13 @@ use samod::{DocumentId};
 use godot::meta::{ArgPassing, ByValue, GodotType, ToArg};
 use godot::{prelude::*, meta::ToGodot, meta::GodotConvert};
 use crate::fs::file_utils::FileContent;
+use crate::project::connection::ConnectionStats;
 use crate::project::project_api::{BranchViewModel, ChangeViewModel, DiffViewModel, SyncStatus};
+use crate::project::ui_state::UiBranch;
+use crate::helpers::memory::{MemoryReport, MemoryUsage};
+use crate::helpers::metrics::MetricsSnapshot;
 use crate::helpers::utils::{ChangedFile};
+use crate::interop::godot_diffs::PatchworkDiff;
 use godot::builtin::Variant;
 
 
@@ -141,10 +146,72 @@ pub(crate) fn branch_view_model_to_dict(branch: &impl BranchViewModel) -> VarDic
 	}
 }
 
+/// Like [branch_view_model_to_dict], plus whether the branch is loaded.
+pub(crate) fn ui_branch_to_dict(branch: &UiBranch) -> VarDictionary {
+	let mut dict = branch_view_model_to_dict(&branch.branch);
+	dict.set("is_loaded", branch.is_loaded);
+	dict
+}
+
+/// Converts a metrics snapshot to nested dictionaries of counters, gauges and histograms.
+pub(crate) fn metrics_snapshot_to_dict(snapshot: &MetricsSnapshot) -> VarDictionary {
+	let mut counters = VarDictionary::new();
+	for (name, value) in &snapshot.counters {
+		counters.set(*name, *value as i64);
+	}
+	let mut gauges = VarDictionary::new();
+	for (name, value) in &snapshot.gauges {
+		gauges.set(*name, *value);
+	}
+	let mut histograms = VarDictionary::new();
+	for (name, histogram) in &snapshot.histograms {
+		histograms.set(*name, vdict! {
+			"count": histogram.count as i64,
+			"sum": histogram.sum as i64,
+			"mean": histogram.mean as i64,
+			"p50": histogram.p50 as i64,
+			"p90": histogram.p90 as i64,
+			"p99": histogram.p99 as i64,
+			"max": histogram.max as i64,
+		});
+	}
+	vdict! {
+		"timestamp": snapshot.timestamp as i64,
+		"counters": counters,
+		"gauges": gauges,
+		"histograms": histograms,
+	}
+}
+
+fn memory_usage_to_dict(usage: &MemoryUsage) -> VarDictionary {
+	vdict! {
+		"entries": usage.entries as i64,
+		"bytes": usage.bytes as i64,
+	}
+}
+
+pub(crate) fn memory_report_to_dict(report: &MemoryReport) -> VarDictionary {
+	let mut dict = vdict! {
+		"fs_watcher": memory_usage_to_dict(&report.fs_watcher),
+		"pending_changes": memory_usage_to_dict(&report.pending_changes),
+		"history": memory_usage_to_dict(&report.history),
+		"diff_cache": memory_usage_to_dict(&report.diff_cache),
+		"loader_caches": memory_usage_to_dict(&report.loader_caches),
+	};
+	if let Some(branch_docs) = &report.branch_docs {
+		dict.set("branch_docs", memory_usage_to_dict(branch_docs));
+	}
+	if let Some(binary_docs) = &report.binary_docs {
+		dict.set("binary_docs", memory_usage_to_dict(binary_docs));
+	}
+	dict
+}
+
 pub(crate) fn diff_view_model_to_dict(diff: &impl DiffViewModel) -> VarDictionary {
 	vdict! {
-		"dict": diff.get_diff().to_godot(),
-		"title": diff.get_title().to_godot()
+		"diff": PatchworkDiff::from_diff(diff.get_diff()),
+		"title": diff.get_title().to_godot(),
+		"loading": diff.is_loading()
 	}
 }
 
@@ -170,17 +237,26 @@ impl ToGodot for SyncStatus {
 	type Pass = ByValue;
 
 	fn to_godot(&self) -> VarDictionary {
+		let stats = match self {
+			SyncStatus::Syncing(stats) => stats.clone(),
+			_ => ConnectionStats::default(),
+		};
 		vdict! {
 			"state": match self {
 				SyncStatus::Unknown => "unknown",
 				SyncStatus::Disconnected(_) => "disconnected",
 				SyncStatus::UpToDate => "up_to_date",
-				SyncStatus::Syncing => "syncing"
+				SyncStatus::Syncing(_) => "syncing"
 			},
 			"unsynced_changes": match self {
 				SyncStatus::Disconnected(num) => *num as i32,
 				_ => 0
-			}
+			},
+			// -1 until the server has acknowledged something
+			"rtt_ms": stats.rtt_ms.map_or(-1, |rtt| rtt as i64),
+			"upload_bytes_per_sec": stats.upload_bytes_per_sec as i64,
+			"outstanding_bytes": stats.outstanding_bytes as i64,
+			"outstanding_docs": stats.outstanding_docs as i64,
 		}
 	}
 }
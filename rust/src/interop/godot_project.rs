@@ -1,8 +1,11 @@
 use crate::fs::file_utils::{FileContent, FileSystemEvent};
 use crate::helpers::history_ref::HistoryRef;
+use crate::helpers::metrics::METRICS;
+use crate::helpers::tracing as tracing_helpers;
 use crate::interop::godot_accessors::{EditorFilesystemAccessor, PatchworkConfigAccessor, PatchworkEditorAccessor};
 use crate::project::project::{GodotProjectSignal, Project};
 use crate::project::project_api::{BranchViewModel, ProjectViewModel};
+use crate::project::ui_state::UiStateDelta;
 use automerge::ChangeHash;
 use godot::classes::editor_plugin::DockSlot;
 use ::safer_ffi::prelude::*;
@@ -19,7 +22,7 @@ use tracing::instrument;
 use std::collections::{HashSet};
 use std::path::PathBuf;
 use std::{collections::HashMap, str::FromStr};
-use crate::interop::godot_helpers::{ToGodotExt, branch_view_model_to_dict, change_view_model_to_dict, diff_view_model_to_dict};
+use crate::interop::godot_helpers::{ToGodotExt, ToVariantExt, branch_view_model_to_dict, change_view_model_to_dict, diff_view_model_to_dict, memory_report_to_dict, metrics_snapshot_to_dict, ui_branch_to_dict};
 
 // This is the worst thing I've ever done
 // Get the file system
@@ -152,12 +155,17 @@ pub struct GodotProject {
 /// This implementation binds as closely as possible to [GodotProjectViewModel].
 #[godot_api]
 impl GodotProject {
+	/// Emitted with what changed in the UI state since the last emit, see [Self::get_ui_state].
 	#[signal]
-	fn state_changed();
+	fn state_changed(delta: VarDictionary);
 
 	#[signal]
 	fn checked_out_branch();
 
+	/// Emitted when a diff that was still loading when asked for is ready; ask for it again to show it.
+	#[signal]
+	fn diff_loaded();
+
 	#[func]
 	fn has_user_name(&self) -> bool {
 		self.project.has_user_name()
@@ -348,6 +356,75 @@ impl GodotProject {
 		Variant::from(diff_view_model_to_dict(&diff))
 	}
 
+	/// Returns the branches as of the last [UiState](crate::project::ui_state::UiState), and its version.
+	/// `state_changed` deltas apply on top of this version.
+	#[func]
+	fn get_ui_state(&self) -> VarDictionary {
+		let state = self.project.get_ui_state();
+		vdict! {
+			"version": state.version as i64,
+			"main_branch": state.main_branch.to_variant(),
+			"branches": state.branches.values().map(ui_branch_to_dict).collect::<Array<VarDictionary>>(),
+		}
+	}
+
+	fn ui_state_delta_to_dict(&self, delta: &UiStateDelta) -> VarDictionary {
+		let state = self.project.get_ui_state();
+		let branches = |ids: &Vec<DocumentId>| {
+			ids.iter()
+				.filter_map(|id| state.branches.get(id))
+				.map(ui_branch_to_dict)
+				.collect::<Array<VarDictionary>>()
+		};
+		let changes = |hashes: &Vec<ChangeHash>| {
+			hashes.iter()
+				.filter_map(|hash| self.project.get_change(*hash))
+				.map(change_view_model_to_dict)
+				.collect::<Array<VarDictionary>>()
+		};
+		vdict! {
+			"from_version": delta.from_version as i64,
+			"to_version": delta.to_version as i64,
+			"main_branch": delta.main_branch.to_variant(),
+			"main_branch_changed": delta.main_branch_changed,
+			"branches_added": branches(&delta.branches_added),
+			"branches_updated": branches(&delta.branches_updated),
+			"branches_removed": delta.branches_removed.to_godot(),
+			"history_reset": delta.history_reset,
+			"changes_appended": changes(&delta.changes_appended),
+			"changes_updated": changes(&delta.changes_updated),
+			"sync_status": delta.sync_status.as_ref().map(|status| status.to_godot().to_variant()).unwrap_or_default(),
+		}
+	}
+
+	/// Records spans to [path] in the Chrome trace event format, which Perfetto can open, for [seconds].
+	/// If [seconds] isn't positive, the capture runs until [Self::stop_trace_capture].
+	#[func]
+	fn start_trace_capture(&self, path: String, seconds: f64) -> bool {
+		tracing_helpers::start_trace_capture(&tracing_helpers::globalize_path(&path), seconds)
+	}
+
+	/// Stops the trace capture in progress, and returns the path it was written to.
+	#[func]
+	fn stop_trace_capture(&self) -> String {
+		tracing_helpers::stop_trace_capture()
+			.map(|path| path.to_string_lossy().to_string())
+			.unwrap_or_default()
+	}
+
+	/// Returns the current counters, gauges and histograms. Durations are in microseconds.
+	#[func]
+	fn get_metrics(&self) -> VarDictionary {
+		metrics_snapshot_to_dict(&METRICS.snapshot())
+	}
+
+	/// Returns the entries and bytes held by each subsystem, and updates the `memory_*` gauges in the metrics.
+	/// Measuring the branch and binary docs saves every doc, so it blocks the editor for a while on big projects.
+	#[func]
+	fn get_memory_report(&self, measure_docs: bool) -> VarDictionary {
+		memory_report_to_dict(&self.project.get_memory_report(measure_docs))
+	}
+
 	#[func]
 	fn get_current_ref_string(&self) -> String {
 		let Some(ref_) = self.project.get_current_ref() else {
@@ -541,8 +618,12 @@ impl INode for GodotProject {
 					}
 					self.base_mut().call_deferred("emit_signal", &["checked_out_branch".to_variant()]);
 				}
-				GodotProjectSignal::ChangesIngested => {
-					self.base_mut().call_deferred("emit_signal", &["state_changed".to_variant()]);
+				GodotProjectSignal::StateChanged(delta) => {
+					let delta = self.ui_state_delta_to_dict(&delta);
+					self.base_mut().call_deferred("emit_signal", &["state_changed".to_variant(), delta.to_variant()]);
+				}
+				GodotProjectSignal::DiffLoaded => {
+					self.base_mut().call_deferred("emit_signal", &["diff_loaded".to_variant()]);
 				}
 			}
 		}
@@ -0,0 +1,372 @@
+use godot::classes::{
+    CanvasItem, CanvasLayer, CapsuleShape2D, CircleShape2D, CollisionShape2D, ColorRect, Control,
+    INode2D, Node2D, RectangleShape2D, ResourceLoader, Shader, ShaderMaterial,
+};
+use godot::prelude::*;
+use indexmap::IndexMap;
+
+use crate::interop::godot_diffs::PatchworkNodeDiff;
+
+const CONTAINER_NAME: &str = "PatchworkHighlightChangesLayerContainer";
+const LAYER_NAME: &str = "PatchworkHighlightChangesLayer";
+const CONTAINER_LAYER: i32 = 1025;
+const SHADER_PATH: &str = "res://addons/patchwork/public/gdscript/highlight_shader.gdshader";
+/// Must match MAX_RECTANGLES in the shader.
+const MAX_RECTANGLES: usize = 1250;
+/// The size of the box drawn around nodes that don't have a rect of their own.
+const FALLBACK_SIZE: f32 = 50.0;
+
+const MODIFIED_COLOR: Color = Color::from_rgba(0.75, 0.75, 0.75, 1.0);
+const ADDED_COLOR: Color = Color::from_rgba(0.18, 0.8, 0.251, 1.0);
+const FILL_COLOR: Color = Color::from_rgba(0.25, 0.25, 0.25, 0.85);
+
+/// Where a [HighlightItem]'s box comes from.
+#[derive(Clone, Copy)]
+enum ItemRect {
+    /// A rect in the node's own coordinates.
+    Local(Rect2),
+    /// A fixed size box around the node's position.
+    Fallback,
+}
+
+/// A canvas item whose box contributes to a highlight.
+struct HighlightItem {
+    node: InstanceId,
+    rect: ItemRect,
+    global_transform: Transform2D,
+    global_rect: Rect2,
+}
+
+impl HighlightItem {
+    fn new(node: &Gd<CanvasItem>, rect: ItemRect) -> Self {
+        let global_transform = node.get_global_transform();
+        Self {
+            node: node.instance_id(),
+            rect,
+            global_transform,
+            global_rect: global_rect(rect, global_transform),
+        }
+    }
+}
+
+/// A highlighted node: the node and its descendants that have a rect.
+struct HighlightEntry {
+    items: Vec<HighlightItem>,
+    modified: bool,
+    /// The merged box of all items, in global coordinates.
+    rect: Option<Rect2>,
+}
+
+impl HighlightEntry {
+    fn new(node: &Gd<Node>, modified: bool) -> Self {
+        let mut items = Vec::new();
+        collect_items(node, &mut items);
+        if !items.iter().any(|item| item.global_rect.has_area())
+            && let Ok(node_2d) = node.clone().try_cast::<Node2D>()
+        {
+            items.push(HighlightItem::new(&node_2d.upcast(), ItemRect::Fallback));
+        }
+        let mut entry = Self {
+            items,
+            modified,
+            rect: None,
+        };
+        entry.merge_rects();
+        entry
+    }
+
+    fn merge_rects(&mut self) {
+        self.rect = merged_rect(self.items.iter().map(|item| item.global_rect));
+    }
+
+    /// Picks up moved and freed nodes. Returns true if the box changed.
+    fn refresh(&mut self) -> bool {
+        let mut changed = false;
+        self.items.retain_mut(|item| {
+            let Ok(node) = Gd::<CanvasItem>::try_from_instance_id(item.node) else {
+                changed = true;
+                return false;
+            };
+            let global_transform = node.get_global_transform();
+            if global_transform != item.global_transform {
+                item.global_transform = global_transform;
+                item.global_rect = global_rect(item.rect, global_transform);
+                changed = true;
+            }
+            true
+        });
+        if !changed {
+            return false;
+        }
+        let old_rect = self.rect;
+        self.merge_rects();
+        self.rect != old_rect
+    }
+}
+
+/// Draws boxes over the changed nodes of the edited scene.
+/// Node handles and their boxes are resolved once per highlight; after that, only nodes that moved are
+/// re-measured, and the shader is only updated when a box actually changed.
+/// Moves are found by comparing each item's global transform once a frame. Transform notifications only reach the
+/// node that moved, and the highlighted nodes belong to the edited scene, so we can't subscribe to them.
+/// Processing stops while nothing is highlighted.
+#[derive(GodotClass)]
+#[class(init, base=Node2D, tool)]
+pub struct HighlightChangesLayer {
+    base: Base<Node2D>,
+    color_rect: Option<Gd<ColorRect>>,
+    shader_material: Option<Gd<ShaderMaterial>>,
+    overlay_position: Vector2,
+    overlay_size: Vector2,
+    /// Keyed by node path, in the order the diffs were given.
+    entries: IndexMap<String, HighlightEntry>,
+    dirty: bool,
+}
+
+#[godot_api]
+impl INode2D for HighlightChangesLayer {
+    fn ready(&mut self) {
+        let mut color_rect = ColorRect::new_alloc();
+        color_rect.set_name("PatchworkColorRect");
+        color_rect.set_color(Color::from_rgba(1.0, 0.0, 0.0, 0.75));
+        color_rect.set_size(Vector2::new(1000.0, 1000.0));
+
+        let mut shader_material = ShaderMaterial::new_gd();
+        if let Some(shader) = ResourceLoader::singleton()
+            .load(SHADER_PATH)
+            .and_then(|resource| resource.try_cast::<Shader>().ok())
+        {
+            shader_material.set_shader(&shader);
+        }
+        shader_material.set_shader_parameter("fill_color", &FILL_COLOR.to_variant());
+        color_rect.set_material(&shader_material);
+
+        self.base_mut().add_child(&color_rect);
+        self.color_rect = Some(color_rect);
+        self.shader_material = Some(shader_material);
+        self.dirty = true;
+    }
+
+    fn process(&mut self, _delta: f64) {
+        if self.entries.is_empty() {
+            if self.dirty {
+                self.update_overlay();
+            }
+            self.base_mut().set_process(false);
+            return;
+        }
+        for entry in self.entries.values_mut() {
+            if entry.refresh() {
+                self.dirty = true;
+            }
+        }
+        if self.dirty {
+            self.update_overlay();
+        }
+    }
+}
+
+#[godot_api]
+impl HighlightChangesLayer {
+    /// Highlights the nodes of the given PatchworkNodeDiffs in the scene under root.
+    /// Calling this again reuses the boxes of nodes that were already highlighted.
+    #[func]
+    fn highlight_changes(mut root: Gd<Node>, node_diffs: VarArray) {
+        let mut container = match root
+            .get_node_or_null(CONTAINER_NAME)
+            .and_then(|node| node.try_cast::<CanvasLayer>().ok())
+        {
+            Some(container) => container,
+            None => {
+                let mut container = CanvasLayer::new_alloc();
+                container.set_name(CONTAINER_NAME);
+                container.set_layer(CONTAINER_LAYER);
+                root.add_child(&container);
+                container
+            }
+        };
+        let mut layer = match container
+            .get_node_or_null(LAYER_NAME)
+            .and_then(|node| node.try_cast::<HighlightChangesLayer>().ok())
+        {
+            Some(layer) => layer,
+            None => {
+                let mut layer = HighlightChangesLayer::new_alloc();
+                layer.set_name(LAYER_NAME);
+                container.add_child(&layer);
+                layer
+            }
+        };
+
+        let node_diffs: Vec<(String, bool)> = node_diffs
+            .iter_shared()
+            .filter_map(|diff| diff.try_to::<Gd<PatchworkNodeDiff>>().ok())
+            .map(|diff| {
+                let diff = diff.bind();
+                (
+                    diff.get_node_path().to_string(),
+                    diff.get_change_type().to_string() == "modified",
+                )
+            })
+            .collect();
+        layer.bind_mut().set_highlights(&root, node_diffs);
+    }
+
+    /// Removes the highlight from the scene under root, if any.
+    #[func]
+    fn remove_highlight(mut root: Gd<Node>) {
+        if let Some(mut container) = root.get_node_or_null(CONTAINER_NAME) {
+            root.remove_child(&container);
+            container.queue_free();
+        }
+    }
+}
+
+impl HighlightChangesLayer {
+    fn set_highlights(&mut self, root: &Gd<Node>, node_diffs: Vec<(String, bool)>) {
+        // bounding box calculation doesn't work perfectly for the root node so we scale it by three to make sure we cover the whole scene
+        let mut root_items = Vec::new();
+        collect_items(root, &mut root_items);
+        let bounding_box =
+            merged_rect(root_items.iter().map(|item| item.global_rect)).unwrap_or_default();
+        self.overlay_size = bounding_box.size * 3.0;
+        self.overlay_position = bounding_box.position - bounding_box.size;
+
+        let mut entries = IndexMap::with_capacity(node_diffs.len());
+        for (node_path, modified) in node_diffs {
+            if let Some(mut entry) = self.entries.shift_remove(&node_path) {
+                entry.modified = modified;
+                entries.insert(node_path, entry);
+                continue;
+            }
+            let Some(node) = root.get_node_or_null(node_path.as_str()) else {
+                tracing::debug!("node not found: {}", node_path);
+                continue;
+            };
+            entries.insert(node_path, HighlightEntry::new(&node, modified));
+        }
+        self.entries = entries;
+        self.dirty = true;
+        self.base_mut().set_process(true);
+    }
+
+    fn update_overlay(&mut self) {
+        let (Some(color_rect), Some(shader_material)) =
+            (self.color_rect.as_mut(), self.shader_material.as_mut())
+        else {
+            return;
+        };
+        self.dirty = false;
+        color_rect.set_size(self.overlay_size);
+        color_rect.set_global_position(self.overlay_position);
+
+        let mut rects = Array::<Vector4>::new();
+        let mut colors = Array::<Color>::new();
+        for entry in self.entries.values() {
+            if rects.len() >= MAX_RECTANGLES {
+                break;
+            }
+            let Some(rect) = entry.rect else {
+                continue;
+            };
+            // Normalize to the overlay
+            let position = (rect.position - self.overlay_position) / self.overlay_size;
+            let size = rect.size / self.overlay_size;
+            rects.push(Vector4::new(position.x, position.y, size.x, size.y));
+            colors.push(if entry.modified {
+                MODIFIED_COLOR
+            } else {
+                ADDED_COLOR
+            });
+        }
+        shader_material.set_shader_parameter("rectangle_count", &(rects.len() as i64).to_variant());
+        shader_material.set_shader_parameter("rectangles", &rects.to_variant());
+        shader_material.set_shader_parameter("rectangles_color", &colors.to_variant());
+    }
+}
+
+/// Collects the canvas items under node that have a rect, skipping our own overlay.
+fn collect_items(node: &Gd<Node>, items: &mut Vec<HighlightItem>) {
+    if node.clone().try_cast::<HighlightChangesLayer>().is_ok() {
+        return;
+    }
+    if let Ok(canvas_item) = node.clone().try_cast::<CanvasItem>()
+        && let Some(rect) = local_rect(&canvas_item)
+    {
+        items.push(HighlightItem::new(&canvas_item, ItemRect::Local(rect)));
+    }
+    for child in node.get_children().iter_shared() {
+        collect_items(&child, items);
+    }
+}
+
+/// The rect of a canvas item in its own coordinates, if it has one.
+fn local_rect(node: &Gd<CanvasItem>) -> Option<Rect2> {
+    if let Ok(collision_shape) = node.clone().try_cast::<CollisionShape2D>() {
+        let shape = collision_shape.get_shape()?;
+        if let Ok(circle) = shape.clone().try_cast::<CircleShape2D>() {
+            let radius = circle.get_radius();
+            return Some(Rect2::from_components(
+                -radius,
+                -radius,
+                radius * 2.0,
+                radius * 2.0,
+            ));
+        }
+        if let Ok(rectangle) = shape.clone().try_cast::<RectangleShape2D>() {
+            let size = rectangle.get_size();
+            return Some(Rect2::new(-size / 2.0, size));
+        }
+        if let Ok(capsule) = shape.try_cast::<CapsuleShape2D>() {
+            let radius = capsule.get_radius();
+            let height = capsule.get_height();
+            return Some(Rect2::from_components(
+                -radius,
+                -height / 2.0 - radius,
+                radius * 2.0,
+                height + radius * 2.0,
+            ));
+        }
+        return None;
+    }
+    // get_rect() on a Control is in its parent's coordinates, so it would be offset twice by the global transform
+    if let Ok(control) = node.clone().try_cast::<Control>() {
+        return Some(Rect2::new(Vector2::ZERO, control.get_size()));
+    }
+    if node.has_method("get_rect") {
+        return node.clone().call("get_rect", &[]).try_to::<Rect2>().ok();
+    }
+    None
+}
+
+fn global_rect(rect: ItemRect, transform: Transform2D) -> Rect2 {
+    match rect {
+        ItemRect::Local(rect) => {
+            let corners = [
+                rect.position,
+                Vector2::new(rect.end().x, rect.position.y),
+                Vector2::new(rect.position.x, rect.end().y),
+                rect.end(),
+            ]
+            .map(|corner| transform * corner);
+            let min = corners
+                .iter()
+                .fold(corners[0], |min, corner| min.coord_min(*corner));
+            let max = corners
+                .iter()
+                .fold(corners[0], |max, corner| max.coord_max(*corner));
+            Rect2::new(min, max - min)
+        }
+        ItemRect::Fallback => Rect2::new(
+            transform.origin - Vector2::splat(FALLBACK_SIZE / 2.0),
+            Vector2::splat(FALLBACK_SIZE),
+        ),
+    }
+}
+
+/// Merges the rects that have an area.
+fn merged_rect(rects: impl Iterator<Item = Rect2>) -> Option<Rect2> {
+    rects
+        .filter(|rect| rect.has_area())
+        .reduce(|merged, rect| merged.merge(rect))
+}
@@ -3,6 +3,8 @@ use godot::global::Error;
 use godot::prelude::*;
 use godot::builtin::{Variant};
 
+use crate::helpers::tracing::{TracingConfig, apply_tracing_config};
+
 #[derive(GodotClass)]
 #[class(base=Object)]
 pub struct PatchworkConfig {
@@ -17,6 +19,8 @@ pub struct PatchworkConfig {
 const CONFIG_FILE_NAME: &str = "patchwork.cfg";
 const USER_DIR_NAME: &str = "patchwork_plugin";
 const CONFIG_PROJECT_FILE: &str = "res://patchwork.cfg";
+/// User settings with these prefixes configure tracing, and are applied as soon as they're set.
+const TRACING_KEY_PREFIXES: &[&str] = &["log_", "trace_"];
 
 #[godot_api]
 impl PatchworkConfig {
@@ -51,7 +55,38 @@ impl PatchworkConfig {
         if self.user_config.save(&self.user_config_path) != Error::OK{
             godot_error!("Failed to save patchwork user configuration");
         }
+		let key = key.to_string();
+		if TRACING_KEY_PREFIXES.iter().any(|prefix| key.starts_with(prefix)) {
+			self.reload_tracing();
+		}
     }
+
+	/// Re-reads the tracing settings from the user config and applies them to the running tracing layers.
+	#[func]
+	pub fn reload_tracing(&self) {
+		apply_tracing_config(&self.get_tracing_config());
+	}
+
+	pub fn get_tracing_config(&self) -> TracingConfig {
+		let defaults = TracingConfig::default();
+		let string = |key: &str, default: &String| -> String {
+			self.get_user_value(key.into(), default.to_variant()).try_to::<String>().unwrap_or(default.clone())
+		};
+		let seconds = self.get_user_value("trace_startup_seconds".into(), defaults.startup_trace_seconds.to_variant());
+		// Accept whole seconds too, since the config file stores `30` as an int.
+		let startup_trace_seconds = seconds.try_to::<f64>()
+			.or_else(|_| seconds.try_to::<i64>().map(|seconds| seconds as f64))
+			.unwrap_or(defaults.startup_trace_seconds);
+		TracingConfig {
+			stdout_filter: string("log_stdout_filter", &defaults.stdout_filter),
+			file_filter: string("log_file_filter", &defaults.file_filter),
+			trace_filter: string("trace_filter", &defaults.trace_filter),
+			hot_span_rate: self.get_user_value("trace_hot_span_rate".into(), defaults.hot_span_rate.to_variant())
+				.try_to::<u32>().unwrap_or(defaults.hot_span_rate),
+			startup_trace_path: string("trace_startup_path", &defaults.startup_trace_path),
+			startup_trace_seconds,
+		}
+	}
 }
 
 #[godot_api]
@@ -1,14 +1,14 @@
-use std::collections::HashSet;
-use std::fs::File;
-use std::io::Write;
-use std::path::{Path, PathBuf};
+use std::path::Path;
 use std::str::FromStr;
+use std::sync::Arc;
 
-use godot::builtin::{GString, PackedStringArray, StringName, VarDictionary, Variant};
+use godot::builtin::{
+    GString, PackedByteArray, PackedStringArray, StringName, VarDictionary, Variant,
+};
 use godot::classes::resource_loader::CacheMode;
 use godot::classes::{
-    ConfigFile, IResourceFormatLoader, IResourceFormatSaver, ProjectSettings, Resource,
-    ResourceFormatLoader, ResourceFormatSaver, ResourceLoader, ResourceUid,
+    IResourceFormatLoader, IResourceFormatSaver, ProjectSettings, Resource, ResourceFormatLoader,
+    ResourceFormatSaver, ResourceLoader, ResourceUid,
 };
 use godot::global::Error;
 use godot::prelude::*;
@@ -17,8 +17,9 @@ use uuid::Uuid;
 use crate::fs::file_utils::FileContent;
 use crate::helpers::history_path::HistoryRefPath;
 use crate::helpers::history_ref::HistoryRef;
-use crate::interop::godot_accessors::PatchworkEditorAccessor;
-use crate::interop::godot_project::GodotProject;
+use crate::interop::godot_accessors::{MEMORY_PATH_SCHEME, PatchworkEditorAccessor};
+use crate::project::branch_db::{ImportSettings, ResourceMetadata};
+use crate::project::history_reader::HistoryReader;
 
 /// This class allows us to load resources directly from patchwork history.
 /// It is registered as a resource format loader with Godot.
@@ -35,65 +36,33 @@ fn recognize_path(path: GString) -> bool {
     HistoryRefPath::recognize_path(&path.to_string())
 }
 impl PatchworkResourceLoader {
-    fn get_content_at_ref_path_str(&self, ref_path_str: &str) -> Result<FileContent, Error> {
-        let history_ref_path = match HistoryRefPath::from_str(ref_path_str) {
-            Ok(history_ref_path) => history_ref_path,
-            Err(_) => return Err(Error::ERR_FILE_UNRECOGNIZED),
-        };
-        self.get_content_at_history_ref_path(&history_ref_path)
+    fn get_metadata_at_ref_path_str(&self, ref_path_str: &str) -> Option<Arc<ResourceMetadata>> {
+        let history_ref_path = HistoryRefPath::from_str(ref_path_str).ok()?;
+        self.get_metadata_at_history_ref_path(&history_ref_path)
     }
 
-    fn get_content_at_history_ref_path(
+    fn get_metadata_at_history_ref_path(
         &self,
         history_ref_path: &HistoryRefPath,
-    ) -> Result<FileContent, Error> {
-        let Some(content) = GodotProject::get_singleton()
-            .bind()
-            .get_file_at_ref(&history_ref_path.path, &history_ref_path.ref_)
-        else {
-            return Err(Error::ERR_FILE_NOT_FOUND);
-        };
-
-        Ok(content)
+    ) -> Option<Arc<ResourceMetadata>> {
+        HistoryReader::current()?
+            .get_resource_metadata_at_ref(&history_ref_path.path, &history_ref_path.ref_)
     }
 
-    fn get_content_and_import_file_content_at_history_ref_path(
+    fn get_content_and_import_settings_at_history_ref_path(
         &self,
         history_ref_path: &HistoryRefPath,
-    ) -> Result<(FileContent, Option<FileContent>), Error> {
-        let import_path = format!("{}.import", history_ref_path.path);
-        let Some(contents) = GodotProject::get_singleton().bind().get_files_at_ref(
-            &history_ref_path.ref_,
-            &HashSet::from([history_ref_path.path.clone(), import_path.clone()]),
-        ) else {
-            return Err(Error::ERR_FILE_NOT_FOUND);
-        };
-        let content = contents
-            .get(&history_ref_path.path)
-            .ok_or(Error::ERR_FILE_NOT_FOUND)?
-            .to_owned();
-        let import_content = contents.get(&import_path);
-        let mut import_content = if import_content.is_none() {
-            None
-        } else {
-            Some(import_content.unwrap().to_owned())
-        };
-        if import_content.is_none() {
-            let current_ref = GodotProject::get_singleton().bind().get_current_ref();
-            if let Some(current_ref) = current_ref {
-                import_content = GodotProject::get_singleton()
-                    .bind()
-                    .get_file_at_ref(&import_path, &current_ref);
-            }
-        }
-        Ok((content, import_content))
+    ) -> Result<(FileContent, Option<Arc<ImportSettings>>), Error> {
+        let reader = HistoryReader::current().ok_or(Error::ERR_UNAVAILABLE)?;
+        reader
+            .get_resource_and_import_settings_at_ref(&history_ref_path.path, &history_ref_path.ref_)
+            .ok_or(Error::ERR_FILE_NOT_FOUND)
     }
+
+    /// Returns the bytes Godot should load for [content]. For scenes, this rewrites every
     /// ext_resource path to the patchwork path at the same history ref and sets UIDs to -1
     /// (None) so Godot loads by path via this loader.
-    fn content_bytes_for_temp(
-        content: &FileContent,
-        history_ref: &HistoryRef,
-    ) -> Result<Vec<u8>, Error> {
+    fn content_bytes(content: &FileContent, history_ref: &HistoryRef) -> Result<Vec<u8>, Error> {
         match content {
             FileContent::Scene(scene) => Ok(scene
                 .serialize_with_ext_resource_override(Some(history_ref), true)
@@ -104,75 +73,50 @@ impl PatchworkResourceLoader {
         }
     }
 
-    fn get_temp_path(history_ref_path: &HistoryRefPath, override_ext: Option<&str>) -> PathBuf {
-        let path = history_ref_path
-            .path
-            .strip_prefix("res://")
-            .unwrap_or(&history_ref_path.path);
-        let ext = if let Some(override_ext) = override_ext {
-            override_ext
-        } else {
-            Path::new(&path)
-                .extension()
-                .and_then(|e| e.to_str())
-                .unwrap_or("res")
-        };
-        let temp_name = format!("patchwork_{}.{}", Uuid::new_v4(), ext);
-        let temp_path = std::env::temp_dir().join(&temp_name);
-        temp_path
+    /// Returns the in-memory path for a file in [memory_dir], named like the file at [history_ref_path].
+    fn get_memory_path(memory_dir: &MemoryDir, history_ref_path: &HistoryRefPath) -> String {
+        let file_name = Path::new(&history_ref_path.path)
+            .file_name()
+            .and_then(|name| name.to_str())
+            .unwrap_or("resource.res");
+        format!("{}{}", memory_dir.0, file_name)
     }
 
-    fn remove_temp_path(temp_path: &PathBuf) -> Result<(), Error> {
-        if std::fs::remove_file(temp_path).is_err() {
-            return Err(Error::ERR_CANT_CREATE);
-        }
-        Ok(())
-    }
-
-    fn write_content_to_temp_file(
+    fn write_content_to_memory(
         content: &FileContent,
         history_ref: &HistoryRef,
-        temp_path: &PathBuf,
+        memory_path: &str,
     ) -> Result<(), Error> {
-        let bytes = match Self::content_bytes_for_temp(&content, history_ref) {
-            Ok(b) => b,
-            Err(e) => return Err(e),
-        };
-
-        let mut file = match File::create(&temp_path) {
-            Ok(f) => f,
-            Err(_) => return Err(Error::ERR_CANT_CREATE),
-        };
-        if file.write_all(&bytes).is_err() {
-            return Err(Error::ERR_CANT_CREATE);
-        }
-        drop(file);
+        let bytes = Self::content_bytes(content, history_ref)?;
+        PatchworkEditorAccessor::register_memory_file(
+            memory_path,
+            &PackedByteArray::from(bytes.as_slice()),
+        );
         Ok(())
     }
 
-    fn get_path_and_type_from_import_file_content(
-        &self,
-        import_file_content: &str,
-    ) -> (GString, GString) {
-        let mut import_file = ConfigFile::new_gd();
-        import_file.parse(import_file_content);
-        let mut path = import_file.get_value("remap", "path");
-        let mut type_name = import_file.get_value("remap", "type");
-        if path.is_nil() {
-            let remap_keys = import_file.get_section_keys("remap");
-            for i in 0..remap_keys.len() {
-                let remap_key = remap_keys.get(i);
-                let remap_key_str = remap_key.unwrap_or_default().to_string();
-                if remap_key_str.starts_with("path") {
-                    path = import_file.get_value("remap", &remap_key_str);
-                    break;
-                }
-            }
+    /// Loads the resource at an in-memory path. When Godot asks for sub-threads, its dependencies
+    /// are requested as threaded loads too, so they can load in parallel.
+    fn load_from_memory(
+        memory_path: &str,
+        cache_mode: CacheMode,
+        use_sub_threads: bool,
+    ) -> Option<Gd<Resource>> {
+        let mut loader = ResourceLoader::singleton();
+        let memory_path = GString::from(memory_path);
+        if !use_sub_threads {
+            return loader.load_ex(&memory_path).cache_mode(cache_mode).done();
         }
-        if type_name.is_nil() {
-            type_name = import_file.get_value("remap", "type");
+        let err = loader
+            .load_threaded_request_ex(&memory_path)
+            .use_sub_threads(true)
+            .cache_mode(cache_mode)
+            .done();
+        if err != Error::OK {
+            return None;
         }
-        (path.to::<GString>(), type_name.to::<GString>())
+        // Blocks until the load (including its sub-threads) is done.
+        loader.load_threaded_get(&memory_path)
     }
 }
 
@@ -222,25 +166,17 @@ impl IResourceFormatLoader for PatchworkResourceLoader {
             "tres" => {}                // break, we handle it below
             _ => return GString::new(), // let the other loaders handle it
         }
-        let content = match self.get_content_at_ref_path_str(&path.to_string()) {
-            Ok(content) => content,
-            Err(_) => return GString::new(),
+        let Some(metadata) = self.get_metadata_at_ref_path_str(&path.to_string()) else {
+            return GString::new();
         };
-        if let FileContent::Scene(scn) = content {
-            return GString::from(&scn.resource_type);
-        }
-        return GString::new();
+        GString::from(metadata.resource_type.as_deref().unwrap_or_default())
     }
 
     fn get_resource_script_class(&self, _path: GString) -> GString {
-        let content = match self.get_content_at_ref_path_str(&_path.to_string()) {
-            Ok(content) => content,
-            Err(_) => return GString::new(),
+        let Some(metadata) = self.get_metadata_at_ref_path_str(&_path.to_string()) else {
+            return GString::new();
         };
-        if let FileContent::Scene(scn) = content {
-            return GString::from(&scn.script_class.unwrap_or_default());
-        }
-        return GString::new();
+        GString::from(metadata.script_class.as_deref().unwrap_or_default())
     }
 
     fn get_resource_uid(&self, path: GString) -> i64 {
@@ -256,35 +192,21 @@ impl IResourceFormatLoader for PatchworkResourceLoader {
         if !has_custom_uid {
             history_ref_path.path = history_ref_path.path + ".uid";
         }
-        let content = match self.get_content_at_history_ref_path(&history_ref_path) {
-            Ok(content) => content,
-            Err(_) => return -1,
-        };
-        if !has_custom_uid {
-            if let FileContent::String(string) = content {
-                return ResourceUid::singleton().text_to_id(&string);
-            }
+        // For scenes this is the scene's uid; for scripts, the contents of the .uid file.
+        let Some(uid) = self
+            .get_metadata_at_history_ref_path(&history_ref_path)
+            .and_then(|metadata| metadata.uid.clone())
+        else {
             return -1;
-        }
-        if let FileContent::Scene(scn) = content {
-            return ResourceUid::singleton().text_to_id(&scn.uid);
-        }
-        return -1;
+        };
+        ResourceUid::singleton().text_to_id(&uid)
     }
 
     fn get_dependencies(&self, _path: GString, _add_types: bool) -> PackedStringArray {
-        let content = match self.get_content_at_ref_path_str(&_path.to_string()) {
-            Ok(content) => content,
-            Err(_) => return PackedStringArray::new(),
+        let Some(metadata) = self.get_metadata_at_ref_path_str(&_path.to_string()) else {
+            return PackedStringArray::new();
         };
-        if let FileContent::Scene(scn) = content {
-            return PackedStringArray::from_iter(
-                scn.ext_resources
-                    .iter()
-                    .map(|(_id, ext_resource)| GString::from(&ext_resource.path)),
-            );
-        }
-        return PackedStringArray::new();
+        PackedStringArray::from_iter(metadata.dependencies.iter().map(GString::from))
     }
 
     fn rename_dependencies(&self, _path: GString, _renames: VarDictionary) -> Error {
@@ -304,7 +226,7 @@ impl IResourceFormatLoader for PatchworkResourceLoader {
         &self,
         path: GString,
         _original_path: GString,
-        _use_sub_threads: bool,
+        use_sub_threads: bool,
         cache_mode_ord: i32,
     ) -> Variant {
         let cache_mode = CacheMode::try_from_ord(cache_mode_ord).unwrap_or(CacheMode::IGNORE);
@@ -317,80 +239,68 @@ impl IResourceFormatLoader for PatchworkResourceLoader {
             }
         };
 
-        let (content, import_file_content) =
-            match self.get_content_and_import_file_content_at_history_ref_path(&history_ref_path) {
+        let (content, import_settings) =
+            match self.get_content_and_import_settings_at_history_ref_path(&history_ref_path) {
                 Ok(c) => c,
                 Err(e) => {
                     tracing::error!("Error getting content at history ref path: {}", e.as_str());
                     return Variant::nil();
                 }
             };
-        let mut temp_path = Self::get_temp_path(&history_ref_path, None);
+        // Everything this load reads or writes lives in its own in-memory directory,
+        // which is dropped when the load finishes.
+        let memory_dir = MemoryDir::new();
+        let mut memory_path = Self::get_memory_path(&memory_dir, &history_ref_path);
 
-        match Self::write_content_to_temp_file(&content, &history_ref_path.ref_, &temp_path) {
-            Ok(_) => (),
-            Err(e) => {
-                tracing::error!(
-                    "Error writing content to temp at path {}: {}",
-                    path_str,
-                    e.as_str()
-                );
-                return Variant::nil();
-            }
-        };
+        if let Err(e) =
+            Self::write_content_to_memory(&content, &history_ref_path.ref_, &memory_path)
+        {
+            tracing::error!(
+                "Error writing content to memory at path {}: {}",
+                path_str,
+                e.as_str()
+            );
+            return Variant::nil();
+        }
 
-        if let Some(FileContent::String(import_file_content)) = import_file_content {
-            let (import_base_path, _type_name) =
-                self.get_path_and_type_from_import_file_content(&import_file_content);
-            let ext = import_base_path.get_extension().to_string().to_lowercase();
-            let temp_imported_path = Self::get_temp_path(&history_ref_path, Some(&ext));
-            // temp_imported_path minus the extension
-            let temp_base_name = temp_imported_path.to_string_lossy().to_string().strip_suffix(&format!(".{}", ext)).unwrap_or(&temp_imported_path.to_string_lossy().to_string()).to_string();
+        if let Some(import_settings) = import_settings {
+            let imported_base_path = format!("{}imported", memory_dir.0);
             let err = PatchworkEditorAccessor::import_and_save_resource(
-                &temp_path.to_string_lossy().to_string(),
-                &import_file_content,
-                &temp_base_name,
+                &memory_path,
+                &import_settings.content,
+                &imported_base_path,
             );
-            let _ = Self::remove_temp_path(&temp_path);
 
             if err != Error::OK {
                 tracing::error!(
                     "Error importing and saving resource at path {}: {}",
-                    temp_path.to_string_lossy().to_string(),
+                    path_str,
                     err.as_str()
                 );
                 return Variant::nil();
             }
-            temp_path = temp_imported_path.clone();
+            memory_path = format!(
+                "{}.{}",
+                imported_base_path, import_settings.imported_extension
+            );
         }
 
-        let temp_path_godot =
-            GString::from(&temp_path.to_string_lossy().to_string()).simplify_path();
-
-        let mut loader = ResourceLoader::singleton();
         let sub_cache_mode = match cache_mode {
             CacheMode::IGNORE_DEEP => CacheMode::IGNORE_DEEP,
             CacheMode::REPLACE => CacheMode::REPLACE,
             CacheMode::REPLACE_DEEP => CacheMode::REPLACE_DEEP,
-            // Loading with "IGNORE" will not cache the temp file,
+            // Loading with "IGNORE" will not cache the in-memory file,
             // but it will allow sub-resources to be re-used since the resource loader passes `REUSE` when the cache mode is `IGNORE`
             _ => CacheMode::IGNORE,
         };
-        let ret = match loader
-            .load_ex(&temp_path_godot)
-            .cache_mode(sub_cache_mode)
-            .done()
-        {
+        let ret = match Self::load_from_memory(&memory_path, sub_cache_mode, use_sub_threads) {
             Some(resource) => resource.to_variant(),
             None => {
-                tracing::error!("Error loading resource: {}", temp_path_godot.to_string());
-                let _ = Self::remove_temp_path(&temp_path);
+                tracing::error!("Error loading resource: {}", memory_path);
                 return Variant::nil();
             }
         };
 
-        let _ = Self::remove_temp_path(&temp_path);
-
         let mut resource = match ret.try_to::<Gd<Resource>>() {
             Ok(res) => res,
             Err(_) => {
@@ -417,6 +327,21 @@ impl IResourceFormatLoader for PatchworkResourceLoader {
     }
 }
 
+/// A unique directory in the editor's in-memory file system. Removes every file under it when dropped.
+struct MemoryDir(String);
+
+impl MemoryDir {
+    fn new() -> Self {
+        Self(format!("{}{}/", MEMORY_PATH_SCHEME, Uuid::new_v4()))
+    }
+}
+
+impl Drop for MemoryDir {
+    fn drop(&mut self) {
+        PatchworkEditorAccessor::remove_memory_files(&self.0);
+    }
+}
+
 #[derive(GodotClass)]
 #[class(base = ResourceFormatSaver)]
 pub struct PatchworkResourceFormatSaver {
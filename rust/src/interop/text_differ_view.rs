@@ -1,6 +1,21 @@
+use std::sync::Arc;
+
+use godot::builtin::{Color, Rect2, StringName, Vector2};
+use godot::classes::notify::ControlNotification;
+use godot::classes::{
+    Control, EditorInterface, Font, HScrollBar, IControl, InputEvent, InputEventMouseButton, Range,
+    Theme, VScrollBar,
+};
+use godot::global::{HorizontalAlignment, MouseButton};
 use godot::prelude::*;
-use godot::classes::{RichTextLabel, EditorInterface, Theme};
-use godot::builtin::{VarDictionary, Array, GString, StringName};
+
+use crate::{
+    diff::{
+        differ::{Diff, ProjectDiff},
+        text_differ::{TextDiff, TextDiffLine},
+    },
+    interop::godot_diffs::PatchworkFileDiff,
+};
 
 #[derive(GodotClass)]
 #[class(base=Object)]
@@ -9,355 +24,592 @@ pub struct TextDifferView {
     base: Base<Object>,
 }
 
-struct DiffLine {
-    new_line_no: i64,
-    old_line_no: i64,
-    content: String,
-    status: String,
+#[godot_api]
+impl TextDifferView {
+    /// Creates a view of a text file's diff. Returns null if the file isn't a text diff.
+    #[func]
+    pub fn get_text_diff_view(
+        diff: Gd<PatchworkFileDiff>,
+        split_view: bool,
+    ) -> Option<Gd<TextDiffView>> {
+        let (diff, index) = diff.bind().get_text_diff_source()?;
+        Some(TextDiffView::create(diff, index, split_view))
+    }
 }
 
-struct DiffHunk {
-    new_start: i64,
-    old_start: i64,
-    new_lines: i64,
-    old_lines: i64,
-    diff_lines: Vec<DiffLine>,
+#[godot_api]
+impl IObject for TextDifferView {
+    fn init(base: Base<Object>) -> Self {
+        Self { base }
+    }
 }
 
-struct DiffFile {
-    new_file: String,
-    old_file: String,
-    diff_hunks: Vec<DiffHunk>,
+/// How many columns a tab is expanded to.
+const TAB_SIZE: usize = 4;
+/// How tall a text diff grows before it scrolls on its own, in unscaled pixels.
+const MAX_HEIGHT: f32 = 500.0;
+/// How many rows one mouse wheel step scrolls.
+const WHEEL_ROWS: f64 = 3.0;
+
+/// One line of the view. Rows only point into the [TextDiff], so building them doesn't copy any text.
+#[derive(Clone, Copy)]
+enum DiffRow {
+    FileHeader,
+    HunkHeader(usize),
+    /// Unchanged lines before a hunk, which the diff doesn't contain.
+    Collapsed(i64),
+    /// Unified view: a line of a hunk.
+    Line {
+        hunk: usize,
+        line: usize,
+    },
+    /// Split view: a removed and/or an added line of a hunk, side by side.
+    Pair {
+        hunk: usize,
+        old: Option<usize>,
+        new: Option<usize>,
+    },
 }
 
-impl DiffLine {
-    fn from_dict(dict: &VarDictionary) -> Option<Self> {
-        Some(Self {
-            new_line_no: dict.get("new_line_no")?.to::<i64>(),
-            old_line_no: dict.get("old_line_no")?.to::<i64>(),
-            content: dict.get("content")?.to::<GString>().to_string(),
-            status: dict.get("status")?.to::<GString>().to_string(),
-        })
-    }
+/// Fonts and colors from the editor theme, and the metrics derived from them.
+struct DiffStyle {
+    header_font: Gd<Font>,
+    header_font_size: i32,
+    font: Gd<Font>,
+    font_size: i32,
+    line_height: f32,
+    ascent: f32,
+    char_width: f32,
+    accent_color: Color,
+    added_color: Color,
+    removed_color: Color,
+    default_color: Color,
 }
 
-impl DiffHunk {
-    fn from_dict(dict: &VarDictionary) -> Option<Self> {
-        let diff_lines_array = dict.get("diff_lines")?.to::<Array<VarDictionary>>();
-        let mut diff_lines = Vec::new();
-
-        for line_dict in diff_lines_array.iter_shared() {
-            if let Some(diff_line) = DiffLine::from_dict(&line_dict) {
-                diff_lines.push(diff_line);
-            }
-        }
+/// A text diff that only draws the rows scrolled into view, so a diff of any size opens instantly.
+/// Lines are never wrapped; long lines scroll horizontally, and only their visible columns are shaped.
+/// Unchanged regions between hunks are collapsed into a single row.
+#[derive(GodotClass)]
+#[class(no_init, base=Control)]
+pub struct TextDiffView {
+    base: Base<Control>,
+    diff: Arc<ProjectDiff>,
+    index: usize,
+    split_view: bool,
+    rows: Vec<DiffRow>,
+    /// The width of the widest line, in columns.
+    max_columns: usize,
+    /// The width of the largest line number, in digits.
+    line_number_digits: usize,
+    style: Option<DiffStyle>,
+    v_scroll: Gd<VScrollBar>,
+    h_scroll: Gd<HScrollBar>,
+}
 
-        Some(Self {
-            new_start: dict.get("new_start")?.to::<i64>(),
-            old_start: dict.get("old_start")?.to::<i64>(),
-            new_lines: dict.get("new_lines")?.to::<i64>(),
-            old_lines: dict.get("old_lines")?.to::<i64>(),
-            diff_lines,
+impl TextDiffView {
+    /// Creates a view of the text diff at [index] in [diff].
+    pub fn create(diff: Arc<ProjectDiff>, index: usize, split_view: bool) -> Gd<Self> {
+        let (rows, max_columns, line_number_digits) = match &diff.file_diffs[index] {
+            Diff::Text(text_diff) => (
+                build_rows(text_diff, split_view),
+                max_columns(text_diff),
+                max_line_number(text_diff).to_string().len(),
+            ),
+            _ => (Vec::new(), 0, 1),
+        };
+        Gd::from_init_fn(|base| Self {
+            base,
+            diff,
+            index,
+            split_view,
+            rows,
+            max_columns,
+            line_number_digits,
+            style: None,
+            v_scroll: VScrollBar::new_alloc(),
+            h_scroll: HScrollBar::new_alloc(),
         })
     }
-}
 
-impl DiffFile {
-    fn from_dict(dict: &VarDictionary) -> Option<Self> {
-        let diff_hunks_array = dict.get("diff_hunks")?.to::<Array<VarDictionary>>();
-        let mut diff_hunks = Vec::new();
-
-        for hunk_dict in diff_hunks_array.iter_shared() {
-            if let Some(diff_hunk) = DiffHunk::from_dict(&hunk_dict) {
-                diff_hunks.push(diff_hunk);
-            }
+    fn text_diff(&self) -> Option<&TextDiff> {
+        match &self.diff.file_diffs[self.index] {
+            Diff::Text(diff) => Some(diff),
+            _ => None,
         }
+    }
 
-        Some(Self {
-            new_file: dict.get("new_file")?.to::<GString>().to_string(),
-            old_file: dict.get("old_file")?.to::<GString>().to_string(),
-            diff_hunks,
+    fn load_style() -> Option<DiffStyle> {
+        let Some(theme) = EditorInterface::singleton().get_editor_theme() else {
+            godot_error!("Editor theme is none");
+            return None;
+        };
+        let editor_fonts = StringName::from("EditorFonts");
+        let header_font = theme.get_font(&StringName::from("doc_bold"), &editor_fonts)?;
+        let header_font_size = theme.get_font_size(&StringName::from("doc_size"), &editor_fonts);
+        let font = theme.get_font(&StringName::from("status_source"), &editor_fonts)?;
+        let font_size = theme.get_font_size(&StringName::from("status_source_size"), &editor_fonts);
+
+        let line_height = font.get_height_ex().font_size(font_size).done().ceil()
+            + (2.0 * EditorInterface::singleton().get_editor_scale()).round();
+        let ascent = font.get_ascent_ex().font_size(font_size).done()
+            + (EditorInterface::singleton().get_editor_scale()).round();
+        // The source font is monospaced, so every column is as wide as a digit.
+        let char_width = font
+            .get_string_size_ex("0")
+            .font_size(font_size)
+            .done()
+            .x
+            .max(1.0);
+
+        let font_color = Self::theme_color(&theme, "font_color", "Label");
+        Some(DiffStyle {
+            header_font,
+            header_font_size,
+            font,
+            font_size,
+            line_height,
+            ascent,
+            char_width,
+            accent_color: Self::theme_color(&theme, "accent_color", "Editor"),
+            added_color: Self::theme_color(&theme, "success_color", "Editor"),
+            removed_color: Self::theme_color(&theme, "error_color", "Editor"),
+            default_color: font_color * Color::from_rgba(1.0, 1.0, 1.0, 0.6),
         })
     }
-}
 
-#[godot_api]
-impl TextDifferView {
-    #[func]
-    pub fn get_text_diff_view(diff: VarDictionary, split_view: bool) -> Option<Gd<RichTextLabel>> {
-        let editor_interface = EditorInterface::singleton();
-        let editor_theme = editor_interface.get_editor_theme();
-		if editor_theme.is_none() {
-			godot_error!("Editor theme is none");
-			return None;
-		}
-		let editor_theme = editor_theme.unwrap();
-
-        // Parse dictionary into structured format
-        let diff_file = DiffFile::from_dict(&diff)?;
-
-        let mut rich_text_label = RichTextLabel::new_alloc();
-
-        // Add file header
-        let doc_bold_font = editor_theme.get_font(&StringName::from("doc_bold"), &StringName::from("EditorFonts"))?;
-        let accent_color = editor_theme.get_color(&StringName::from("accent_color"), &StringName::from("Editor"));
-
-        rich_text_label.push_font(&doc_bold_font);
-        rich_text_label.push_color(accent_color);
-		if diff_file.old_file != diff_file.new_file {
-			rich_text_label.add_text(&format!("File: {} -> {}", diff_file.old_file, diff_file.new_file));
-		} else {
-			rich_text_label.add_text(&format!("File: {}", diff_file.new_file));
-		}
-        rich_text_label.pop();
-        rich_text_label.pop();
-
-        let status_source_font = editor_theme.get_font(&StringName::from("status_source"), &StringName::from("EditorFonts"))?;
-        rich_text_label.push_font(&status_source_font);
-
-        for hunk in &diff_file.diff_hunks {
-            rich_text_label.newline();
-            let hunk_header = format!("[center]@@ {},{} {},{} @@[/center]", hunk.old_start, hunk.old_lines, hunk.new_start, hunk.new_lines);
-            rich_text_label.append_text(&hunk_header);
-            rich_text_label.newline();
-
-            if split_view {
-                Self::display_diff_split_view(&mut rich_text_label, &hunk.diff_lines, &editor_theme);
-            } else {
-                Self::display_diff_unified_view(&mut rich_text_label, &hunk.diff_lines, &editor_theme);
-            }
+    fn theme_color(theme: &Gd<Theme>, name: &str, theme_type: &str) -> Color {
+        theme.get_color(&StringName::from(name), &StringName::from(theme_type))
+    }
 
-            rich_text_label.newline();
+    /// The width of the line number and status columns in front of the code, on each side.
+    fn gutter_width(&self, style: &DiffStyle) -> f32 {
+        let margin = style.char_width * 0.5;
+        let digits = self.line_number_digits as f32;
+        if self.split_view {
+            // "12" "-|"
+            margin + (digits + 3.0) * style.char_width
+        } else {
+            // "12|" "13" "+|"
+            margin + (2.0 * digits + 5.0) * style.char_width
         }
+    }
 
-        rich_text_label.pop();
-        rich_text_label.newline();
-
-        Some(rich_text_label)
+    /// The width of the rows, not counting the scroll bar.
+    fn content_width(&self) -> f32 {
+        let mut width = self.base().get_size().x;
+        if self.v_scroll.is_visible() {
+            width -= self.v_scroll.get_combined_minimum_size().x;
+        }
+        width.max(0.0)
     }
 
-    fn display_diff_split_view(
-        rich_text_label: &mut Gd<RichTextLabel>,
-        diff_lines: &[DiffLine],
-        theme: &Gd<Theme>,
-    ) {
-        // Parse diff lines into a format suitable for split view
-        let mut parsed_diff: Vec<ParsedDiffLine> = Vec::new();
-
-        for diff_line in diff_lines {
-            let line = diff_line.content.trim_end().to_string();
-
-            if diff_line.new_line_no >= 0 && diff_line.old_line_no >= 0 {
-                // Unchanged line
-                parsed_diff.push(ParsedDiffLine {
-                    old_line_no: diff_line.old_line_no,
-                    new_line_no: diff_line.new_line_no,
-                    old_text: line.clone(),
-                    new_text: line,
-                    status: diff_line.status.clone(),
-                });
-            } else if diff_line.new_line_no == -1 {
-                // Deleted line
-                parsed_diff.push(ParsedDiffLine {
-                    old_line_no: diff_line.old_line_no,
-                    new_line_no: -1,
-                    old_text: line,
-                    new_text: String::new(),
-                    status: diff_line.status.clone(),
-                });
-            } else if diff_line.old_line_no == -1 {
-                // Added line - try to pair with previous deleted lines
-                let mut j = parsed_diff.len() as i32 - 1;
-                while j >= 0 && parsed_diff[j as usize].new_line_no == -1 {
-                    j -= 1;
-                }
+    /// The width of one side's code column.
+    fn code_width(&self, style: &DiffStyle) -> f32 {
+        let mut side_width = self.content_width();
+        if self.split_view {
+            side_width /= 2.0;
+        }
+        (side_width - self.gutter_width(style)).max(0.0)
+    }
 
-                if j == parsed_diff.len() as i32 - 1 {
-                    // No lines are modified
-                    parsed_diff.push(ParsedDiffLine {
-                        old_line_no: -1,
-                        new_line_no: diff_line.new_line_no,
-                        old_text: String::new(),
-                        new_text: line,
-                        status: diff_line.status.clone(),
-                    });
-                } else {
-                    // Lines are modified - pair with the deleted line
-                    let modified_line = &mut parsed_diff[(j + 1) as usize];
-                    modified_line.new_text = line;
-                    modified_line.new_line_no = diff_line.new_line_no;
-                }
-            }
+    fn update_scroll_bars(&mut self) {
+        let Some(style) = &self.style else {
+            return;
+        };
+        let size = self.base().get_size();
+        let v_width = self.v_scroll.get_combined_minimum_size().x;
+        let h_height = self.h_scroll.get_combined_minimum_size().y;
+        let content_height = self.rows.len() as f32 * style.line_height;
+        let content_columns_width = self.max_columns as f32 * style.char_width;
+
+        let v_visible = content_height > size.y;
+        let mut code_width = if v_visible { size.x - v_width } else { size.x };
+        if self.split_view {
+            code_width /= 2.0;
         }
+        code_width = (code_width - self.gutter_width(style)).max(0.0);
+        let h_visible = content_columns_width > code_width;
+        let rows_height = if h_visible { size.y - h_height } else { size.y };
+        let visible_rows = (rows_height / style.line_height).floor().max(1.0) as f64;
+
+        self.v_scroll.set_visible(v_visible);
+        self.v_scroll.set_step(1.0);
+        self.v_scroll.set_max(self.rows.len() as f64);
+        self.v_scroll.set_page(visible_rows);
+        self.v_scroll
+            .set_position(Vector2::new(size.x - v_width, 0.0));
+        self.v_scroll.set_size(Vector2::new(v_width, rows_height));
+
+        self.h_scroll.set_visible(h_visible);
+        self.h_scroll.set_max(content_columns_width as f64);
+        self.h_scroll.set_page(code_width as f64);
+        self.h_scroll
+            .set_position(Vector2::new(0.0, size.y - h_height));
+        self.h_scroll.set_size(Vector2::new(
+            if v_visible { size.x - v_width } else { size.x },
+            h_height,
+        ));
+    }
 
-        // Create 6-column table: Old Line No | prefix | Old Code | New Line No | prefix | New Code
-        rich_text_label.push_table(6);
-        rich_text_label.set_table_column_expand(2, true);
-        rich_text_label.set_table_column_expand(5, true);
-
-        let error_color = theme.get_color(&StringName::from("error_color"), &StringName::from("Editor"));
-        let success_color = theme.get_color(&StringName::from("success_color"), &StringName::from("Editor"));
-        let font_color = theme.get_color(&StringName::from("font_color"), &StringName::from("Label"));
-        let white = font_color * Color::from_rgb(1.0, 1.0, 1.0) * Color::from_rgba(1.0, 1.0, 1.0, 0.6);
-
-        for diff_line in parsed_diff {
-            let has_change = diff_line.status != " ";
-
-            // Old side
-            if diff_line.old_line_no >= 0 {
-                rich_text_label.push_cell();
-                rich_text_label.push_color(if has_change { error_color } else { white });
-                rich_text_label.add_text(&diff_line.old_line_no.to_string());
-                rich_text_label.pop();
-                rich_text_label.pop();
-
-                rich_text_label.push_cell();
-                rich_text_label.push_color(if has_change { error_color } else { white });
-                rich_text_label.add_text(if has_change { "-|" } else { " |" });
-                rich_text_label.pop();
-                rich_text_label.pop();
-
-                rich_text_label.push_cell();
-                rich_text_label.push_color(if has_change { error_color } else { white });
-                rich_text_label.add_text(&diff_line.old_text);
-                rich_text_label.pop();
-                rich_text_label.pop();
+    fn draw_rows(&self) {
+        let (Some(style), Some(diff)) = (&self.style, self.text_diff()) else {
+            return;
+        };
+        let mut canvas = self.base().clone();
+        let size = canvas.get_size();
+        let content_width = self.content_width();
+        let gutter_width = self.gutter_width(style);
+        let code_columns = (self.code_width(style) / style.char_width).ceil() as usize + 1;
+        let first_column = (self.h_scroll.get_value() as f32 / style.char_width) as usize;
+        let first_row = self.v_scroll.get_value().max(0.0) as usize;
+        let row_count = (size.y / style.line_height).ceil() as usize + 1;
+        let margin = style.char_width * 0.5;
+        let digits = self.line_number_digits as f32;
+
+        let draw_text = |canvas: &mut Gd<Control>, x: f32, y: f32, text: &str, color: Color| {
+            canvas
+                .draw_string_ex(&style.font, Vector2::new(x, y + style.ascent), text)
+                .font_size(style.font_size)
+                .modulate(color)
+                .done();
+        };
+        let draw_centered = |canvas: &mut Gd<Control>, y: f32, text: &str, color: Color| {
+            canvas
+                .draw_string_ex(&style.font, Vector2::new(0.0, y + style.ascent), text)
+                .alignment(HorizontalAlignment::CENTER)
+                .width(content_width)
+                .font_size(style.font_size)
+                .modulate(color)
+                .done();
+        };
+        let line_number = |line_no: i64| {
+            if line_no >= 0 {
+                line_no.to_string()
             } else {
-                rich_text_label.push_cell();
-                rich_text_label.pop();
-                rich_text_label.push_cell();
-                rich_text_label.pop();
-                rich_text_label.push_cell();
-                rich_text_label.pop();
+                String::new()
             }
+        };
+
+        if self.split_view {
+            let half = (content_width / 2.0).round();
+            canvas.draw_line(
+                Vector2::new(half, 0.0),
+                Vector2::new(half, size.y),
+                style.default_color * Color::from_rgba(1.0, 1.0, 1.0, 0.3),
+            );
+        }
 
-            // New side
-            if diff_line.new_line_no >= 0 {
-                rich_text_label.push_cell();
-                rich_text_label.push_color(if has_change { success_color } else { white });
-                rich_text_label.add_text(&diff_line.new_line_no.to_string());
-                rich_text_label.pop();
-                rich_text_label.pop();
-
-                rich_text_label.push_cell();
-                rich_text_label.push_color(if has_change { success_color } else { white });
-                rich_text_label.add_text(if has_change { "+|" } else { " |" });
-                rich_text_label.pop();
-                rich_text_label.pop();
-
-                rich_text_label.push_cell();
-                rich_text_label.push_color(if has_change { success_color } else { white });
-                rich_text_label.add_text(&diff_line.new_text);
-                rich_text_label.pop();
-                rich_text_label.pop();
-            } else {
-                rich_text_label.push_cell();
-                rich_text_label.pop();
-                rich_text_label.push_cell();
-                rich_text_label.pop();
-                rich_text_label.push_cell();
-                rich_text_label.pop();
+        for (index, row) in self.rows.iter().enumerate().skip(first_row).take(row_count) {
+            let y = (index - first_row) as f32 * style.line_height;
+            match *row {
+                DiffRow::FileHeader => {
+                    // In the future, if we track renames, we should show both paths here.
+                    canvas
+                        .draw_string_ex(
+                            &style.header_font,
+                            Vector2::new(margin, y + style.ascent),
+                            &format!("File: {}", diff.path),
+                        )
+                        .font_size(style.header_font_size)
+                        .modulate(style.accent_color)
+                        .done();
+                }
+                DiffRow::HunkHeader(hunk) => {
+                    let hunk = &diff.diff_hunks[hunk];
+                    let header = format!(
+                        "@@ {},{} {},{} @@",
+                        hunk.old_start, hunk.old_lines, hunk.new_start, hunk.new_lines
+                    );
+                    draw_centered(&mut canvas, y, &header, style.default_color);
+                }
+                DiffRow::Collapsed(count) => {
+                    let mut background = style.default_color;
+                    background.a *= 0.1;
+                    canvas.draw_rect(
+                        Rect2::new(
+                            Vector2::new(0.0, y),
+                            Vector2::new(content_width, style.line_height),
+                        ),
+                        background,
+                    );
+                    let label = if count == 1 {
+                        "··· 1 unchanged line ···".to_string()
+                    } else {
+                        format!("··· {} unchanged lines ···", count)
+                    };
+                    draw_centered(&mut canvas, y, &label, style.default_color);
+                }
+                DiffRow::Line { hunk, line } => {
+                    let line = &diff.diff_hunks[hunk].diff_lines[line];
+                    let color = match line.status.as_str() {
+                        "+" => style.added_color,
+                        "-" => style.removed_color,
+                        _ => style.default_color,
+                    };
+                    let mut old_line_no = line_number(line.old_line_no);
+                    if line.old_line_no >= 0 && line.new_line_no >= 0 {
+                        old_line_no.push('|');
+                    }
+                    let status = if line.status.is_empty() {
+                        " |".to_string()
+                    } else {
+                        format!("{}|", line.status)
+                    };
+                    draw_text(&mut canvas, margin, y, &old_line_no, color);
+                    let new_x = margin + (digits + 2.0) * style.char_width;
+                    draw_text(&mut canvas, new_x, y, &line_number(line.new_line_no), color);
+                    let status_x = margin + (2.0 * digits + 3.0) * style.char_width;
+                    draw_text(&mut canvas, status_x, y, &status, color);
+                    let code = visible_text(&line.content, first_column, code_columns);
+                    draw_text(&mut canvas, gutter_width, y, &code, color);
+                }
+                DiffRow::Pair { hunk, old, new } => {
+                    let lines = &diff.diff_hunks[hunk].diff_lines;
+                    let half = (content_width / 2.0).round();
+                    let sides = [
+                        (0.0, old, style.removed_color, "-|", true),
+                        (half, new, style.added_color, "+|", false),
+                    ];
+                    for (x, line, change_color, change_prefix, is_old) in sides {
+                        let Some(line) = line.map(|line| &lines[line]) else {
+                            continue;
+                        };
+                        let has_change = line.status != " ";
+                        let color = if has_change {
+                            change_color
+                        } else {
+                            style.default_color
+                        };
+                        let line_no = if is_old {
+                            line.old_line_no
+                        } else {
+                            line.new_line_no
+                        };
+                        draw_text(&mut canvas, x + margin, y, &line_number(line_no), color);
+                        let prefix_x = x + margin + (digits + 1.0) * style.char_width;
+                        let prefix = if has_change { change_prefix } else { " |" };
+                        draw_text(&mut canvas, prefix_x, y, prefix, color);
+                        let code = visible_text(&line.content, first_column, code_columns);
+                        draw_text(&mut canvas, x + gutter_width, y, &code, color);
+                    }
+                }
             }
         }
+    }
 
-        rich_text_label.pop();
+    /// Scrolls [range] by [delta], returning false if it was already at the end.
+    fn scroll_by(mut range: Gd<Range>, delta: f64) -> bool {
+        let before = range.get_value();
+        range.set_value(before + delta);
+        range.get_value() != before
     }
+}
 
-    fn display_diff_unified_view(
-        rich_text_label: &mut Gd<RichTextLabel>,
-        diff_lines: &[DiffLine],
-        theme: &Gd<Theme>,
-    ) {
-        // Create 4-column table: Old Line No | New Line No | status | code
-        rich_text_label.push_table(4);
-        rich_text_label.set_table_column_expand(3, true);
-
-        let error_color = theme.get_color(&StringName::from("error_color"), &StringName::from("Editor"));
-        let success_color = theme.get_color(&StringName::from("success_color"), &StringName::from("Editor"));
-        let font_color = theme.get_color(&StringName::from("font_color"), &StringName::from("Label"));
-        let default_color = font_color * Color::from_rgba(1.0, 1.0, 1.0, 0.6);
-
-        for diff_line in diff_lines {
-            let line = diff_line.content.trim_end().to_string();
-
-            let color = if diff_line.status == "+" {
-                success_color
-            } else if diff_line.status == "-" {
-                error_color
-            } else {
-                default_color
-            };
+#[godot_api]
+impl TextDiffView {
+    #[func]
+    fn _on_scroll(&mut self, _value: f64) {
+        self.base_mut().queue_redraw();
+    }
+}
 
-            let mut diff_old_line_no = if diff_line.old_line_no >= 0 {
-                diff_line.old_line_no.to_string()
-            } else {
-                String::new()
-            };
-            let diff_new_line_no = if diff_line.new_line_no >= 0 {
-                diff_line.new_line_no.to_string()
-            } else {
-                String::new()
-            };
+#[godot_api]
+impl IControl for TextDiffView {
+    fn ready(&mut self) {
+        self.base_mut().set_clip_contents(true);
+        let on_scroll = Callable::from_object_method(&self.to_gd(), "_on_scroll");
+        let mut v_scroll = self.v_scroll.clone();
+        let mut h_scroll = self.h_scroll.clone();
+        v_scroll.connect("value_changed", &on_scroll);
+        h_scroll.connect("value_changed", &on_scroll);
+        self.base_mut().add_child(&v_scroll);
+        self.base_mut().add_child(&h_scroll);
+        self.update_scroll_bars();
+    }
 
-            if diff_line.old_line_no >= 0 && diff_line.new_line_no >= 0 {
-                diff_old_line_no.push_str("|");
+    fn get_minimum_size(&self) -> Vector2 {
+        let Some(style) = &self.style else {
+            return Vector2::ZERO;
+        };
+        let height = self.rows.len() as f32 * style.line_height
+            + self.h_scroll.get_combined_minimum_size().y;
+        let max_height = MAX_HEIGHT * EditorInterface::singleton().get_editor_scale();
+        Vector2::new(0.0, height.min(max_height))
+    }
+
+    fn gui_input(&mut self, event: Gd<InputEvent>) {
+        let Ok(mb) = event.try_cast::<InputEventMouseButton>() else {
+            return;
+        };
+        if !mb.is_pressed() {
+            return;
+        }
+        let factor = if mb.get_factor() > 0.0 {
+            mb.get_factor() as f64
+        } else {
+            1.0
+        };
+        let row_step = WHEEL_ROWS * factor;
+        let column_step = self
+            .style
+            .as_ref()
+            .map(|style| style.char_width as f64)
+            .unwrap_or(1.0)
+            * WHEEL_ROWS
+            * 4.0
+            * factor;
+        let horizontal = mb.is_shift_pressed();
+        // Only keep the event if we actually scrolled, so the inspector scrolls once we reach either end.
+        let scrolled = match mb.get_button_index() {
+            MouseButton::WHEEL_UP if horizontal => {
+                Self::scroll_by(self.h_scroll.clone().upcast(), -column_step)
+            }
+            MouseButton::WHEEL_DOWN if horizontal => {
+                Self::scroll_by(self.h_scroll.clone().upcast(), column_step)
+            }
+            MouseButton::WHEEL_UP => Self::scroll_by(self.v_scroll.clone().upcast(), -row_step),
+            MouseButton::WHEEL_DOWN => Self::scroll_by(self.v_scroll.clone().upcast(), row_step),
+            MouseButton::WHEEL_LEFT => {
+                Self::scroll_by(self.h_scroll.clone().upcast(), -column_step)
+            }
+            MouseButton::WHEEL_RIGHT => {
+                Self::scroll_by(self.h_scroll.clone().upcast(), column_step)
             }
+            _ => false,
+        };
+        if scrolled {
+            self.base_mut().accept_event();
+        }
+    }
 
-            // Old line number
-            rich_text_label.push_cell();
-            rich_text_label.push_color(color);
-            rich_text_label.push_indent(1);
-            rich_text_label.add_text(&diff_old_line_no);
-            rich_text_label.pop();
-            rich_text_label.pop();
-            rich_text_label.pop();
-
-            // New line number
-            rich_text_label.push_cell();
-            rich_text_label.push_color(color);
-            rich_text_label.push_indent(1);
-            rich_text_label.add_text(&diff_new_line_no);
-            rich_text_label.pop();
-            rich_text_label.pop();
-            rich_text_label.pop();
-
-            // Status
-            rich_text_label.push_cell();
-            rich_text_label.push_color(color);
-            let status_text = if !diff_line.status.is_empty() {
-                format!("{}|", diff_line.status)
-            } else {
-                " |".to_string()
-            };
-            rich_text_label.add_text(&status_text);
-            rich_text_label.pop();
-            rich_text_label.pop();
-
-            // Code
-            rich_text_label.push_cell();
-            rich_text_label.push_color(color);
-            rich_text_label.add_text(&line);
-            rich_text_label.pop();
-            rich_text_label.pop();
+    fn on_notification(&mut self, what: ControlNotification) {
+        match what {
+            ControlNotification::THEME_CHANGED => {
+                self.style = Self::load_style();
+                self.update_scroll_bars();
+                self.base_mut().update_minimum_size();
+                self.base_mut().queue_redraw();
+            }
+            ControlNotification::RESIZED => {
+                self.update_scroll_bars();
+                self.base_mut().queue_redraw();
+            }
+            _ => {}
         }
+    }
 
-        rich_text_label.pop();
+    fn draw(&mut self) {
+        self.draw_rows();
     }
 }
 
-#[godot_api]
-impl IObject for TextDifferView {
-    fn init(base: Base<Object>) -> Self {
-        Self { base }
+/// Lays out the rows of a diff. Unchanged lines between hunks aren't part of the diff, so each gap
+/// becomes a single collapsed row.
+fn build_rows(diff: &TextDiff, split_view: bool) -> Vec<DiffRow> {
+    let mut rows = vec![DiffRow::FileHeader];
+    let mut next_old_line = 1;
+    for (hunk_index, hunk) in diff.diff_hunks.iter().enumerate() {
+        let skipped = hunk.old_start - next_old_line;
+        if skipped > 0 {
+            rows.push(DiffRow::Collapsed(skipped));
+        }
+        next_old_line = hunk.old_start + hunk.old_lines;
+        rows.push(DiffRow::HunkHeader(hunk_index));
+        if split_view {
+            push_split_rows(&mut rows, hunk_index, &hunk.diff_lines);
+        } else {
+            rows.extend((0..hunk.diff_lines.len()).map(|line| DiffRow::Line {
+                hunk: hunk_index,
+                line,
+            }));
+        }
+    }
+    rows
+}
+
+/// Pairs each run of removed lines with the added lines that follow it, so modified lines sit side by side.
+fn push_split_rows(rows: &mut Vec<DiffRow>, hunk: usize, lines: &[TextDiffLine]) {
+    // The first row of the current run of removed lines that hasn't been paired with an added line yet.
+    let mut unpaired: Option<usize> = None;
+    for (index, line) in lines.iter().enumerate() {
+        if line.old_line_no >= 0 && line.new_line_no >= 0 {
+            unpaired = None;
+            rows.push(DiffRow::Pair {
+                hunk,
+                old: Some(index),
+                new: Some(index),
+            });
+        } else if line.new_line_no < 0 {
+            unpaired.get_or_insert(rows.len());
+            rows.push(DiffRow::Pair {
+                hunk,
+                old: Some(index),
+                new: None,
+            });
+        } else if let Some(row) = unpaired.filter(|row| *row < rows.len()) {
+            if let DiffRow::Pair { new, .. } = &mut rows[row] {
+                *new = Some(index);
+            }
+            unpaired = Some(row + 1);
+        } else {
+            unpaired = None;
+            rows.push(DiffRow::Pair {
+                hunk,
+                old: None,
+                new: Some(index),
+            });
+        }
     }
 }
 
-// Helper struct for parsed diff lines in split view
-struct ParsedDiffLine {
-    old_line_no: i64,
-    new_line_no: i64,
-    old_text: String,
-    new_text: String,
-    status: String,
+fn max_line_number(diff: &TextDiff) -> i64 {
+    diff.diff_hunks
+        .iter()
+        .map(|hunk| (hunk.old_start + hunk.old_lines).max(hunk.new_start + hunk.new_lines))
+        .max()
+        .unwrap_or(1)
+}
+
+fn max_columns(diff: &TextDiff) -> usize {
+    diff.diff_hunks
+        .iter()
+        .flat_map(|hunk| hunk.diff_lines.iter())
+        .map(|line| column_count(&line.content))
+        .max()
+        .unwrap_or(0)
+}
+
+fn column_count(content: &str) -> usize {
+    content.trim_end().chars().fold(0, |column, c| {
+        if c == '\t' {
+            column + TAB_SIZE - column % TAB_SIZE
+        } else {
+            column + 1
+        }
+    })
 }
 
+/// The part of a line that's visible after scrolling [first_column] columns, at most [columns] wide,
+/// with tabs expanded. Only this part gets shaped, which keeps very long lines cheap to draw.
+fn visible_text(content: &str, first_column: usize, columns: usize) -> String {
+    let last_column = first_column + columns;
+    let mut text = String::new();
+    let mut column = 0;
+    for c in content.trim_end().chars() {
+        let (c, width) = if c == '\t' {
+            (' ', TAB_SIZE - column % TAB_SIZE)
+        } else {
+            (c, 1)
+        };
+        for _ in 0..width {
+            if column >= last_column {
+                return text;
+            }
+            if column >= first_column {
+                text.push(c);
+            }
+            column += 1;
+        }
+    }
+    text
+}
@@ -4,3 +4,16 @@ mod interop;
 mod diff;
 mod project;
 mod parser;
+
+/// Internals used by the benchmarks in `benches/`, which are built as separate crates.
+#[doc(hidden)]
+pub mod bench_api {
+    pub use crate::diff::scene_differ::changed_node_properties;
+    pub use crate::fs::file_utils::FileContent;
+    pub use crate::helpers::history_ref::HistoryRef;
+    pub use crate::parser::godot_parser::{GodotScene, parse_scene};
+    pub use crate::project::{
+        branch_db::BranchDb, change_ingester::ChangeIngester, document_watcher::DocumentWatcher,
+        peer_watcher::PeerWatcher,
+    };
+}
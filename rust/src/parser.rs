@@ -1,2 +1,3 @@
 pub mod godot_parser;
-pub mod parser_defs;
\ No newline at end of file
+pub mod parser_defs;
+pub mod structural_hash;
\ No newline at end of file
@@ -4,10 +4,11 @@ use automerge::{
 use autosurgeon::{Hydrate, HydrateError, Prop, Reconcile, ReadDoc, Reconciler};
 use rand::Rng;
 use regex::Regex;
+use serde::{Deserialize, Serialize};
 use std::{collections::{HashMap, HashSet}, fmt::Display, str::FromStr};
 use tree_sitter::{Parser, Query, QueryCursor, StreamingIterator};
 
-use crate::{helpers::{doc_utils::SimpleDocReader, history_path::HistoryRefPath, history_ref::HistoryRef}, parser::parser_defs::OrderedProperty};
+use crate::{helpers::{doc_utils::SimpleDocReader, history_path::HistoryRefPath, history_ref::HistoryRef, memory::HeapSize}, parser::{parser_defs::OrderedProperty, structural_hash::{hydrate_structural_hash, reconcile_structural_hash}}};
 
 #[cfg(test)]
 mod tests;
@@ -150,7 +151,7 @@ pub struct GodotScene {
     pub main_resource: Option<SubResourceNode>
 }
 
-#[derive(Debug, Clone, Hydrate, Reconcile, PartialEq, Eq)]
+#[derive(Debug, Clone, Hydrate, Reconcile, PartialEq, Eq, Hash, Serialize, Deserialize)]
 pub enum TypeOrInstance {
     Type(String),
     Instance(String),
@@ -184,6 +185,10 @@ pub struct GodotNode {
     // in the automerge doc the child_node_ids are stored as a map with the key being the child node id and the value being a number that should be used for sort order
     // this allows us to reconcile the children as a set and preserve the order to some extend when merging concurrent changes
     pub child_node_ids: Vec<NodeId>,
+
+    /// Hash of the node's type, parent, properties and referenced resources; see [GodotScene::compute_structural_hashes].
+    #[autosurgeon(reconcile = "reconcile_structural_hash", hydrate = "hydrate_structural_hash")]
+    pub structural_hash: u64,
 }
 
 #[derive(Debug, Clone, Hydrate, Reconcile, PartialEq, Eq)]
@@ -231,6 +236,9 @@ pub struct SubResourceNode {
     pub resource_type: String,
     pub properties: HashMap<String, OrderedProperty>, // key value pairs below the section header
     pub idx: i64,
+    /// Hash of the sub-resource's type, properties and referenced resources; see [GodotScene::compute_structural_hashes].
+    #[autosurgeon(reconcile = "reconcile_structural_hash", hydrate = "hydrate_structural_hash")]
+    pub structural_hash: u64,
 }
 // test
 // test 3
@@ -351,7 +359,9 @@ impl GodotScene {
 		.get_obj_id_at(&files, path, &heads)
 		.ok_or_else(|| format!("Could not find file at path: {}", path))?;
 
-		GodotScene::hydrate(&doc_at_heads, &scene_file, "structured_content".into()).map_err(|e| e.to_string())
+		let mut scene = GodotScene::hydrate(&doc_at_heads, &scene_file, "structured_content".into()).map_err(|e| e.to_string())?;
+		scene.compute_structural_hashes();
+		Ok(scene)
 	}
 
     pub fn serialize(&self) -> String {
@@ -774,6 +784,7 @@ pub fn parse_scene(source: &str) -> Result<GodotScene, String> {
                         resource_type: scene_metadata.as_ref().map(|s| s.resource_type.clone()).unwrap_or("".to_string()),
                         properties: properties.into_iter().collect(),
                         idx: 0,
+                        structural_hash: 0,
                     });
 
                 // GD_SCENE HEADER
@@ -867,6 +878,7 @@ pub fn parse_scene(source: &str) -> Result<GodotScene, String> {
                         properties: properties.into_iter().collect(),
                         child_node_ids: Vec::new(),
                         node_paths,
+                        structural_hash: 0,
                     };
 					node_arr.push((node, parent_path));
 
@@ -938,6 +950,7 @@ pub fn parse_scene(source: &str) -> Result<GodotScene, String> {
                         resource_type: subresource_type,
                         properties: properties.into_iter().collect(),
                         idx: sub_resource_idx,
+                        structural_hash: 0,
                     };
 
                     sub_resources.insert(id, sub_resource);
@@ -1194,7 +1207,7 @@ pub fn parse_scene(source: &str) -> Result<GodotScene, String> {
                 None => return Err(String::from("missing gd_scene header")),
             };
 
-            Ok(GodotScene {
+            let mut scene = GodotScene {
                 load_steps: scene_metadata.load_steps,
                 format: scene_metadata.format,
                 uid: scene_metadata.uid,
@@ -1207,7 +1220,9 @@ pub fn parse_scene(source: &str) -> Result<GodotScene, String> {
                 connections,
                 editable_instances,
                 main_resource
-            })
+            };
+            scene.compute_structural_hashes();
+            Ok(scene)
         }
         None => Err("Failed to parse scene file".to_string()),
     };
@@ -1220,3 +1235,83 @@ fn unquote(string: &str) -> String {
         string.to_string()
     }
 }
+
+impl HeapSize for GodotScene {
+    fn heap_size(&self) -> usize {
+        self.uid.heap_size()
+            + self.script_class.heap_size()
+            + self.resource_type.heap_size()
+            + self.root_node_id.heap_size()
+            + self.ext_resources.heap_size()
+            + self.sub_resources.heap_size()
+            + self.nodes.heap_size()
+            + self.connections.heap_size()
+            + self.editable_instances.heap_size()
+            + self.main_resource.heap_size()
+    }
+}
+
+impl HeapSize for NodeId {
+    fn heap_size(&self) -> usize {
+        self.root_instance_id.heap_size()
+    }
+}
+
+impl HeapSize for TypeOrInstance {
+    fn heap_size(&self) -> usize {
+        match self {
+            TypeOrInstance::Type(s) | TypeOrInstance::Instance(s) => s.heap_size(),
+        }
+    }
+}
+
+impl HeapSize for GodotNode {
+    fn heap_size(&self) -> usize {
+        self.id.heap_size()
+            + self.name.heap_size()
+            + self.type_or_instance.heap_size()
+            + self.instance_placeholder.heap_size()
+            + self.parent_id.heap_size()
+            + self.parent_path_fallback.heap_size()
+            + self.parent_id_path.heap_size()
+            + self.owner.heap_size()
+            + self.owner_uid_path.heap_size()
+            + self.groups.heap_size()
+            + self.node_paths.heap_size()
+            + self.properties.heap_size()
+            + self.child_node_ids.heap_size()
+    }
+}
+
+impl HeapSize for GodotConnection {
+    fn heap_size(&self) -> usize {
+        self.signal.heap_size()
+            + self.from_node_id.heap_size()
+            + self.to_node_id.heap_size()
+            + self.method.heap_size()
+            + self.from_uid_path.heap_size()
+            + self.to_uid_path.heap_size()
+            + self.binds.heap_size()
+    }
+}
+
+impl HeapSize for ExternalResourceNode {
+    fn heap_size(&self) -> usize {
+        self.resource_type.heap_size()
+            + self.uid.heap_size()
+            + self.path.heap_size()
+            + self.id.heap_size()
+    }
+}
+
+impl HeapSize for SubResourceNode {
+    fn heap_size(&self) -> usize {
+        self.id.heap_size() + self.resource_type.heap_size() + self.properties.heap_size()
+    }
+}
+
+impl HeapSize for OrderedProperty {
+    fn heap_size(&self) -> usize {
+        self.value.heap_size()
+    }
+}
@@ -0,0 +1,173 @@
+use std::{
+    collections::HashMap,
+    hash::{DefaultHasher, Hash, Hasher},
+};
+
+use automerge::ObjId;
+use autosurgeon::{HydrateError, Prop, ReadDoc, Reconciler};
+
+use crate::parser::{
+    godot_parser::{GodotNode, GodotScene, NodeId, SubResourceNode},
+    parser_defs::OrderedProperty,
+};
+
+/// Structural hashes aren't stored in the document; they're recomputed whenever a scene is hydrated.
+pub(super) fn hydrate_structural_hash<D: ReadDoc>(_doc: &D, _obj: &ObjId, _prop: Prop<'_>) -> Result<u64, HydrateError> {
+    Ok(0)
+}
+
+/// Structural hashes are derived data, so there's nothing to write back to the document.
+pub(super) fn reconcile_structural_hash<R: Reconciler>(_hash: &u64, _reconciler: R) -> Result<(), R::Error> {
+    Ok(())
+}
+
+impl GodotScene {
+    /// Computes the structural hash of every node and sub-resource in the scene.
+    /// A hash covers the type, name, parent and properties, plus the content of every sub-resource or external
+    /// resource the properties reference, so two nodes with equal hashes will always diff as unchanged.
+    pub fn compute_structural_hashes(&mut self) {
+        let mut hasher = StructuralHasher::new(self);
+        let node_hashes: HashMap<NodeId, u64> = self
+            .nodes
+            .iter()
+            .map(|(id, node)| (id.clone(), hasher.node_hash(node)))
+            .collect();
+        let sub_resource_hashes: HashMap<String, u64> = self
+            .sub_resources
+            .keys()
+            .map(|id| (id.clone(), hasher.sub_resource_hash(id)))
+            .collect();
+        let main_resource_hash = self.main_resource.as_ref().map(|resource| hasher.resource_hash(resource));
+
+        for (id, node) in self.nodes.iter_mut() {
+            node.structural_hash = node_hashes[id];
+        }
+        for (id, sub_resource) in self.sub_resources.iter_mut() {
+            sub_resource.structural_hash = sub_resource_hashes[id];
+        }
+        if let (Some(main_resource), Some(hash)) = (self.main_resource.as_mut(), main_resource_hash) {
+            main_resource.structural_hash = hash;
+        }
+    }
+}
+
+/// Computes structural hashes for a single scene, memoizing sub-resources since many nodes may share one.
+struct StructuralHasher<'a> {
+    scene: &'a GodotScene,
+    /// Finished sub-resource hashes.
+    sub_resource_hashes: HashMap<&'a str, u64>,
+    /// Sub-resources currently being hashed, with their depth, used to break reference cycles.
+    in_progress: HashMap<&'a str, usize>,
+    /// The shallowest in-progress sub-resource the current one ran into, if it ran into a cycle.
+    cycle_depth: Option<usize>,
+}
+
+impl<'a> StructuralHasher<'a> {
+    fn new(scene: &'a GodotScene) -> Self {
+        StructuralHasher {
+            scene,
+            sub_resource_hashes: HashMap::new(),
+            in_progress: HashMap::new(),
+            cycle_depth: None,
+        }
+    }
+
+    fn node_hash(&mut self, node: &'a GodotNode) -> u64 {
+        let mut hasher = DefaultHasher::new();
+        node.name.hash(&mut hasher);
+        node.parent_id.hash(&mut hasher);
+        node.type_or_instance.hash(&mut hasher);
+        if let Some(type_or_instance) = &node.type_or_instance {
+            // Instances are resolved through their ext resource, so pick up changes to its path as well.
+            self.references_hash(&type_or_instance.to_string()).hash(&mut hasher);
+        }
+        self.properties_hash(&node.properties).hash(&mut hasher);
+        hasher.finish()
+    }
+
+    fn sub_resource_hash(&mut self, id: &'a str) -> u64 {
+        if let Some(hash) = self.sub_resource_hashes.get(id) {
+            return *hash;
+        }
+        let Some(sub_resource) = self.scene.sub_resources.get(id) else {
+            return hash_of(&("missing sub resource", id));
+        };
+        // We're already hashing this sub-resource further up the stack, so this is a reference cycle.
+        if let Some(&depth) = self.in_progress.get(id) {
+            self.cycle_depth = Some(self.cycle_depth.map_or(depth, |cycle_depth| cycle_depth.min(depth)));
+            return hash_of(&("cyclic sub resource", id));
+        }
+        let depth = self.in_progress.len();
+        self.in_progress.insert(id, depth);
+        let outer_cycle_depth = self.cycle_depth.take();
+        let hash = self.resource_hash(sub_resource);
+        self.in_progress.remove(id);
+        let cycle_depth = self.cycle_depth.filter(|cycle_depth| *cycle_depth < depth);
+        self.cycle_depth = match (outer_cycle_depth, cycle_depth) {
+            (Some(outer), Some(inner)) => Some(outer.min(inner)),
+            (outer, inner) => outer.or(inner),
+        };
+        // A hash that stood in a placeholder for a sub-resource further up the stack only holds when reached from
+        // there; hashing it on its own has to look through that placeholder, so don't memoize it.
+        if cycle_depth.is_none() {
+            self.sub_resource_hashes.insert(id, hash);
+        }
+        hash
+    }
+
+    fn resource_hash(&mut self, resource: &'a SubResourceNode) -> u64 {
+        let mut hasher = DefaultHasher::new();
+        resource.resource_type.hash(&mut hasher);
+        self.properties_hash(&resource.properties).hash(&mut hasher);
+        hasher.finish()
+    }
+
+    fn ext_resource_hash(&self, id: &str) -> u64 {
+        match self.scene.ext_resources.get(id) {
+            Some(ext_resource) => hash_of(&(&ext_resource.resource_type, &ext_resource.path, &ext_resource.uid)),
+            None => hash_of(&("missing ext resource", id)),
+        }
+    }
+
+    /// Hashes a property map independently of its iteration order.
+    fn properties_hash(&mut self, properties: &'a HashMap<String, OrderedProperty>) -> u64 {
+        properties.iter().fold(0u64, |acc, (key, property)| {
+            let mut hasher = DefaultHasher::new();
+            key.hash(&mut hasher);
+            property.value.hash(&mut hasher);
+            self.references_hash(&property.value).hash(&mut hasher);
+            acc.wrapping_add(hasher.finish())
+        })
+    }
+
+    /// Hashes the content of every sub-resource and external resource referenced in a value.
+    fn references_hash(&mut self, value: &str) -> u64 {
+        let mut hash = 0u64;
+        for id in referenced_ids(value, "SubResource(\"") {
+            // Look the id up by its key in the scene so the memo can borrow it for the scene's lifetime.
+            let Some((id, _)) = self.scene.sub_resources.get_key_value(id) else {
+                hash = hash.wrapping_mul(31).wrapping_add(hash_of(&("missing sub resource", id)));
+                continue;
+            };
+            hash = hash.wrapping_mul(31).wrapping_add(self.sub_resource_hash(id));
+        }
+        for id in referenced_ids(value, "ExtResource(\"") {
+            hash = hash.wrapping_mul(31).wrapping_add(self.ext_resource_hash(id));
+        }
+        hash
+    }
+}
+
+fn hash_of(value: &impl Hash) -> u64 {
+    let mut hasher = DefaultHasher::new();
+    value.hash(&mut hasher);
+    hasher.finish()
+}
+
+/// Yields the id of every `<prefix>id")` reference in a value.
+fn referenced_ids<'v>(value: &'v str, prefix: &'static str) -> impl Iterator<Item = &'v str> {
+    value.match_indices(prefix).filter_map(move |(start, _)| {
+        let rest = &value[start + prefix.len()..];
+        rest.find('"').map(|end| &rest[..end])
+    })
+}
@@ -2,15 +2,17 @@ pub mod project_api;
 //mod project_driver;
 //pub mod project;
 pub mod project_api_impl;
-mod connection;
-mod document_watcher;
+pub mod connection;
+pub(crate) mod document_watcher;
 mod fs_watcher;
 mod sync_fs_to_automerge;
 mod sync_automerge_to_fs;
 // pub for use in differ; consider restructuring
 pub mod branch_db;
-mod peer_watcher;
+pub mod history_reader;
+pub(crate) mod peer_watcher;
 pub mod project;
 mod driver;
 mod main_thread_block;
-mod change_ingester;
\ No newline at end of file
+pub(crate) mod change_ingester;
+pub mod ui_state;
\ No newline at end of file
@@ -5,19 +5,27 @@ use std::{
 };
 
 use samod::{DocHandle, DocumentId, Repo};
-use tokio::sync::{Mutex, RwLock, broadcast};
+use tokio::sync::broadcast;
 
 use crate::{
-    helpers::{branch::{BranchesMetadataDoc}, history_ref::HistoryRef},
+    helpers::{branch::{BranchesMetadataDoc}, history_ref::HistoryRef, lock_watch::{TrackedMutex, TrackedRwLock}},
     project::branch_db::{branch_sync::BranchSyncState},
 };
 
 mod branch;
 mod branch_sync;
+mod bundle;
 mod commit;
 mod file;
+mod import_settings;
+mod loader_cache;
 mod merge_revert;
+mod resource_metadata;
 mod util;
+pub use bundle::BUNDLES_FORMAT_VERSION;
+pub use import_settings::ImportSettings;
+pub use loader_cache::LoaderCache;
+pub use resource_metadata::ResourceMetadata;
 use ignore::gitignore::Gitignore;
 
 /// [BranchDb] is the primary data source for project data.
@@ -29,15 +37,19 @@ pub struct BranchDb {
     gitignore: Arc<Gitignore>,
     repo: Repo,
 
-    username: Arc<Mutex<Option<String>>>,
+    // All locks are tracked, so the lock watchdog can report who's holding them up
+    username: Arc<TrackedMutex<Option<String>>>,
 
-    binary_states: Arc<Mutex<HashMap<DocumentId, Option<DocHandle>>>>,
-    branch_sync_states: Arc<Mutex<HashMap<DocumentId, Arc<Mutex<BranchSyncState>>>>>,
-    metadata_state: Arc<Mutex<Option<(DocHandle, BranchesMetadataDoc)>>>,
+    binary_states: Arc<TrackedMutex<HashMap<DocumentId, Option<DocHandle>>>>,
+    branch_sync_states: Arc<TrackedMutex<HashMap<DocumentId, Arc<TrackedMutex<BranchSyncState>>>>>,
+    metadata_state: Arc<TrackedMutex<Option<(DocHandle, BranchesMetadataDoc)>>>,
 
     // The checked out ref is the ref that the filesystem is currently synced with.
     // Has a separate lock because of its importance; it needs to be locked while we're prepping a commit or checking out stuff
-    checked_out_ref: Arc<RwLock<Option<HistoryRef>>>,
+    checked_out_ref: Arc<TrackedRwLock<Option<HistoryRef>>>,
+
+    // Resource metadata and parsed .import files the resource loader looked up at fixed refs
+    loader_cache: LoaderCache,
 
     // Notified whenever we make or ingest changes to a branch
     branch_change_tx: broadcast::Sender<()>
@@ -50,11 +62,12 @@ impl BranchDb {
             project_dir,
             repo,
             gitignore: Arc::new(gitignore),
-            username: Default::default(),
-            binary_states: Default::default(),
-            metadata_state: Default::default(),
-            checked_out_ref: Default::default(),
-            branch_sync_states: Default::default(),
+            username: Arc::new(TrackedMutex::new("username", None)),
+            binary_states: Arc::new(TrackedMutex::new("binary_states", HashMap::new())),
+            metadata_state: Arc::new(TrackedMutex::new("metadata_state", None)),
+            checked_out_ref: Arc::new(TrackedRwLock::new("checked_out_ref", None)),
+            loader_cache: Default::default(),
+            branch_sync_states: Arc::new(TrackedMutex::new("branch_sync_states", HashMap::new())),
             branch_change_tx: tx
         }
     }
@@ -86,6 +86,7 @@ impl BranchDb {
                     BranchesMetadataDoc {
                         main_doc_id,
                         branches,
+                        format_version: None,
                     },
                 );
                 commit_with_metadata(
@@ -139,6 +140,54 @@ impl BranchDb {
         });
     }
 
+    /// Raises the project's format version to [version], so every client starts writing the newer format.
+    /// Never lowers it: clients on the newer format may have written data the older one can't read.
+    pub async fn raise_format_version(&self, version: u64) {
+        let meta_handle = {
+            let meta = self.metadata_state.lock().await;
+            let Some((handle, metadata)) = meta.as_ref() else {
+                tracing::error!("Could not find metadata document!");
+                return;
+            };
+            if metadata.format_version.unwrap_or(0) >= version {
+                return;
+            }
+            handle.clone()
+        };
+
+        tracing::info!("Raising project format version to {}", version);
+        let username = self.username.lock().await.clone();
+        tokio::task::spawn_blocking(move || {
+            meta_handle.with_document(|d| {
+                let mut tx = d.transaction();
+                let mut branches_metadata: BranchesMetadataDoc = hydrate(&mut tx).unwrap();
+                if branches_metadata.format_version.unwrap_or(0) >= version {
+                    return;
+                }
+                branches_metadata.format_version = Some(version);
+                let _ = reconcile(&mut tx, branches_metadata);
+                commit_with_metadata(
+                    tx,
+                    &CommitMetadata {
+                        username: username,
+                        branch_id: None,
+                        merge_metadata: None,
+                        reverted_to: None,
+                        changed_files: None,
+                        is_setup: Some(true),
+                    },
+                );
+            });
+        })
+        .await
+        .unwrap();
+
+        // Don't wait for the document watcher to see our own change before writing the new format.
+        if let Some((_, metadata)) = self.metadata_state.lock().await.as_mut() {
+            metadata.format_version = metadata.format_version.max(Some(version));
+        }
+    }
+
     async fn remove_branch_from_meta(&self, branch: DocumentId) {
         let meta_handle = {
             let meta = self.metadata_state.lock().await;
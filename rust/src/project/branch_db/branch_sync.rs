@@ -3,11 +3,15 @@ use std::{collections::HashSet, sync::Arc};
 use automerge::{Automerge, ChangeHash};
 use futures::{Stream, StreamExt};
 use samod::{DocHandle, DocumentId};
-use tokio::sync::{Mutex, RwLock};
 use tokio_stream::wrappers::BroadcastStream;
 
 use crate::{
-    helpers::{branch::BranchesMetadataDoc, history_ref::HistoryRef},
+    helpers::{
+        branch::BranchesMetadataDoc,
+        history_ref::HistoryRef,
+        lock_watch::{TrackedMutex, TrackedRwLock},
+        metrics::METRICS,
+    },
     project::branch_db::BranchDb,
 };
 
@@ -38,7 +42,7 @@ impl BranchSyncState {
 impl BranchDb {
     /// Get the mutable checked out ref for locking.
     /// TODO (Lilith): This smells kind of nasty, maybe don't expose this... but how else to ensure we don't step on toes?
-    pub fn get_checked_out_ref_mut(&self) -> Arc<RwLock<Option<HistoryRef>>> {
+    pub fn get_checked_out_ref_mut(&self) -> Arc<TrackedRwLock<Option<HistoryRef>>> {
         return self.checked_out_ref.clone();
     }
 
@@ -104,6 +108,7 @@ impl BranchDb {
 
             // if we were waiting on this doc, we may be able to reconcile
             if state.waiting_binary_docs.remove(&id) {
+                METRICS.binary_docs_waiting.add(-1);
                 tracing::debug!(
                     "Ingested binary doc {id} for branch {branch_id}; attempting reconcile"
                 );
@@ -128,15 +133,19 @@ impl BranchDb {
         let mut states = self.branch_sync_states.lock().await;
         let state_arc = states
             .entry(handle.document_id().clone())
-            .or_insert(Arc::new(Mutex::new(BranchSyncState::new(handle))));
+            .or_insert(Arc::new(TrackedMutex::new("branch_sync_state", BranchSyncState::new(handle))));
         let mut state = state_arc.lock().await;
 
         // update the linked docs of the sync state
+        let previously_waiting = state.waiting_binary_docs.len() as i64;
         state.waiting_binary_docs = linked_docs;
         state.last_tracked = heads;
         for (id, _) in binary_states.iter() {
             state.waiting_binary_docs.remove(id);
         }
+        METRICS
+            .binary_docs_waiting
+            .add(state.waiting_binary_docs.len() as i64 - previously_waiting);
 
         // if we're already synced, we can definitely reconcile
         if state.waiting_binary_docs.is_empty() {
@@ -161,7 +170,7 @@ impl BranchDb {
         return asorted == bsorted;
     }
 
-    pub(super) async fn try_reconcile_branch(&self, sync_state: Arc<Mutex<BranchSyncState>>) {
+    pub(super) async fn try_reconcile_branch(&self, sync_state: Arc<TrackedMutex<BranchSyncState>>) {
         let doc_change_tx = self.branch_change_tx.clone();
         tokio::task::spawn_blocking(move || {
             // this is quite weird, but we want to be holding the state mutex this entire method.
@@ -185,6 +194,8 @@ impl BranchDb {
             }
 
             tracing::debug!("Reconcile starting...");
+            METRICS.reconciles.increment();
+            let _timer = METRICS.reconcile_duration.start_timer();
 
             // let tracked_heads = state.last_tracked.clone();
             let handle = state.canonical_doc.clone();
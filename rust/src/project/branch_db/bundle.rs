@@ -0,0 +1,164 @@
+use std::mem;
+
+use automerge::{
+    Automerge, ObjType, ROOT,
+    transaction::{Transactable, Transaction},
+};
+use indexmap::IndexMap;
+use samod::{DocHandle, DocumentId};
+
+use crate::{
+    helpers::{
+        metrics::METRICS,
+        utils::{CommitMetadata, commit_with_metadata},
+    },
+    project::branch_db::BranchDb,
+};
+
+/// The project format version from which small binary files are bundled. Clients that predate bundles read a file's
+/// content from the root of its linked doc and would treat bundled files as missing, so projects stay on the older
+/// format until someone opts in with the `binary_bundles` config.
+pub const BUNDLES_FORMAT_VERSION: u64 = 1;
+/// Binary files up to this size are packed into bundle docs, instead of each getting a doc of its own.
+const BUNDLE_FILE_MAX_BYTES: usize = 256 * 1024;
+/// Bundles are closed once they hold this much, so no single doc gets too big to sync in one go.
+const BUNDLE_MAX_BYTES: usize = 4 * 1024 * 1024;
+
+/// Where a binary file's content lives: a doc of its own, or a blob in a bundle doc, keyed by content hash.
+#[derive(Debug, Clone)]
+pub(super) struct BinaryLink {
+    pub doc_id: DocumentId,
+    pub blob: Option<String>,
+}
+
+/// Small binary files waiting to be written to a bundle doc.
+#[derive(Debug, Default)]
+struct Bundle {
+    blobs: IndexMap<String, Vec<u8>>,
+    bytes: usize,
+    /// Each file, with the hash of its blob. Files with the same content share a blob.
+    files: Vec<(String, String)>,
+}
+
+impl Bundle {
+    fn add(&mut self, path: String, content: Vec<u8>) {
+        let hash = format!("{:x}", md5::compute(&content));
+        if !self.blobs.contains_key(&hash) {
+            self.bytes += content.len();
+            self.blobs.insert(hash.clone(), content);
+        }
+        self.files.push((path, hash));
+    }
+}
+
+/// Methods related to storing binary files in linked docs.
+impl BranchDb {
+    /// Stores binary files from one commit in linked docs. Once the project is on [BUNDLES_FORMAT_VERSION], small files
+    /// are packed together into bundle docs, so importing thousands of small assets syncs a handful of docs instead of
+    /// one per file.
+    pub(super) async fn create_binary_docs(
+        &self,
+        files: Vec<(String, Vec<u8>)>,
+    ) -> Vec<(String, BinaryLink)> {
+        let small_files = if self.get_format_version().await >= BUNDLES_FORMAT_VERSION {
+            files
+                .iter()
+                .filter(|(_, content)| content.len() <= BUNDLE_FILE_MAX_BYTES)
+                .count()
+        } else {
+            0
+        };
+        let mut links = Vec::new();
+        let mut bundle = Bundle::default();
+        for (path, content) in files {
+            // A bundle of one is no better than a doc of its own.
+            if small_files < 2 || content.len() > BUNDLE_FILE_MAX_BYTES {
+                let handle = self.create_new_binary_doc(content).await;
+                let doc_id = handle.document_id().clone();
+                links.push((path, BinaryLink { doc_id, blob: None }));
+                continue;
+            }
+            if !bundle.files.is_empty() && bundle.bytes + content.len() > BUNDLE_MAX_BYTES {
+                links.extend(self.create_bundle_doc(mem::take(&mut bundle)).await);
+            }
+            bundle.add(path, content);
+        }
+        if !bundle.files.is_empty() {
+            links.extend(self.create_bundle_doc(bundle).await);
+        }
+        links
+    }
+
+    pub async fn create_new_binary_doc(&self, content: Vec<u8>) -> DocHandle {
+        tracing::info!("Creating new binary doc...");
+        self.create_linked_doc(content.len(), move |tx| {
+            let _ = tx.put(ROOT, "content", content);
+        })
+        .await
+    }
+
+    async fn create_bundle_doc(&self, bundle: Bundle) -> Vec<(String, BinaryLink)> {
+        tracing::info!(
+            "Creating bundle doc for {} binary files...",
+            bundle.files.len()
+        );
+        METRICS.binary_files_bundled.add(bundle.files.len() as u64);
+        let blobs = bundle.blobs;
+        let handle = self
+            .create_linked_doc(bundle.bytes, move |tx| {
+                let blobs_obj = tx.put_object(ROOT, "blobs", ObjType::Map).unwrap();
+                for (hash, content) in blobs {
+                    let _ = tx.put(&blobs_obj, hash, content);
+                }
+            })
+            .await;
+
+        let doc_id = handle.document_id().clone();
+        bundle
+            .files
+            .into_iter()
+            .map(|(path, hash)| {
+                let link = BinaryLink {
+                    doc_id: doc_id.clone(),
+                    blob: Some(hash),
+                };
+                (path, link)
+            })
+            .collect()
+    }
+
+    /// Creates a doc holding [bytes] of binary content, which [write] puts in place.
+    async fn create_linked_doc(
+        &self,
+        bytes: usize,
+        write: impl FnOnce(&mut Transaction<'_>) + Send + 'static,
+    ) -> DocHandle {
+        METRICS.binary_docs_created.increment();
+        METRICS.binary_bytes_created.add(bytes as u64);
+        let handle = self.repo.create(Automerge::new()).await.unwrap();
+
+        let username = self.username.lock().await.clone();
+
+        // we're allowed to transact in the background: nobody needs this to exist yet.
+        let h = handle.clone();
+        tokio::task::spawn_blocking(move || {
+            h.with_document(|d| {
+                let mut tx = d.transaction();
+                write(&mut tx);
+                commit_with_metadata(
+                    tx,
+                    &CommitMetadata {
+                        username: username,
+                        branch_id: None,
+                        merge_metadata: None,
+                        reverted_to: None,
+                        changed_files: None,
+                        is_setup: Some(false),
+                    },
+                );
+            });
+        });
+
+        handle
+    }
+}
@@ -1,13 +1,13 @@
 use std::collections::{HashMap, HashSet};
 
-use automerge::{Automerge, ObjType, ROOT, ReadDoc};
+use automerge::{ObjType, ROOT, ReadDoc};
 use autosurgeon::Doc;
-use samod::DocHandle;
 
 use crate::{
     fs::file_utils::FileContent,
     helpers::{
         doc_utils::SimpleDocReader,
+        metrics::METRICS,
         utils::{ChangeType, ChangedFile, CommitMetadata, commit_with_metadata},
     },
     parser::godot_parser::GodotScene,
@@ -26,6 +26,7 @@ impl BranchDb {
         is_checking_in: bool,
     ) -> Option<HistoryRef> {
         tracing::info!("Attempting to commit changes...");
+        let _timer = METRICS.commit_duration.start_timer();
         // Only commit files that have actually changed
         // TODO: We may be able to use notify's compare file hash system instead? Or in addition to this?
         let files = self.filter_changed_files(ref_, files).await;
@@ -37,7 +38,7 @@ impl BranchDb {
             return None;
         }
 
-        let mut binary_entries: Vec<(String, DocHandle)> = Vec::new();
+        let mut binary_entries: Vec<(String, Vec<u8>)> = Vec::new();
         let mut text_entries: Vec<(String, String)> = Vec::new();
         let mut scene_entries: Vec<(String, GodotScene)> = Vec::new();
         let mut deleted_entries: Vec<String> = Vec::new();
@@ -45,8 +46,7 @@ impl BranchDb {
         for (path, content) in files {
             match content {
                 FileContent::Binary(content) => {
-                    let handle = self.create_new_binary_doc(content).await;
-                    binary_entries.push((path, handle));
+                    binary_entries.push((path, content));
                 }
                 FileContent::String(content) => {
                     text_entries.push((path, content));
@@ -60,6 +60,8 @@ impl BranchDb {
             }
         }
 
+        let binary_entries = self.create_binary_docs(binary_entries).await;
+
         let sync_states = self.branch_sync_states.lock().await;
         let Some(state_arc) = sync_states.get(ref_.branch()) else {
             tracing::error!("Sync state doesn't exist for branch; can't commit changes.");
@@ -98,6 +100,9 @@ impl BranchDb {
             if let Ok(Some((_, _))) = tx.get(&file_entry, "url") {
                 let _ = tx.delete(&file_entry, "url");
             }
+            if let Ok(Some((_, _))) = tx.get(&file_entry, "blob") {
+                let _ = tx.delete(&file_entry, "blob");
+            }
 
             // delete structured content in file entry if it previously had one
             if let Ok(Some((_, _))) = tx.get(&file_entry, "structured_content") {
@@ -134,19 +139,19 @@ impl BranchDb {
         }
 
         // write binary entries to doc
-        for (path, binary_doc_handle) in binary_entries {
+        for (path, link) in binary_entries {
             // get the change flag
             let change_type = match tx.get(&files, &path) {
                 Ok(Some(_)) => ChangeType::Modified,
                 _ => ChangeType::Added,
             };
 
-            let file_entry = tx.put_object(&files, &path, ObjType::Map);
-            let _ = tx.put(
-                file_entry.unwrap(),
-                "url",
-                format!("automerge:{}", &binary_doc_handle.document_id()),
-            );
+            let file_entry = tx.put_object(&files, &path, ObjType::Map).unwrap();
+            let _ = tx.put(&file_entry, "url", format!("automerge:{}", &link.doc_id));
+            // files packed into a bundle doc are addressed by the content hash of their blob
+            if let Some(blob) = link.blob {
+                let _ = tx.put(&file_entry, "blob", blob);
+            }
 
             changes.push(ChangedFile { path, change_type });
         }
@@ -189,6 +194,8 @@ impl BranchDb {
         self.try_reconcile_branch(state_arc.clone()).await;
 
         tracing::info!("Committed {} files.", count);
+        METRICS.commits.increment();
+        METRICS.files_committed.add(count as u64);
 
         if new_heads == *ref_.heads() {
             tracing::error!("Document heads {:?} didn't change after committing!", new_heads);
@@ -230,34 +237,4 @@ impl BranchDb {
             })
             .collect()
     }
-
-    pub async fn create_new_binary_doc(&self, content: Vec<u8>) -> DocHandle {
-        tracing::info!("Creating new binary doc...");
-        let handle = self.repo.create(Automerge::new()).await.unwrap();
-
-        let username = self.username.lock().await.clone();
-
-        // we're allowed to transact in the background: nobody needs this to exist yet.
-        let h = handle.clone();
-        tokio::task::spawn_blocking(move || {
-            h.with_document(|d| {
-                let mut tx = d.transaction();
-                let _ = tx.put(ROOT, "content", content);
-                commit_with_metadata(
-                    tx,
-                    &CommitMetadata {
-                        username: username,
-                        branch_id: None,
-                        merge_metadata: None,
-                        reverted_to: None,
-                        changed_files: None,
-                        is_setup: Some(false),
-                    },
-                );
-            });
-        });
-
-        // TODO: actually store the handle
-        return handle;
-    }
 }
@@ -201,7 +201,12 @@ impl BranchDb {
         )
     }
 
-    async fn get_linked_file(&self, doc_id: &DocumentId) -> Option<FileContent> {
+    /// Reads files out of one linked doc. Each file is either the doc's whole content, or a blob in a bundle doc.
+    async fn get_linked_files(
+        &self,
+        doc_id: &DocumentId,
+        entries: Vec<(String, Option<String>)>,
+    ) -> Vec<(String, Option<FileContent>)> {
         let handle = self
             .binary_states
             .lock()
@@ -210,18 +215,32 @@ impl BranchDb {
             .cloned()
             .flatten();
         let Some(handle) = handle else {
-            return None;
+            return entries.into_iter().map(|(path, _)| (path, None)).collect();
         };
 
         tokio::task::spawn_blocking(move || {
-            handle.with_document(|d| match d.get(ROOT, "content") {
-                Ok(Some((value, _))) if value.is_bytes() => {
-                    Some(FileContent::Binary(value.into_bytes().unwrap()))
-                }
-                Ok(Some((value, _))) if value.is_str() => {
-                    Some(FileContent::String(value.into_string().unwrap()))
-                }
-                _ => None,
+            handle.with_document(|d| {
+                let read = |obj: &ObjId, prop: &str| match d.get(obj, prop) {
+                    Ok(Some((value, _))) if value.is_bytes() => {
+                        Some(FileContent::Binary(value.into_bytes().unwrap()))
+                    }
+                    Ok(Some((value, _))) if value.is_str() => {
+                        Some(FileContent::String(value.into_string().unwrap()))
+                    }
+                    _ => None,
+                };
+                let blobs = d.get_obj_id(ROOT, "blobs");
+                entries
+                    .into_iter()
+                    .map(|(path, blob)| {
+                        let content = match (&blobs, blob) {
+                            (Some(blobs), Some(blob)) => read(blobs, &blob),
+                            (_, None) => read(&ROOT, "content"),
+                            (None, Some(_)) => None,
+                        };
+                        (path, content)
+                    })
+                    .collect()
             })
         })
         .await
@@ -282,12 +301,18 @@ impl BranchDb {
             .await
             .ok()??;
 
-        for (doc_id, path) in linked_doc_ids {
-            let linked_file_content: Option<FileContent> = self.get_linked_file(&doc_id).await;
-            if let Some(file_content) = linked_file_content {
-                files.insert(path, file_content);
-            } else {
-                tracing::warn!("linked file {:?} not found", path);
+        // Files in the same bundle are read together.
+        let mut linked_docs: HashMap<DocumentId, Vec<(String, Option<String>)>> = HashMap::new();
+        for ((doc_id, blob), path) in linked_doc_ids {
+            linked_docs.entry(doc_id).or_default().push((path, blob));
+        }
+        for (doc_id, entries) in linked_docs {
+            for (path, linked_file_content) in self.get_linked_files(&doc_id, entries).await {
+                if let Some(file_content) = linked_file_content {
+                    files.insert(path, file_content);
+                } else {
+                    tracing::warn!("linked file {:?} not found", path);
+                }
             }
         }
 
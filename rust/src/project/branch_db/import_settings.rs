@@ -0,0 +1,135 @@
+use std::{collections::HashSet, sync::Arc};
+
+use crate::{
+    fs::file_utils::FileContent,
+    helpers::memory::HeapSize,
+    project::branch_db::{BranchDb, HistoryRef},
+};
+
+/// The `.import` file of a resource, and the parts of it the resource loader needs.
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct ImportSettings {
+    /// The text of the `.import` file.
+    pub content: String,
+    /// The extension of the imported resource, from the `[remap]` path.
+    pub imported_extension: String,
+}
+
+impl ImportSettings {
+    /// Parses the text of an `.import` file. Like Godot, this takes the `path` key of the `[remap]`
+    /// section, or the first `path.*` key if there is none, e.g. `path.s3tc`.
+    pub fn parse(content: &str) -> Self {
+        let mut section = "";
+        let mut path = None;
+        let mut first_path = None;
+        for line in content.lines() {
+            let line = line.trim();
+            if let Some(name) = line.strip_prefix('[').and_then(|l| l.strip_suffix(']')) {
+                section = name;
+                continue;
+            }
+            if section != "remap" {
+                continue;
+            }
+            let Some((key, value)) = line.split_once('=') else {
+                continue;
+            };
+            let key = key.trim();
+            if key == "path" {
+                path = Some(value);
+                break;
+            }
+            if first_path.is_none() && key.starts_with("path") {
+                first_path = Some(value);
+            }
+        }
+        let path = path
+            .or(first_path)
+            .unwrap_or_default()
+            .trim()
+            .trim_matches('"');
+        let file_name = path.rsplit('/').next().unwrap_or_default();
+        let imported_extension = file_name
+            .rsplit_once('.')
+            .map(|(_, ext)| ext.to_lowercase())
+            .unwrap_or_default();
+        Self {
+            content: content.to_string(),
+            imported_extension,
+        }
+    }
+
+    fn from_content(content: Option<&FileContent>) -> Option<Arc<Self>> {
+        match content {
+            Some(FileContent::String(s)) => Some(Arc::new(Self::parse(s))),
+            _ => None,
+        }
+    }
+}
+
+impl HeapSize for ImportSettings {
+    fn heap_size(&self) -> usize {
+        self.content.heap_size() + self.imported_extension.heap_size()
+    }
+}
+
+impl BranchDb {
+    /// Returns the import settings of the resource at [path], only hydrating the `.import` file if it isn't cached yet.
+    pub async fn get_import_settings_at_ref(
+        &self,
+        ref_: &HistoryRef,
+        path: &str,
+    ) -> Option<Arc<ImportSettings>> {
+        if let Some(settings) = self.loader_cache.get_import_settings(ref_, path) {
+            return settings;
+        }
+        let import_path = format!("{path}.import");
+        let files = self
+            .get_files_at_ref(ref_, &HashSet::from([import_path.clone()]))
+            .await?;
+        let settings = ImportSettings::from_content(files.get(&import_path));
+        self.loader_cache
+            .insert_import_settings(ref_, path, settings.clone());
+        settings
+    }
+
+    /// Returns the content of the resource at [path] along with its import settings, hydrating both together.
+    /// If the resource has no `.import` file at [ref_], e.g. because it was never imported there,
+    /// the `.import` file at the checked out ref is used instead.
+    pub async fn get_resource_and_import_settings_at_ref(
+        &self,
+        ref_: &HistoryRef,
+        path: &str,
+    ) -> Option<(FileContent, Option<Arc<ImportSettings>>)> {
+        let import_path = format!("{path}.import");
+        let cached = self.loader_cache.get_import_settings(ref_, path);
+        let mut filters = HashSet::from([path.to_string()]);
+        if cached.is_none() {
+            filters.insert(import_path.clone());
+        }
+        let mut files = self.get_files_at_ref(ref_, &filters).await?;
+        let content = files.remove(path)?;
+        let settings = match cached {
+            Some(settings) => settings,
+            None => {
+                let settings = ImportSettings::from_content(files.get(&import_path));
+                self.loader_cache
+                    .insert_import_settings(ref_, path, settings.clone());
+                settings
+            }
+        };
+        if settings.is_some() {
+            return Some((content, settings));
+        }
+        let Some(checked_out_ref) = self.get_checked_out_ref().await else {
+            return Some((content, None));
+        };
+        if &checked_out_ref == ref_ {
+            return Some((content, None));
+        }
+        let settings = self
+            .get_import_settings_at_ref(&checked_out_ref, path)
+            .await;
+        Some((content, settings))
+    }
+}
@@ -0,0 +1,117 @@
+use std::sync::{Arc, Mutex};
+
+use crate::{
+    helpers::{
+        lru::Lru,
+        memory::{HeapSize, MemoryUsage},
+    },
+    project::branch_db::{HistoryRef, ImportSettings, ResourceMetadata},
+};
+
+/// How many bytes of loader lookups we keep around before evicting the least recently used.
+const LOADER_CACHE_CAPACITY: usize = 16 * 1024 * 1024;
+
+/// What the resource loader has looked up about one file at one ref.
+#[derive(Debug, Clone, Default)]
+struct LoaderEntry {
+    metadata: Option<Arc<ResourceMetadata>>,
+    /// `Some(None)` means the resource has no `.import` file at that ref, so we don't look for it again.
+    import_settings: Option<Option<Arc<ImportSettings>>>,
+}
+
+impl LoaderEntry {
+    fn weight(&self, ref_: &HistoryRef, path: &str) -> usize {
+        ref_.heap_size()
+            + path.len()
+            + self
+                .metadata
+                .as_ref()
+                .map_or(0, |metadata| metadata.heap_size())
+            + self
+                .import_settings
+                .as_ref()
+                .and_then(Option::as_ref)
+                .map_or(0, |settings| settings.heap_size())
+    }
+}
+
+/// A bounded cache of what the resource loader asked about, keyed by (ref, path): resource metadata and import
+/// settings share one LRU and one byte budget. Cheap to clone and safe to share across threads.
+/// Only lookups made by the loader are cached, and a ref with heads always points at the same file content,
+/// so entries never go stale.
+#[derive(Debug, Clone)]
+pub struct LoaderCache {
+    inner: Arc<Mutex<Lru<(HistoryRef, String), LoaderEntry>>>,
+}
+
+impl Default for LoaderCache {
+    fn default() -> Self {
+        Self {
+            inner: Arc::new(Mutex::new(Lru::new(LOADER_CACHE_CAPACITY))),
+        }
+    }
+}
+
+impl LoaderCache {
+    pub fn get_metadata(&self, ref_: &HistoryRef, path: &str) -> Option<Arc<ResourceMetadata>> {
+        self.inner
+            .lock()
+            .unwrap()
+            .get(&(ref_.clone(), path.to_string()))?
+            .metadata
+            .clone()
+    }
+
+    pub fn get_import_settings(
+        &self,
+        ref_: &HistoryRef,
+        path: &str,
+    ) -> Option<Option<Arc<ImportSettings>>> {
+        self.inner
+            .lock()
+            .unwrap()
+            .get(&(ref_.clone(), path.to_string()))?
+            .import_settings
+            .clone()
+    }
+
+    pub(super) fn insert_metadata(
+        &self,
+        ref_: &HistoryRef,
+        path: &str,
+        metadata: Arc<ResourceMetadata>,
+    ) {
+        self.update(ref_, path, |entry| entry.metadata = Some(metadata));
+    }
+
+    pub(super) fn insert_import_settings(
+        &self,
+        ref_: &HistoryRef,
+        path: &str,
+        settings: Option<Arc<ImportSettings>>,
+    ) {
+        self.update(ref_, path, |entry| entry.import_settings = Some(settings));
+    }
+
+    /// Updates the entry for (ref, path) and marks it as the most recently used.
+    /// Refs without heads aren't cached, since their content can change.
+    fn update(&self, ref_: &HistoryRef, path: &str, f: impl FnOnce(&mut LoaderEntry)) {
+        if !ref_.is_valid() {
+            return;
+        }
+        let key = (ref_.clone(), path.to_string());
+        let mut entries = self.inner.lock().unwrap();
+        let mut entry = entries.remove(&key).unwrap_or_default();
+        f(&mut entry);
+        let weight = entry.weight(ref_, path);
+        entries.insert(key, entry, weight);
+    }
+
+    pub fn memory_usage(&self) -> MemoryUsage {
+        let entries = self.inner.lock().unwrap();
+        MemoryUsage {
+            entries: entries.len(),
+            bytes: entries.weight(),
+        }
+    }
+}
@@ -0,0 +1,77 @@
+use std::{collections::HashSet, sync::Arc};
+
+use crate::{
+    fs::file_utils::FileContent,
+    helpers::memory::HeapSize,
+    project::branch_db::{BranchDb, HistoryRef, LoaderCache},
+};
+
+/// The parts of a file that Godot's resource loader asks about without loading it.
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct ResourceMetadata {
+    /// The resource type of a text scene or resource.
+    pub resource_type: Option<String>,
+    /// The uid text of a text scene or resource, or the contents of a `.uid` file.
+    pub uid: Option<String>,
+    /// The global class name of the resource's script, if any.
+    pub script_class: Option<String>,
+    /// The paths of the resource's ext_resources.
+    pub dependencies: Vec<String>,
+}
+
+impl ResourceMetadata {
+    /// Extracts the metadata for the file at [path]. Returns [None] for deleted files.
+    pub fn from_content(path: &str, content: &FileContent) -> Option<Self> {
+        match content {
+            FileContent::Scene(scene) => Some(Self {
+                resource_type: Some(scene.resource_type.clone()),
+                uid: Some(scene.uid.clone()),
+                script_class: scene.script_class.clone(),
+                dependencies: scene
+                    .ext_resources
+                    .values()
+                    .map(|ext_resource| ext_resource.path.clone())
+                    .collect(),
+            }),
+            FileContent::String(s) if path.ends_with(".uid") => Some(Self {
+                uid: Some(s.clone()),
+                ..Default::default()
+            }),
+            FileContent::String(_) | FileContent::Binary(_) => Some(Self::default()),
+            FileContent::Deleted => None,
+        }
+    }
+}
+
+impl HeapSize for ResourceMetadata {
+    fn heap_size(&self) -> usize {
+        self.resource_type.heap_size()
+            + self.uid.heap_size()
+            + self.script_class.heap_size()
+            + self.dependencies.heap_size()
+    }
+}
+
+impl BranchDb {
+    pub fn get_loader_cache(&self) -> LoaderCache {
+        self.loader_cache.clone()
+    }
+
+    /// Returns the loader metadata for the file at [path], only hydrating the file if it isn't cached yet.
+    pub async fn get_resource_metadata_at_ref(
+        &self,
+        ref_: &HistoryRef,
+        path: &str,
+    ) -> Option<Arc<ResourceMetadata>> {
+        if let Some(metadata) = self.loader_cache.get_metadata(ref_, path) {
+            return Some(metadata);
+        }
+        let files = self
+            .get_files_at_ref(ref_, &HashSet::from([path.to_string()]))
+            .await?;
+        let metadata = Arc::new(ResourceMetadata::from_content(path, files.get(path)?)?);
+        self.loader_cache
+            .insert_metadata(ref_, path, metadata.clone());
+        Some(metadata)
+    }
+}
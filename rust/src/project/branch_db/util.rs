@@ -5,7 +5,7 @@ use samod::DocumentId;
 use tracing::instrument;
 
 use crate::{
-    helpers::branch::Branch,
+    helpers::{branch::Branch, memory::MemoryUsage},
     project::branch_db::{BranchDb, HistoryRef},
 };
 
@@ -90,6 +90,14 @@ impl BranchDb {
             .is_ignore()
     }
 
+    /// The storage format version of the project. 0 until the metadata doc is loaded, or if it predates versioning.
+    pub async fn get_format_version(&self) -> u64 {
+        let meta = self.metadata_state.lock().await;
+        meta.as_ref()
+            .and_then(|(_, m)| m.format_version)
+            .unwrap_or(0)
+    }
+
     pub async fn get_branch_name(&self, id: &DocumentId) -> Option<String> {
         let meta = self.metadata_state.lock().await;
         Some(meta.as_ref()?.1.branches.get(id)?.name.clone())
@@ -128,6 +136,15 @@ impl BranchDb {
         Ok(f(shadow_doc).await)
     }
 
+    /// Returns the state of every branch in the project.
+    pub async fn get_branch_states(&self) -> Vec<Branch> {
+        let meta = self.metadata_state.lock().await;
+        let Some((_, m)) = meta.as_ref() else {
+            return Vec::new();
+        };
+        m.branches.values().cloned().collect()
+    }
+
     pub async fn get_branch_children(&self, id: &DocumentId) -> Vec<DocumentId> {
         let meta = self.metadata_state.lock().await;
         let mut result = Vec::new();
@@ -177,6 +194,63 @@ impl BranchDb {
         }).await.ok()
     }
 
+    /// Measures the shadow and canonical branch docs, and the binary docs, by their saved size.
+    /// Saving walks each whole doc, so this is slow on big projects.
+    #[instrument(skip_all)]
+    pub async fn measure_docs(&self) -> (MemoryUsage, MemoryUsage) {
+        let mut branch_docs = MemoryUsage::default();
+        let states: Vec<_> = self
+            .branch_sync_states
+            .lock()
+            .await
+            .values()
+            .cloned()
+            .collect();
+        for state in states {
+            // Only hold each branch's lock while copying its shadow doc, and save the copy off the runtime, so commits
+            // aren't stuck behind the save.
+            let (shadow_doc, canonical_doc) = {
+                let state = state.lock().await;
+                (state.shadow_doc.clone(), state.canonical_doc.clone())
+            };
+            if let Some(shadow_doc) = shadow_doc {
+                let size = tokio::task::spawn_blocking(move || shadow_doc.save().len())
+                    .await
+                    .unwrap();
+                branch_docs.add(size);
+            }
+            let size = tokio::task::spawn_blocking(move || {
+                canonical_doc.with_document(|d| d.save().len())
+            })
+            .await
+            .unwrap();
+            branch_docs.add(size);
+        }
+
+        let mut binary_docs = MemoryUsage::default();
+        let handles: Vec<_> = self
+            .binary_states
+            .lock()
+            .await
+            .values()
+            .flatten()
+            .cloned()
+            .collect();
+        for handle in handles {
+            let size =
+                tokio::task::spawn_blocking(move || handle.with_document(|d| d.save().len()))
+                    .await
+                    .unwrap();
+            binary_docs.add(size);
+        }
+        (branch_docs, binary_docs)
+    }
+
+    /// Resource metadata and import settings cached for the resource loader.
+    pub fn loader_cache_memory_usage(&self) -> MemoryUsage {
+        self.loader_cache.memory_usage()
+    }
+
     /// Dumps a branch document to disk, at ./.patchwork/DUMP_{id}.bin
     pub async fn dump_branch_doc(&self, id: &DocumentId) {
         let path = self
@@ -1,6 +1,6 @@
 use std::{
     collections::HashSet,
-    sync::Arc,
+    sync::{Arc, Mutex as StdMutex},
     time::{Duration, SystemTime},
 };
 
@@ -14,6 +14,8 @@ use tokio_util::sync::CancellationToken;
 
 use crate::{
     helpers::{
+        memory::{HeapSize, MemoryUsage},
+        metrics::METRICS,
         spawn_utils::spawn_named,
         utils::{CommitInfo, CommitMetadata, summarize_changes},
     },
@@ -29,6 +31,8 @@ pub struct ChangeIngester {
 #[derive(Debug)]
 struct ChangeIngesterInner {
     changes_tx: watch::Sender<Vec<CommitInfo>>,
+    /// The memory held by the history in [Self::changes_tx], measured whenever it's replaced.
+    history_usage: StdMutex<MemoryUsage>,
     ingestion_request: Notify,
     peer_watcher: Arc<PeerWatcher>,
     token: CancellationToken,
@@ -49,6 +53,7 @@ impl ChangeIngester {
         let ingestion_request = Notify::new();
         let inner = Arc::new(ChangeIngesterInner {
             changes_tx,
+            history_usage: Default::default(),
             peer_watcher,
             ingestion_request,
             token: token.clone(),
@@ -64,6 +69,9 @@ impl ChangeIngester {
             let reconcile_stream = inner_clone.branch_db.subscribe_doc_changes();
             tokio::pin!(reconcile_stream);
 
+            // Peer deltas only arrive when something changed, so ingest once up front.
+            inner_clone.ingestion_request.notify_one();
+
             loop {
                 select! {
                     _ = inner_clone.token.cancelled() => { break; }
@@ -87,6 +95,16 @@ impl ChangeIngester {
         self.inner.ingestion_request.notify_one();
     }
 
+    /// Builds the history of the checked out branch right away, without the debounce. Used by the benchmarks.
+    pub async fn get_changes(&self) -> Vec<CommitInfo> {
+        self.inner.get_changes().await
+    }
+
+    /// Returns the memory held by the ingested history.
+    pub fn memory_usage(&self) -> MemoryUsage {
+        *self.inner.history_usage.lock().unwrap()
+    }
+
     // I don't like exposing this, but it's the simplest solution for now.
     pub fn get_changes_rx(&self) -> watch::Receiver<Vec<CommitInfo>> {
         self.inner.changes_tx.subscribe()
@@ -117,7 +135,12 @@ impl ChangeIngesterInner {
             // since we're past the duration with no other requests, the counter resets.
             *last_ingest = (now, 0);
         }
-        self.changes_tx.send_replace(self.get_changes().await);
+        let changes = self.get_changes().await;
+        *self.history_usage.lock().unwrap() = MemoryUsage {
+            entries: changes.len(),
+            bytes: changes.heap_size(),
+        };
+        self.changes_tx.send_replace(changes);
         last_ingest.1 += 1;
     }
 
@@ -156,6 +179,8 @@ impl ChangeIngesterInner {
     /// Gets the changes from the current branch and returns it.
     #[tracing::instrument(skip_all)]
     async fn get_changes(&self) -> Vec<CommitInfo> {
+        METRICS.ingests.increment();
+        let _timer = METRICS.ingest_duration.start_timer();
         let checked_out = self.branch_db.get_checked_out_ref_mut();
         let checked_out = checked_out.read().await;
         let Some(checked_out) = checked_out.as_ref() else {
@@ -169,10 +194,8 @@ impl ChangeIngesterInner {
         // document, NOT the shadow document.
         let last_acked_heads = self
             .peer_watcher
-            .get_server_info()
-            .as_ref()
-            .and_then(|info| info.docs.get(checked_out.branch()))
-            .and_then(|state| state.last_acked_heads.clone());
+            .get_doc_state(checked_out.branch())
+            .and_then(|state| state.last_acked_heads);
 
         // When we have pending commits, there are several things we need to check.
         // - Unsynced and shadow-only: The commit is present in the shadow doc but not the canonical doc.
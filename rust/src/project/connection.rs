@@ -1,8 +1,28 @@
-use futures::Stream;
-use samod::{BackoffConfig, DialerHandle, Repo, Url};
+use std::{
+    collections::{HashMap, VecDeque},
+    sync::{Arc, Mutex as StdMutex},
+    time::{Duration, Instant},
+};
+
+use automerge::ChangeHash;
+use futures::{Stream, StreamExt};
+use samod::{BackoffConfig, DialerHandle, DocumentId, Repo, Url};
+use tokio::select;
 use tokio_util::sync::CancellationToken;
 
-use crate::helpers::spawn_utils::spawn_named;
+use crate::{
+    helpers::{metrics::METRICS, spawn_utils::spawn_named},
+    project::peer_watcher::{PeerDelta, PeerWatcher},
+};
+
+/// Acknowledged bytes count toward the upload rate for this long.
+const THROUGHPUT_WINDOW: Duration = Duration::from_secs(5);
+/// How many seconds of uploads we let be in flight, once we know how fast the link is.
+const UPLOAD_WINDOW: Duration = Duration::from_secs(2);
+/// The least we let be in flight, so a slow or unmeasured link still makes progress.
+const MIN_UPLOAD_WINDOW_BYTES: u64 = 4 * 1024 * 1024;
+/// How long an admitted upload counts as in flight before the server's sync state shows it.
+const RESERVATION_TTL: Duration = Duration::from_secs(2);
 
 /// Connects a repo to the remote server. Shuts down when dropped.
 #[derive(Debug)]
@@ -60,3 +80,224 @@ impl RemoteConnection {
         self.dialer.is_connected()
     }
 }
+
+/// How well the server is keeping up with what we send it.
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct ConnectionStats {
+    /// How long the server takes to acknowledge a document after we start sending it, smoothed.
+    pub rtt_ms: Option<u64>,
+    /// Bytes of changes the server acknowledged per second, over the last few seconds.
+    pub upload_bytes_per_sec: u64,
+    /// Bytes of changes we've sent or are sending that the server hasn't acknowledged.
+    pub outstanding_bytes: u64,
+    pub outstanding_docs: usize,
+}
+
+/// A document the server hasn't fully acknowledged.
+#[derive(Debug)]
+struct DocUpload {
+    /// When we first saw it unacknowledged.
+    since: Instant,
+    bytes: u64,
+}
+
+#[derive(Debug, Default)]
+struct MonitorState {
+    uploads: HashMap<DocumentId, DocUpload>,
+    rtt: Option<Duration>,
+    /// Bytes acknowledged within [THROUGHPUT_WINDOW], and when.
+    acked: VecDeque<(Instant, u64)>,
+    /// Uploads we've let through that the server's sync state may not show yet.
+    reserved: VecDeque<(Instant, u64)>,
+}
+
+impl MonitorState {
+    fn expire(&mut self, now: Instant) {
+        while self
+            .acked
+            .front()
+            .is_some_and(|(at, _)| now - *at > THROUGHPUT_WINDOW)
+        {
+            self.acked.pop_front();
+        }
+        while self
+            .reserved
+            .front()
+            .is_some_and(|(at, _)| now - *at > RESERVATION_TTL)
+        {
+            self.reserved.pop_front();
+        }
+    }
+
+    fn record_ack(&mut self, now: Instant, bytes: u64) {
+        if bytes > 0 {
+            self.acked.push_back((now, bytes));
+        }
+    }
+
+    fn record_rtt(&mut self, sample: Duration) {
+        METRICS.connection_rtt.record(sample.as_micros() as u64);
+        self.rtt = Some(match self.rtt {
+            Some(rtt) => (rtt * 7 + sample) / 8,
+            None => sample,
+        });
+    }
+
+    fn upload_rate(&self) -> u64 {
+        let bytes: u64 = self.acked.iter().map(|(_, bytes)| bytes).sum();
+        bytes / THROUGHPUT_WINDOW.as_secs()
+    }
+
+    fn in_flight(&self) -> u64 {
+        let uploading: u64 = self.uploads.values().map(|upload| upload.bytes).sum();
+        let reserved: u64 = self.reserved.iter().map(|(_, bytes)| bytes).sum();
+        uploading + reserved
+    }
+
+    fn window(&self) -> u64 {
+        (self.upload_rate() * UPLOAD_WINDOW.as_secs()).max(MIN_UPLOAD_WINDOW_BYTES)
+    }
+
+    fn stats(&self) -> ConnectionStats {
+        ConnectionStats {
+            rtt_ms: self.rtt.map(|rtt| rtt.as_millis() as u64),
+            upload_bytes_per_sec: self.upload_rate(),
+            outstanding_bytes: self.uploads.values().map(|upload| upload.bytes).sum(),
+            outstanding_docs: self.uploads.len(),
+        }
+    }
+
+    fn publish(&self) {
+        let stats = self.stats();
+        METRICS
+            .connection_outstanding_bytes
+            .set(stats.outstanding_bytes as i64);
+        METRICS
+            .connection_upload_rate
+            .set(stats.upload_bytes_per_sec as i64);
+    }
+}
+
+/// Measures round trip time, upload rate and bytes in flight on the server connection, and tells large uploads
+/// when there's room for them. Samod owns the socket, so this works from the sync state the server reports
+/// for each document, sizing what's in flight by the changes the server hasn't acknowledged.
+#[derive(Debug)]
+pub struct ConnectionMonitor {
+    state: Arc<StdMutex<MonitorState>>,
+    token: CancellationToken,
+}
+
+impl Drop for ConnectionMonitor {
+    fn drop(&mut self) {
+        self.token.cancel();
+    }
+}
+
+impl ConnectionMonitor {
+    pub fn new(repo: Repo, peer_watcher: Arc<PeerWatcher>) -> Self {
+        let state = Arc::new(StdMutex::new(MonitorState::default()));
+        let token = CancellationToken::new();
+        let state_clone = state.clone();
+        let token_clone = token.clone();
+        spawn_named("Connection monitor", async move {
+            let deltas = peer_watcher.subscribe();
+            tokio::pin!(deltas);
+            loop {
+                select! {
+                    _ = token_clone.cancelled() => { break; }
+                    Some(delta) = deltas.next() => {
+                        Self::update(&state_clone, &repo, &peer_watcher, delta).await;
+                    }
+                }
+            }
+        });
+        Self { state, token }
+    }
+
+    async fn update(
+        state: &StdMutex<MonitorState>,
+        repo: &Repo,
+        peer_watcher: &PeerWatcher,
+        delta: PeerDelta,
+    ) {
+        let connected = peer_watcher
+            .get_connection_info()
+            .is_some_and(|info| info.last_received.is_some());
+        if delta.connection_changed && !connected {
+            // Nothing is in flight without a connection; what we haven't sent is re-sent on reconnect.
+            state.lock().unwrap().uploads.clear();
+        }
+
+        for doc_id in delta.docs.iter() {
+            let Some(doc_state) = peer_watcher.get_doc_state(doc_id) else {
+                continue;
+            };
+            if doc_state.last_sent_heads.is_none() {
+                continue;
+            }
+            let now = Instant::now();
+            if doc_state.last_acked_heads == doc_state.last_sent_heads {
+                // The server has everything we sent.
+                let mut state = state.lock().unwrap();
+                if let Some(upload) = state.uploads.remove(doc_id) {
+                    state.record_ack(now, upload.bytes);
+                    state.record_rtt(now - upload.since);
+                }
+                continue;
+            }
+            let acked = doc_state.last_acked_heads.unwrap_or_default();
+            let bytes = Self::unacked_bytes(repo, doc_id, acked).await;
+            let mut state = state.lock().unwrap();
+            match state.uploads.get_mut(doc_id) {
+                Some(upload) => {
+                    let acked_bytes = upload.bytes.saturating_sub(bytes);
+                    upload.bytes = bytes;
+                    state.record_ack(now, acked_bytes);
+                }
+                None => {
+                    state
+                        .uploads
+                        .insert(doc_id.clone(), DocUpload { since: now, bytes });
+                }
+            }
+        }
+
+        let mut state = state.lock().unwrap();
+        state.expire(Instant::now());
+        state.publish();
+    }
+
+    /// The size of the changes to [doc_id] that aren't in [acked], as they'd be sent.
+    async fn unacked_bytes(repo: &Repo, doc_id: &DocumentId, acked: Vec<ChangeHash>) -> u64 {
+        let Ok(Some(handle)) = repo.find(doc_id.clone()).await else {
+            return 0;
+        };
+        tokio::task::spawn_blocking(move || {
+            handle.with_document(|d| d.save_after(&acked).len() as u64)
+        })
+        .await
+        .unwrap_or(0)
+    }
+
+    pub fn stats(&self) -> ConnectionStats {
+        let mut state = self.state.lock().unwrap();
+        state.expire(Instant::now());
+        state.stats()
+    }
+
+    /// Tries to make room on the connection for an upload of [bytes]. If the link is already full, returns false,
+    /// and the upload should wait so smaller changes don't queue behind it. When [first] is set, the upload goes
+    /// through as long as the link isn't full, however big it is, so large files can't be held back forever.
+    pub fn try_reserve(&self, bytes: u64, first: bool) -> bool {
+        let mut state = self.state.lock().unwrap();
+        let now = Instant::now();
+        state.expire(now);
+        let in_flight = state.in_flight();
+        let window = state.window();
+        let fits = in_flight + bytes <= window || (first && in_flight < window);
+        if fits {
+            state.reserved.push_back((now, bytes));
+        }
+        fits
+    }
+}
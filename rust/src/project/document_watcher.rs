@@ -1,19 +1,123 @@
-use std::{collections::{HashMap, HashSet}, sync::Arc};
+use std::{
+    collections::{HashMap, HashSet, VecDeque},
+    sync::{Arc, Mutex as StdMutex},
+};
 
 use crate::{
     helpers::{
-        branch::BranchesMetadataDoc, doc_utils::SimpleDocReader, spawn_utils::spawn_named,
-        utils::parse_automerge_url,
+        branch::BranchesMetadataDoc, doc_utils::SimpleDocReader, metrics::METRICS,
+        spawn_utils::spawn_named, utils::parse_automerge_url,
     },
     project::branch_db::BranchDb,
 };
 use automerge::{ROOT, ReadDoc};
 use autosurgeon::hydrate;
 use futures::{FutureExt, StreamExt};
+use indexmap::IndexMap;
 use samod::{DocHandle, DocumentId, Repo};
-use tokio::{select, sync::Mutex};
+use tokio::{
+    select,
+    sync::{Mutex, Notify},
+};
 use tokio_util::sync::CancellationToken;
 
+/// How many documents we fetch from the repo at once. Kept low enough that what's queued behind stays in priority order.
+const FETCH_WORKERS: usize = 16;
+
+/// A document waiting to be fetched from the repo.
+#[derive(Debug, Clone)]
+enum FetchJob {
+    Branch(DocumentId),
+    Binary(DocumentId),
+}
+
+/// Documents waiting to be fetched, in priority order. The active branch's binary docs come first,
+/// then other branches, then other branches' binary docs, so the branch the user is on loads without
+/// waiting on the rest of the project. Priority is decided when a job is taken, so switching branches
+/// reorders what's already queued.
+#[derive(Debug, Default)]
+struct FetchQueue {
+    branches: VecDeque<DocumentId>,
+    /// Binary docs by the branch that links them. A doc linked by several branches is queued under each,
+    /// and fetched from whichever comes up first.
+    binaries: IndexMap<DocumentId, VecDeque<DocumentId>>,
+    /// Binary docs queued and not yet taken.
+    pending: HashSet<DocumentId>,
+    /// Binary docs being fetched, so they aren't queued again meanwhile.
+    in_flight: HashSet<DocumentId>,
+}
+
+impl FetchQueue {
+    fn push_branch(&mut self, branch: DocumentId) {
+        self.branches.push_back(branch);
+        self.update_gauge();
+    }
+
+    fn push_binary(&mut self, branch: &DocumentId, doc: DocumentId) {
+        if self.in_flight.contains(&doc) {
+            return;
+        }
+        self.pending.insert(doc.clone());
+        self.binaries
+            .entry(branch.clone())
+            .or_default()
+            .push_back(doc);
+        self.update_gauge();
+    }
+
+    fn is_empty(&self) -> bool {
+        self.branches.is_empty() && self.pending.is_empty()
+    }
+
+    fn pop(&mut self, active: Option<&DocumentId>) -> Option<FetchJob> {
+        let job = self.pop_inner(active);
+        self.update_gauge();
+        job
+    }
+
+    fn pop_inner(&mut self, active: Option<&DocumentId>) -> Option<FetchJob> {
+        if let Some(active) = active {
+            if let Some(i) = self.branches.iter().position(|b| b == active) {
+                return self.branches.remove(i).map(FetchJob::Branch);
+            }
+            if let Some(doc) = self.pop_binary(active) {
+                return Some(FetchJob::Binary(doc));
+            }
+        }
+        if let Some(branch) = self.branches.pop_front() {
+            return Some(FetchJob::Branch(branch));
+        }
+        while let Some(branch) = self.binaries.keys().next().cloned() {
+            if let Some(doc) = self.pop_binary(&branch) {
+                return Some(FetchJob::Binary(doc));
+            }
+        }
+        None
+    }
+
+    /// Takes the next binary doc queued under [branch] that hasn't already been taken from another branch.
+    fn pop_binary(&mut self, branch: &DocumentId) -> Option<DocumentId> {
+        let queue = self.binaries.get_mut(branch)?;
+        let doc = std::iter::from_fn(|| queue.pop_front()).find(|doc| self.pending.remove(doc));
+        if queue.is_empty() {
+            self.binaries.shift_remove(branch);
+        }
+        let doc = doc?;
+        self.in_flight.insert(doc.clone());
+        Some(doc)
+    }
+
+    fn finish_binary(&mut self, doc: &DocumentId) {
+        self.in_flight.remove(doc);
+    }
+
+    fn update_gauge(&self) {
+        METRICS
+            .docs_queued_for_fetch
+            .set((self.branches.len() + self.pending.len()) as i64);
+    }
+}
+
 /// Tracks branch and metadata documents from an Automerge repo, updating BranchDB when the state changes.
 #[derive(Debug)]
 pub struct DocumentWatcher {
@@ -25,6 +129,10 @@ struct DocumentWatcherInner {
     repo: Repo,
     branch_db: BranchDb,
     tracked_branches: Arc<Mutex<HashSet<DocumentId>>>,
+    queue: Arc<StdMutex<FetchQueue>>,
+    queue_notify: Arc<Notify>,
+    /// The branch the user is on, or is about to be on, whose documents are fetched first.
+    priority_branch: Arc<StdMutex<Option<DocumentId>>>,
     token: CancellationToken,
 }
 
@@ -36,14 +144,31 @@ impl Drop for DocumentWatcher {
 
 impl DocumentWatcher {
     /// Spawns the [DocumentWatcher], creating parallel tasks for the metadata document tracking and subsequent tasks for any child documents.
-    pub async fn new(repo: Repo, branch_db: BranchDb, metadata_handle: DocHandle) -> Self {
+    /// [priority_branch] is the branch we expect to check out, if we know it; otherwise the checked out or main branch loads first.
+    /// Returns once that branch has been ingested. Other branches keep loading in the background.
+    pub async fn new(
+        repo: Repo,
+        branch_db: BranchDb,
+        metadata_handle: DocHandle,
+        priority_branch: Option<DocumentId>,
+    ) -> Self {
         let inner = Arc::new(DocumentWatcherInner {
             branch_db,
             repo,
             tracked_branches: Default::default(),
+            queue: Default::default(),
+            queue_notify: Default::default(),
+            priority_branch: Arc::new(StdMutex::new(priority_branch)),
             token: CancellationToken::new(),
         });
 
+        for i in 0..FETCH_WORKERS {
+            let inner_clone = inner.clone();
+            spawn_named(&format!("Document fetcher {i}"), async move {
+                inner_clone.fetch_documents().await;
+            });
+        }
+
         let inner_clone = inner.clone();
 
         // do the initial ingest
@@ -58,9 +183,89 @@ impl DocumentWatcher {
 
         return Self { inner };
     }
+
+    /// Fetches [branch] and its binary docs ahead of everything else, e.g. because we're about to check it out.
+    pub fn prioritize_branch(&self, branch: &DocumentId) {
+        *self.inner.priority_branch.lock().unwrap() = Some(branch.clone());
+    }
 }
 
 impl DocumentWatcherInner {
+    /// The branch whose documents are fetched first: the one we were told to prioritize, or else the checked out or main branch.
+    async fn active_branch(&self) -> Option<DocumentId> {
+        let priority_branch = self.priority_branch.lock().unwrap().clone();
+        if let Some(branch) = priority_branch {
+            if self.branch_db.get_branch_state(&branch).await.is_some() {
+                return Some(branch);
+            }
+            // e.g. a saved branch that was deleted or merged away since. It'll never load, so stop waiting on it.
+            tracing::info!(
+                "Priority branch {:?} isn't in the metadata; loading the checked out or main branch first",
+                branch
+            );
+            let mut priority_branch = self.priority_branch.lock().unwrap();
+            if priority_branch.as_ref() == Some(&branch) {
+                *priority_branch = None;
+            }
+        }
+        if let Some(checked_out) = self.branch_db.get_checked_out_ref().await {
+            return Some(checked_out.branch().clone());
+        }
+        self.branch_db.get_main_branch().await
+    }
+
+    /// Works through the fetch queue in priority order until cancelled.
+    async fn fetch_documents(&self) {
+        while !self.token.is_cancelled() {
+            if self.queue.lock().unwrap().is_empty() {
+                select! {
+                    _ = self.queue_notify.notified() => {}
+                    _ = self.token.cancelled() => {}
+                }
+                continue;
+            }
+            let active = self.active_branch().await;
+            let job = self.queue.lock().unwrap().pop(active.as_ref());
+            match job {
+                Some(FetchJob::Branch(branch)) => self.fetch_branch_document(branch).await,
+                Some(FetchJob::Binary(doc)) => {
+                    let handle = self.repo.find(doc.clone()).await;
+                    // this may trigger a reconciliation for a shadow doc
+                    self.branch_db
+                        .ingest_binary_doc(doc.clone(), handle.ok().flatten())
+                        .await;
+                    self.queue.lock().unwrap().finish_binary(&doc);
+                }
+                // Another fetcher took the last job.
+                None => {}
+            }
+        }
+    }
+
+    fn enqueue(&self, push: impl FnOnce(&mut FetchQueue)) {
+        push(&mut self.queue.lock().unwrap());
+        self.queue_notify.notify_one();
+    }
+
+    /// Finds a branch document, ingests it, and starts tracking it.
+    async fn fetch_branch_document(&self, branch_id: DocumentId) {
+        let Ok(Some(handle)) = self.repo.find(branch_id.clone()).await else {
+            tracing::error!(
+                "Document {:?} exists in the branch metadata document, but not the repo! Skipping.",
+                branch_id
+            );
+            // Let a later metadata change try again.
+            self.tracked_branches.lock().await.remove(&branch_id);
+            return;
+        };
+        self.ingest_branch_document(handle.clone()).await;
+        // Track the document
+        let this = self.clone();
+        spawn_named(&format!("Document tracker: {:?}", branch_id), async move {
+            this.track_branch_document(handle).await
+        });
+    }
+
     // The branch documents are a document for each branch, containing all the serialized data for all scenes and text files.
     async fn track_branch_document(&self, handle: DocHandle) {
         let mut stream = handle.changes();
@@ -97,20 +302,13 @@ impl DocumentWatcherInner {
 
     // Binary documents are immutable, linked docs that contain binary data.
     // By tracking them, we ensure BranchDb is aware of them.
-    async fn track_binary_document(&self, doc_id: DocumentId) {
-        let repo = self.repo.clone();
-        let branch_db = self.branch_db.clone();
+    // They're fetched in the background, with [branch]'s priority.
+    async fn track_binary_document(&self, branch: &DocumentId, doc_id: DocumentId) {
         // easy early exit
-        if branch_db.has_binary_doc(&doc_id).await {
+        if self.branch_db.has_binary_doc(&doc_id).await {
             return;
         }
-        tokio::task::spawn(async move {
-            let handle = repo.find(doc_id.clone()).await;
-            // this may trigger a reconciliation for a shadow doc
-            branch_db
-                .ingest_binary_doc(doc_id, handle.ok().flatten())
-                .await;
-        });
+        self.enqueue(|queue| queue.push_binary(branch, doc_id));
     }
 
     #[tracing::instrument(skip_all)]
@@ -155,13 +353,16 @@ impl DocumentWatcherInner {
         .await
         .unwrap();
 
-        for (_, doc) in &linked_docs {
-            // spawn off a task to track the binary document
-            self.track_binary_document(doc.clone()).await;
+        // Files packed into the same bundle share a linked doc, so it's only tracked once.
+        let linked_docs: HashSet<DocumentId> = linked_docs.into_values().collect();
+        for doc in &linked_docs {
+            // queue the binary document to be tracked
+            self.track_binary_document(handle.document_id(), doc.clone())
+                .await;
         }
 
         self.branch_db
-            .update_branch_sync_state(handle, heads, linked_docs.values().cloned().collect())
+            .update_branch_sync_state(handle, heads, linked_docs)
             .await;
     }
 
@@ -181,23 +382,25 @@ impl DocumentWatcherInner {
             .set_metadata_state(handle, meta.clone())
             .await;
         // check if there are new branches that haven't loaded yet
-        let mut tracked_branches = self.tracked_branches.lock().await;
-        for (branch_id, _) in meta.branches.iter() {
-            if !tracked_branches.contains(branch_id) {
-                let Some(handle) = self.repo.find(branch_id.clone()).await.unwrap() else {
-                    tracing::error!(
-                        "Document {:?} exists in the branch metadata document, but not the repo! Skipping.",
-                        branch_id
-                    );
-                    continue;
-                };
-                tracked_branches.insert(branch_id.clone());
-                self.ingest_branch_document(handle.clone()).await;
-                // Track the document
-                let this = self.clone();
-                spawn_named(&format!("Document tracker: {:?}", branch_id), async move {
-                    this.track_branch_document(handle).await
-                });
+        let new_branches = {
+            let mut tracked_branches = self.tracked_branches.lock().await;
+            let new_branches: Vec<DocumentId> = meta
+                .branches
+                .keys()
+                .filter(|branch_id| !tracked_branches.contains(branch_id))
+                .cloned()
+                .collect();
+            tracked_branches.extend(new_branches.iter().cloned());
+            new_branches
+        };
+        // The active branch is the one the user is waiting on, so load it right away.
+        // The rest queue up behind its binary docs.
+        let active = self.active_branch().await;
+        for branch_id in new_branches {
+            if Some(&branch_id) == active.as_ref() {
+                self.fetch_branch_document(branch_id).await;
+            } else {
+                self.enqueue(|queue| queue.push_branch(branch_id));
             }
         }
     }
@@ -1,11 +1,12 @@
-use crate::diff::differ::{Differ, ProjectDiff};
 use crate::fs::file_utils::FileSystemEvent;
 use crate::helpers::history_ref::HistoryRef;
+use crate::helpers::lock_watch;
+use crate::helpers::memory::MemoryReport;
 use crate::helpers::spawn_utils::spawn_named;
 use crate::helpers::utils::CommitInfo;
-use crate::project::branch_db::BranchDb;
+use crate::project::branch_db::{BUNDLES_FORMAT_VERSION, BranchDb};
 use crate::project::change_ingester::ChangeIngester;
-use crate::project::connection::RemoteConnection;
+use crate::project::connection::{ConnectionMonitor, ConnectionStats, RemoteConnection};
 use crate::project::document_watcher::DocumentWatcher;
 use crate::project::main_thread_block::MainThreadBlock;
 use crate::project::peer_watcher::PeerWatcher;
@@ -13,7 +14,7 @@ use crate::project::sync_automerge_to_fs::SyncAutomergeToFileSystem;
 use crate::project::sync_fs_to_automerge::SyncFileSystemToAutomerge;
 use futures::StreamExt;
 use ignore::gitignore::{Gitignore, GitignoreBuilder};
-use samod::{ConcurrencyConfig, ConnectionInfo, DocHandle, DocumentId, Repo, Url};
+use samod::{ConcurrencyConfig, ConnectionInfo, DocHandle, DocumentId, PeerDocState, Repo, Url};
 use std::path::PathBuf;
 use std::sync::Arc;
 use std::sync::atomic::{AtomicBool, Ordering};
@@ -23,6 +24,8 @@ use tokio::sync::{Mutex, mpsc, watch};
 use tokio_util::sync::CancellationToken;
 use tracing::instrument;
 
+#[cfg(test)]
+mod perf_harness;
 #[cfg(test)]
 mod tests;
 
@@ -53,6 +56,7 @@ pub struct DriverInner {
     // subtasks
     #[allow(unused)]
     connection: RemoteConnection,
+    connection_monitor: Arc<ConnectionMonitor>,
     branch_db: BranchDb,
     peer_watcher: Arc<PeerWatcher>,
     change_ingester: ChangeIngester,
@@ -60,7 +64,6 @@ pub struct DriverInner {
     document_watcher: DocumentWatcher,
     sync_automerge_to_fs: SyncAutomergeToFileSystem,
     sync_fs_to_automerge: SyncFileSystemToAutomerge,
-    differ: Differ,
 }
 
 impl Drop for Driver {
@@ -129,8 +132,11 @@ impl Driver {
             })
             .await;
         let peer_watcher = Arc::new(PeerWatcher::new(repo.clone()));
+        let connection_monitor =
+            Arc::new(ConnectionMonitor::new(repo.clone(), peer_watcher.clone()));
         let sync_automerge_to_fs = SyncAutomergeToFileSystem::new(branch_db.clone());
-        let sync_fs_to_automerge = SyncFileSystemToAutomerge::new(branch_db.clone());
+        let sync_fs_to_automerge =
+            SyncFileSystemToAutomerge::new(branch_db.clone(), connection_monitor.clone());
 
         let metadata_handle = match &metadata_id {
             // If we're expecting an existing ID, try and fetch it.
@@ -146,7 +152,13 @@ impl Driver {
 
         // The document watcher will auto-ingest the provided metadata handle.
         let document_watcher =
-            DocumentWatcher::new(repo.clone(), branch_db.clone(), metadata_handle).await;
+            DocumentWatcher::new(
+                repo.clone(),
+                branch_db.clone(),
+                metadata_handle,
+                saved_branch_id.clone(),
+            )
+            .await;
 
         // If this is a new project (i.e. we earlier made a metadata doc), check in the files.
         // This has to go after the document watcher ingests the metadata doc, of course.
@@ -156,7 +168,6 @@ impl Driver {
 
         let change_ingester = ChangeIngester::new(peer_watcher.clone(), branch_db.clone());
         change_ingester.request_ingestion();
-        let differ = Differ::new(branch_db.clone());
 
         // At this point, if we loaded an existing project, we may not have checked it out yet.
         // We'll discover that while processing updates, and check it out then.
@@ -175,13 +186,13 @@ impl Driver {
                 token: token.clone(),
                 requested_checkout: Arc::new(Mutex::new(saved_branch_id)),
                 connection,
+                connection_monitor,
                 branch_db,
                 peer_watcher,
                 change_ingester,
                 document_watcher,
                 sync_automerge_to_fs,
                 sync_fs_to_automerge,
-                differ,
             }),
             repo,
             token,
@@ -193,6 +204,10 @@ impl Driver {
             inner_clone.sync_main().await;
             tracing::info!("Sync shutting down");
         });
+        spawn_named(
+            "Lock watchdog",
+            lock_watch::run_watchdog(this.as_ref().unwrap().token.clone()),
+        );
         this
     }
 
@@ -230,6 +245,7 @@ impl Driver {
     /// Request the sync task to checkout the latest ref on a branch the next opportunity.
     /// This will only work once Godot is safe to update.
     pub async fn request_checkout(&self, branch: &DocumentId) {
+        self.inner.document_watcher.prioritize_branch(branch);
         let mut req = self.inner.requested_checkout.lock().await;
         *req = Some(branch.clone());
     }
@@ -358,11 +374,6 @@ impl Driver {
         self.request_checkout(forked_from.branch()).await;
     }
 
-    pub async fn get_diff(&self, before: &HistoryRef, after: &HistoryRef) -> ProjectDiff {
-        self.inner.differ.get_diff(before, after).await
-        // ProjectDiff::default()
-    }
-
     pub async fn get_metadata_doc(&self) -> Option<DocumentId> {
         self.inner
             .branch_db
@@ -371,6 +382,15 @@ impl Driver {
             .map(|(handle, _)| handle.document_id().clone())
     }
 
+    /// Switches the project to bundling small binary files. Every collaborator picks this up from the metadata doc,
+    /// so it should only be turned on once they all run a client that reads bundles.
+    pub async fn enable_binary_bundles(&self) {
+        self.inner
+            .branch_db
+            .raise_format_version(BUNDLES_FORMAT_VERSION)
+            .await;
+    }
+
     pub async fn get_main_branch(&self) -> Option<DocumentId> {
         self.inner
             .branch_db
@@ -379,8 +399,19 @@ impl Driver {
             .map(|(_, doc)| doc.main_doc_id)
     }
 
+    /// Returns the server connection, without per-document state.
     pub async fn get_connection_info(&self) -> Option<ConnectionInfo> {
-        self.inner.peer_watcher.get_server_info()
+        self.inner.peer_watcher.get_connection_info()
+    }
+
+    /// Returns round trip time, upload rate and bytes in flight on the server connection.
+    pub fn get_connection_stats(&self) -> ConnectionStats {
+        self.inner.connection_monitor.stats()
+    }
+
+    /// Returns the server's sync state for a single document.
+    pub async fn get_peer_doc_state(&self, doc_id: &DocumentId) -> Option<PeerDocState> {
+        self.inner.peer_watcher.get_doc_state(doc_id)
     }
 
     pub fn set_safe_to_update_editor(&self, safe: bool) {
@@ -389,10 +420,21 @@ impl Driver {
             .store(safe, Ordering::Relaxed);
     }
 
+    /// Commits every save that hasn't been committed yet, including large files held back for a slow connection,
+    /// so none of them are lost when the driver stops.
+    pub async fn flush_pending_changes(&self) {
+        self.inner.sync_fs_to_automerge.flush().await;
+    }
+
     pub fn get_branch_db(&self) -> BranchDb {
         self.inner.branch_db.clone()
     }
 
+    /// A handle for measuring the driver's memory, so a report doesn't have to hold the driver lock while it measures.
+    pub fn memory_reporter(&self) -> DriverMemoryReporter {
+        DriverMemoryReporter(self.inner.clone())
+    }
+
     // awkward
     pub fn get_filesystem_changes(&mut self) -> Vec<FileSystemEvent> {
         let mut fs_changes = Vec::new();
@@ -552,3 +594,29 @@ impl DriverInner {
         }
     }
 }
+
+/// Measures the memory held by the driver's subsystems. See [Driver::memory_reporter].
+pub struct DriverMemoryReporter(Arc<DriverInner>);
+
+impl DriverMemoryReporter {
+    /// Measuring the docs is slow, so it's opt-in. The diff cache lives on the project, so it's left empty.
+    pub async fn get_memory_report(&self, measure_docs: bool) -> MemoryReport {
+        let inner = &self.0;
+        let (fs_watcher, pending_changes) = inner.sync_fs_to_automerge.memory_usage().await;
+        let (branch_docs, binary_docs) = if measure_docs {
+            let (branch_docs, binary_docs) = inner.branch_db.measure_docs().await;
+            (Some(branch_docs), Some(binary_docs))
+        } else {
+            (None, None)
+        };
+        MemoryReport {
+            branch_docs,
+            binary_docs,
+            fs_watcher,
+            pending_changes,
+            history: inner.change_ingester.memory_usage(),
+            diff_cache: Default::default(),
+            loader_caches: inner.branch_db.loader_cache_memory_usage(),
+        }
+    }
+}
@@ -0,0 +1,380 @@
+use std::{
+    collections::HashMap,
+    path::PathBuf,
+    time::{Duration, Instant},
+};
+
+use samod::{DocumentId, Repo, Url};
+use tempfile::TempDir;
+use tokio::{net::TcpListener, select};
+use tokio_util::sync::CancellationToken;
+
+use crate::{
+    fs::file_utils::FileSystemEvent,
+    helpers::{metrics::METRICS, spawn_utils::spawn_named},
+    project::{driver::Driver, main_thread_block::MainThreadBlock},
+};
+
+/// How long the harness waits for a single step before failing the run.
+const STEP_TIMEOUT: Duration = Duration::from_secs(60);
+/// How often the harness plays the editor's main thread, roughly a frame.
+const FRAME: Duration = Duration::from_millis(5);
+
+const SCENE_TEMPLATE: &str = r#"[gd_scene format=3 uid="uid://bperfharness"]
+
+[node name="Root" type="Node2D"]
+
+[node name="Player" type="Sprite2D" parent="."]
+position = Vector2({x}, 0)
+"#;
+
+/// A samod peer that relays documents between the harness peers over loopback TCP, like the real sync server.
+struct SyncServer {
+    url: Url,
+    token: CancellationToken,
+    _repo: Repo,
+    _storage: TempDir,
+}
+
+impl Drop for SyncServer {
+    fn drop(&mut self) {
+        self.token.cancel();
+    }
+}
+
+impl SyncServer {
+    async fn start() -> Self {
+        let storage = TempDir::new().unwrap();
+        let repo = Repo::build_tokio()
+            .with_storage(samod::storage::TokioFilesystemStorage::new(
+                storage.path().to_path_buf(),
+            ))
+            .load()
+            .await;
+        let listener = TcpListener::bind("127.0.0.1:0").await.unwrap();
+        let url = Url::parse(&format!("tcp://{}", listener.local_addr().unwrap())).unwrap();
+        let acceptor = repo.make_acceptor(url.clone()).unwrap();
+        let token = CancellationToken::new();
+        let token_clone = token.clone();
+        spawn_named("Harness sync server", async move {
+            loop {
+                select! {
+                    _ = token_clone.cancelled() => break,
+                    accepted = listener.accept() => {
+                        let Ok((socket, _)) = accepted else { continue; };
+                        if let Err(e) = acceptor.accept_tokio_io(socket) {
+                            tracing::error!("Harness sync server couldn't accept a connection: {e:?}");
+                        }
+                    }
+                }
+            }
+        });
+        Self {
+            url,
+            token,
+            _repo: repo,
+            _storage: storage,
+        }
+    }
+}
+
+/// A [Driver] on its own project directory, with the harness standing in for the editor's main thread.
+struct Peer {
+    dir: PathBuf,
+    driver: Option<Driver>,
+    block: MainThreadBlock,
+    /// When each file was last written to this peer's disk by a checkout, by project-relative path.
+    written: HashMap<String, Instant>,
+    _dir: TempDir,
+}
+
+impl Peer {
+    async fn start(name: &str, server: &SyncServer, metadata_id: Option<DocumentId>) -> Self {
+        let temp_dir = TempDir::new().unwrap();
+        // Checkouts report canonical paths, so match them.
+        let dir = temp_dir.path().canonicalize().unwrap();
+        let block = MainThreadBlock::new();
+        let driver = Driver::new(
+            block.clone(),
+            server.url.clone(),
+            dir.clone(),
+            name.to_string(),
+            dir.join(".patchwork"),
+            metadata_id,
+            None,
+        )
+        .await
+        .expect("Couldn't start the driver");
+        driver.set_safe_to_update_editor(true);
+        Self {
+            dir,
+            driver: Some(driver),
+            block,
+            written: HashMap::new(),
+            _dir: temp_dir,
+        }
+    }
+
+    fn driver(&self) -> &Driver {
+        self.driver.as_ref().unwrap()
+    }
+
+    /// Saves a file the way the editor would, and returns when it hit the disk.
+    async fn save(&self, path: &str, content: &str) -> Instant {
+        let path = self.dir.join(path);
+        tokio::fs::create_dir_all(path.parent().unwrap())
+            .await
+            .unwrap();
+        tokio::fs::write(&path, content).await.unwrap();
+        Instant::now()
+    }
+
+    async fn read(&self, path: &str) -> Option<String> {
+        tokio::fs::read_to_string(self.dir.join(path)).await.ok()
+    }
+
+    async fn checked_out_branch(&self) -> Option<DocumentId> {
+        self.driver()
+            .get_branch_db()
+            .get_checked_out_ref()
+            .await
+            .map(|ref_| ref_.branch().clone())
+    }
+
+    /// Plays one editor frame: lets a waiting sync task check out, then collects the files it wrote.
+    async fn frame(&mut self) {
+        self.block.checkpoint().await;
+        let now = Instant::now();
+        for event in self.driver.as_mut().unwrap().get_filesystem_changes() {
+            let path = match &event {
+                FileSystemEvent::FileCreated(path, _) | FileSystemEvent::FileModified(path, _) => {
+                    path
+                }
+                FileSystemEvent::FileDeleted(path) => path,
+            };
+            if let Ok(relative) = path.strip_prefix(&self.dir) {
+                let relative = relative.to_string_lossy().replace('\\', "/");
+                self.written.insert(relative, now);
+            }
+        }
+    }
+
+    /// Shuts the driver down off the runtime, since dropping it blocks on the repo stopping.
+    async fn stop(mut self) {
+        let driver = self.driver.take();
+        tokio::task::spawn_blocking(move || drop(driver))
+            .await
+            .unwrap();
+    }
+}
+
+/// Two peers, A and B, syncing one project through an in-process server.
+struct Harness {
+    a: Peer,
+    b: Peer,
+    _server: SyncServer,
+}
+
+impl Harness {
+    /// Starts peer A on a new project, then peer B on the same project, and waits until B has checked it out.
+    async fn start() -> Self {
+        let server = SyncServer::start().await;
+        let a = Peer::start("peer-a", &server, None).await;
+        let metadata_id = a.driver().get_metadata_doc().await.unwrap();
+        let b = Peer::start("peer-b", &server, Some(metadata_id)).await;
+        let mut harness = Self {
+            a,
+            b,
+            _server: server,
+        };
+        harness
+            .pump_until("B checks out the project", async |h| {
+                h.b.checked_out_branch().await.is_some()
+            })
+            .await;
+        harness
+    }
+
+    /// Runs frames on both peers until [done] holds. Panics after [STEP_TIMEOUT].
+    async fn pump_until(&mut self, step: &str, mut done: impl AsyncFnMut(&Self) -> bool) {
+        let start = Instant::now();
+        loop {
+            self.a.frame().await;
+            self.b.frame().await;
+            if done(self).await {
+                return;
+            }
+            assert!(
+                start.elapsed() < STEP_TIMEOUT,
+                "Timed out waiting for: {step}"
+            );
+            tokio::time::sleep(FRAME).await;
+        }
+    }
+
+    /// Waits until B has written [path] with [content], and returns how long after [saved_at] that was.
+    async fn wait_for_b(&mut self, path: &str, content: &str, saved_at: Instant) -> Duration {
+        self.pump_until(&format!("B writes {path}"), async |h| {
+            h.b.written.get(path).is_some_and(|at| *at >= saved_at)
+                && h.b.read(path).await.as_deref() == Some(content)
+        })
+        .await;
+        self.b.written[path] - saved_at
+    }
+
+    async fn stop(self) {
+        self.a.stop().await;
+        self.b.stop().await;
+    }
+}
+
+/// Latencies of one workload.
+struct Report {
+    name: &'static str,
+    samples: Vec<Duration>,
+}
+
+impl Report {
+    fn new(name: &'static str) -> Self {
+        Self {
+            name,
+            samples: Vec::new(),
+        }
+    }
+
+    fn print(&self) {
+        let mut sorted = self.samples.clone();
+        sorted.sort();
+        let at = |p: f64| sorted[((sorted.len() - 1) as f64 * p).round() as usize];
+        println!(
+            "{:<24} n={:<4} p50={:>8.1?} p95={:>8.1?} max={:>8.1?}",
+            self.name,
+            sorted.len(),
+            at(0.5),
+            at(0.95),
+            sorted[sorted.len() - 1],
+        );
+    }
+}
+
+/// A writes many files at once, like importing an asset pack. Measures until the last one lands on B.
+async fn bulk_import(h: &mut Harness, files: usize) -> Report {
+    let mut report = Report::new("bulk import (last file)");
+    let mut saved_at = Instant::now();
+    for i in 0..files {
+        saved_at =
+            h.a.save(
+                &format!("import/script_{i}.gd"),
+                &format!("extends Node\n\nvar id = {i}\n"),
+            )
+            .await;
+    }
+    let last = format!("import/script_{}.gd", files - 1);
+    let content = format!("extends Node\n\nvar id = {}\n", files - 1);
+    report
+        .samples
+        .push(h.wait_for_b(&last, &content, saved_at).await);
+    for i in 0..files {
+        let path = format!("import/script_{i}.gd");
+        h.pump_until(&format!("B writes {path}"), async |h| {
+            h.b.read(&path).await.is_some()
+        })
+        .await;
+    }
+    report
+}
+
+/// A saves a scene over and over, like nudging a node in the editor. Measures each save until it lands on B.
+async fn scene_edits(h: &mut Harness, edits: usize) -> Report {
+    let mut report = Report::new("scene edit");
+    for i in 0..edits {
+        let content = SCENE_TEMPLATE.replace("{x}", &i.to_string());
+        let saved_at = h.a.save("levels/level.tscn", &content).await;
+        report
+            .samples
+            .push(h.wait_for_b("levels/level.tscn", &content, saved_at).await);
+    }
+    report
+}
+
+/// A forks a branch, changes it, and switches between it and main. Measures each switch on A.
+/// Returns the branch, which has one more file than main.
+async fn branch_switches(h: &mut Harness, switches: usize) -> (Report, DocumentId) {
+    let mut report = Report::new("branch switch");
+    let main = h.a.driver().get_main_branch().await.unwrap();
+    h.a.driver().fork_branch("perf".to_string(), &main).await;
+    h.pump_until("A checks out the fork", async |h| {
+        h.a.checked_out_branch().await.is_some_and(|b| b != main)
+    })
+    .await;
+    let branch = h.a.checked_out_branch().await.unwrap();
+    h.a.save("branch_only.gd", "extends Node\n").await;
+    h.pump_until("A commits to the fork", async |h| {
+        let branch_db = h.a.driver().get_branch_db();
+        let Some(ref_) = branch_db.get_latest_ref_on_branch(&branch).await else {
+            return false;
+        };
+        branch_db
+            .get_files_at_ref(&ref_, &["res://branch_only.gd".to_string()].into())
+            .await
+            .is_some_and(|files| !files.is_empty())
+    })
+    .await;
+
+    for i in 0..switches {
+        let target = if i % 2 == 0 { &main } else { &branch };
+        let start = Instant::now();
+        h.a.driver().request_checkout(target).await;
+        h.pump_until("A switches branches", async |h| {
+            h.a.checked_out_branch().await.as_ref() == Some(target)
+        })
+        .await;
+        report.samples.push(start.elapsed());
+    }
+    if h.a.checked_out_branch().await.as_ref() != Some(&branch) {
+        h.a.driver().request_checkout(&branch).await;
+        h.pump_until("A returns to the fork", async |h| {
+            h.a.checked_out_branch().await.as_ref() == Some(&branch)
+        })
+        .await;
+    }
+    (report, branch)
+}
+
+/// A merges [branch] into main. Measures from the merge until B, on main, has the branch's file.
+async fn merge(h: &mut Harness, branch: &DocumentId) -> Report {
+    let mut report = Report::new("merge");
+    let main = h.a.driver().get_main_branch().await.unwrap();
+    let start = Instant::now();
+    h.a.driver().merge_branch(branch, &main).await;
+    report.samples.push(
+        h.wait_for_b("branch_only.gd", "extends Node\n", start)
+            .await,
+    );
+    report
+}
+
+#[tokio::test(flavor = "multi_thread", worker_threads = 4)]
+#[ignore = "slow end-to-end benchmark; run with `just perf-harness`"]
+async fn two_peer_sync_latency() {
+    let mut h = Harness::start().await;
+
+    let reports = vec![
+        bulk_import(&mut h, 200).await,
+        scene_edits(&mut h, 20).await,
+    ];
+    let (switch_report, branch) = branch_switches(&mut h, 10).await;
+    let merge_report = merge(&mut h, &branch).await;
+
+    println!("\nEnd-to-end latency, save on A to write on B (branch switches are local to A):");
+    for report in reports.iter().chain([&switch_report, &merge_report]) {
+        report.print();
+    }
+    h.a.driver().memory_reporter().get_memory_report(true).await.publish();
+    println!(
+        "\n{}",
+        serde_json::to_string_pretty(&METRICS.snapshot()).unwrap()
+    );
+
+    h.stop().await;
+}
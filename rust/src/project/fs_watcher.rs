@@ -25,6 +25,7 @@ use crate::{
         file_utils::FileSystemEvent,
         file_utils::{FileContent, calculate_file_hash, get_buffer_and_hash},
     },
+    helpers::{memory::MemoryUsage, metrics::METRICS},
     project::branch_db::BranchDb,
 };
 
@@ -34,11 +35,14 @@ use crate::{
 // Can we just do this naively, provide all FS events to the caller,
 // then check the hashes against automerge to see if it's actually changed?
 
+/// The hash of every file the watcher has seen, by path.
+pub type FileHashes = Arc<Mutex<HashMap<PathBuf, Digest>>>;
+
 /// Watches a directory for filesystem changes, and emits them as a stream.
 #[derive(Debug, Clone)]
 pub struct FileSystemWatcher {
     watch_path: PathBuf,
-    file_hashes: Arc<Mutex<HashMap<PathBuf, Digest>>>,
+    file_hashes: FileHashes,
     branch_db: BranchDb,
     found_ignored_paths: Arc<Mutex<HashSet<PathBuf>>>,
 }
@@ -161,15 +165,17 @@ impl FileSystemWatcher {
         tracing::debug!("handling filesystem event: {:?}", path);
         let result = self.handle_file_event(path.clone()).await;
         if let Ok(Some(ret)) = result {
+            METRICS.fs_events.increment();
             return Some(ret);
         }
         return None;
     }
 
-    // Watch the filesystem for meaningful changes
+    // Watch the filesystem for meaningful changes, tracking file hashes in [file_hashes].
     pub async fn start_watching(
         path: PathBuf,
         branch_db: BranchDb,
+        file_hashes: FileHashes,
     ) -> impl Stream<Item = FileSystemEvent> {
         let (notify_tx, notify_rx) = mpsc::unbounded_channel();
         let notify_tx_clone = notify_tx.clone();
@@ -191,7 +197,7 @@ impl FileSystemWatcher {
 
         let this = FileSystemWatcher {
             watch_path: path,
-            file_hashes: Arc::new(Mutex::new(HashMap::new())),
+            file_hashes,
             branch_db,
             found_ignored_paths: Arc::new(Mutex::new(HashSet::new())),
         };
@@ -227,3 +233,12 @@ impl FileSystemWatcher {
         }
     }
 }
+
+/// The paths and hashes held by a [FileSystemWatcher].
+pub async fn file_hashes_memory_usage(file_hashes: &FileHashes) -> MemoryUsage {
+    let mut usage = MemoryUsage::default();
+    for path in file_hashes.lock().await.keys() {
+        usage.add(path.as_os_str().len() + std::mem::size_of::<Digest>());
+    }
+    usage
+}
@@ -0,0 +1,88 @@
+use std::sync::{Arc, RwLock};
+
+use tokio::runtime::Handle;
+
+use crate::{
+    fs::file_utils::FileContent,
+    helpers::{history_ref::HistoryRef, spawn_utils::spawn_named_on},
+    project::branch_db::{BranchDb, ImportSettings, ResourceMetadata},
+};
+
+/// The reader for the running project, if any.
+static CURRENT: RwLock<Option<HistoryReader>> = RwLock::new(None);
+
+/// A read-only, thread-safe handle into project history.
+/// Godot's resource loader runs on its own threads, so it must not touch the GodotProject singleton node
+/// or wait on the driver lock, which the main thread may be holding while it waits on a load.
+/// This goes straight to [BranchDb] instead, so many history resources can load in parallel.
+#[derive(Debug, Clone)]
+pub struct HistoryReader {
+    branch_db: BranchDb,
+    runtime: Handle,
+}
+
+impl HistoryReader {
+    pub fn new(branch_db: BranchDb, runtime: Handle) -> Self {
+        Self { branch_db, runtime }
+    }
+
+    /// Sets the reader for the running project. Pass [None] when the project stops.
+    pub fn set_current(reader: Option<HistoryReader>) {
+        *CURRENT.write().unwrap() = reader;
+    }
+
+    /// Returns the reader for the running project, or [None] if no project is running.
+    pub fn current() -> Option<HistoryReader> {
+        CURRENT.read().unwrap().clone()
+    }
+
+    /// Runs a BranchDb query on the driver's runtime, and blocks the calling thread until it's done.
+    /// Must not be called from inside the runtime.
+    fn block_on<F, Fut, R>(&self, name: &str, f: F) -> R
+    where
+        F: FnOnce(BranchDb) -> Fut + Send + 'static,
+        Fut: Future<Output = R> + Send + 'static,
+        R: Send + 'static,
+    {
+        let branch_db = self.branch_db.clone();
+        self.runtime
+            .block_on(spawn_named_on(name, &self.runtime, async move {
+                f(branch_db).await
+            }))
+            .unwrap()
+    }
+
+    /// Returns the loader metadata for a file. Cache hits don't block at all.
+    pub fn get_resource_metadata_at_ref(
+        &self,
+        path: &String,
+        ref_: &HistoryRef,
+    ) -> Option<Arc<ResourceMetadata>> {
+        if let Some(metadata) = self.branch_db.get_loader_cache().get_metadata(ref_, path) {
+            return Some(metadata);
+        }
+        let path = path.clone();
+        let ref_ = ref_.clone();
+        self.block_on("Read resource metadata at ref", |branch_db| async move {
+            branch_db.get_resource_metadata_at_ref(&ref_, &path).await
+        })
+    }
+
+    /// Returns a resource's content and import settings in a single lookup. Cached import settings aren't read again.
+    pub fn get_resource_and_import_settings_at_ref(
+        &self,
+        path: &String,
+        ref_: &HistoryRef,
+    ) -> Option<(FileContent, Option<Arc<ImportSettings>>)> {
+        let path = path.clone();
+        let ref_ = ref_.clone();
+        self.block_on(
+            "Read resource and import settings at ref",
+            |branch_db| async move {
+                branch_db
+                    .get_resource_and_import_settings_at_ref(&ref_, &path)
+                    .await
+            },
+        )
+    }
+}
@@ -1,14 +1,98 @@
+use std::{
+    collections::HashMap,
+    sync::{Arc, RwLock},
+};
+
 use futures::{Stream, StreamExt};
-use samod::{ConnectionInfo, Repo};
-use tokio::{select, sync::watch};
-use tokio_stream::wrappers::WatchStream;
+use samod::{ConnectionInfo, DocumentId, PeerDocState, Repo};
+use tokio::{select, sync::broadcast};
+use tokio_stream::wrappers::{BroadcastStream, errors::BroadcastStreamRecvError};
 use tokio_util::sync::CancellationToken;
 
 use crate::helpers::spawn_utils::spawn_named;
 
+/// A change in what the server has seen of our documents.
+#[derive(Debug, Clone)]
+pub struct PeerDelta {
+    /// Whether the server connected or disconnected.
+    pub connection_changed: bool,
+    /// The documents whose acked or sent heads changed.
+    pub docs: Arc<Vec<DocumentId>>,
+}
+
+/// What the server has seen of our documents. Updated in place, one document at a time.
+#[derive(Debug, Default)]
+struct PeerState {
+    /// The server connection. Its `docs` are always empty; they live in [Self::docs].
+    connection: Option<ConnectionInfo>,
+    docs: HashMap<DocumentId, PeerDocState>,
+}
+
+impl PeerState {
+    fn is_connected(&self) -> bool {
+        self.connection
+            .as_ref()
+            .is_some_and(|info| info.last_received.is_some())
+    }
+
+    /// Applies a new connection report from the server, and returns what changed, if anything.
+    fn update(&mut self, mut new_info: ConnectionInfo) -> Option<PeerDelta> {
+        let was_connected = self.is_connected();
+        let new_docs = std::mem::take(&mut new_info.docs);
+        self.connection = Some(new_info);
+
+        let mut changed = Vec::new();
+        for (doc_id, new_doc_state) in new_docs {
+            if let Some(old_doc_state) = self.docs.get(&doc_id) {
+                // If we got beheaded, skip this doc.
+                if new_doc_state
+                    .last_acked_heads
+                    .as_ref()
+                    .is_some_and(|h| h.len() == 0)
+                    && old_doc_state
+                        .last_acked_heads
+                        .as_ref()
+                        .is_some_and(|h| h.len() > 0)
+                {
+                    continue;
+                }
+                // Timestamps move on every heartbeat; only report docs whose heads moved.
+                if old_doc_state.last_acked_heads != new_doc_state.last_acked_heads
+                    || old_doc_state.last_sent_heads != new_doc_state.last_sent_heads
+                {
+                    changed.push(doc_id.clone());
+                }
+            } else {
+                changed.push(doc_id.clone());
+            }
+            self.docs.insert(doc_id, new_doc_state);
+        }
+
+        let connection_changed = was_connected != self.is_connected();
+        if !connection_changed && changed.is_empty() {
+            return None;
+        }
+        Some(PeerDelta {
+            connection_changed,
+            docs: Arc::new(changed),
+        })
+    }
+
+    /// A delta that covers the whole state, for subscribers that fell behind and missed some deltas.
+    fn resync(&self) -> PeerDelta {
+        PeerDelta {
+            connection_changed: true,
+            docs: Arc::new(self.docs.keys().cloned().collect()),
+        }
+    }
+}
+
+/// Tracks the server's sync state for each of our documents.
+/// Heartbeats only cost as much as the documents whose state actually changed, and subscribers only hear about those.
 #[derive(Debug)]
 pub struct PeerWatcher {
-    server_info_tx: watch::Sender<Option<ConnectionInfo>>,
+    state: Arc<RwLock<PeerState>>,
+    delta_tx: broadcast::Sender<PeerDelta>,
     token: CancellationToken,
 }
 
@@ -20,8 +104,10 @@ impl Drop for PeerWatcher {
 
 impl PeerWatcher {
     pub fn new(repo_handle: Repo) -> Self {
-        let (tx, rx) = watch::channel(None);
-        let tx_clone = tx.clone();
+        let (delta_tx, _) = broadcast::channel(64);
+        let state = Arc::new(RwLock::new(PeerState::default()));
+        let state_clone = state.clone();
+        let tx_clone = delta_tx.clone();
         let repo_handle_clone = repo_handle.clone();
         let token = CancellationToken::new();
         let token_clone = token.clone();
@@ -35,9 +121,11 @@ impl PeerWatcher {
                         // Currently, we only ever have 1 peer: the server.
                         // Therefore, this code expects that the server is the first and only peer, if it's connected.
                         // When we move to more peers, we'll need to figure out a way to identify the server here.
-                        if let Some(info) = peers.first() {
-                            let old_info = rx.borrow().clone();
-                            _ = tx_clone.send(Some(Self::update_server_info(old_info, info.clone()).await));
+                        if let Some(info) = peers.into_iter().next() {
+                            let delta = state_clone.write().unwrap().update(info);
+                            if let Some(delta) = delta {
+                                _ = tx_clone.send(delta);
+                            }
                         }
                     }
                 }
@@ -45,47 +133,33 @@ impl PeerWatcher {
         });
 
         Self {
-            server_info_tx: tx,
+            state,
+            delta_tx,
             token,
         }
     }
 
-    pub fn subscribe(&self) -> impl Stream<Item = Option<ConnectionInfo>> {
-        return WatchStream::new(self.server_info_tx.subscribe());
+    /// Streams every change in the server's state. Consumers interested in a single document can filter on [PeerDelta::docs].
+    /// A subscriber that falls too far behind gets one delta marking the connection and every document as changed
+    /// in place of the deltas it missed, so it re-reads whatever it needs.
+    pub fn subscribe(&self) -> impl Stream<Item = PeerDelta> {
+        let state = self.state.clone();
+        BroadcastStream::new(self.delta_tx.subscribe()).map(move |delta| match delta {
+            Ok(delta) => delta,
+            Err(BroadcastStreamRecvError::Lagged(missed)) => {
+                tracing::debug!("Peer delta subscriber missed {missed} deltas; resyncing");
+                state.read().unwrap().resync()
+            }
+        })
     }
 
-    pub fn get_server_info(&self) -> Option<ConnectionInfo> {
-        return self.server_info_tx.subscribe().borrow().clone();
+    /// Returns the server connection, without per-document state. See [Self::get_doc_state].
+    pub fn get_connection_info(&self) -> Option<ConnectionInfo> {
+        self.state.read().unwrap().connection.clone()
     }
 
-    async fn update_server_info(
-        old_info: Option<ConnectionInfo>,
-        new_info: ConnectionInfo,
-    ) -> ConnectionInfo {
-        if old_info.is_none() {
-            return new_info;
-        }
-        let mut info = old_info.unwrap();
-        info.last_received = new_info.last_received;
-        info.last_sent = new_info.last_sent;
-
-        for (doc_id, new_doc_state) in &new_info.docs {
-            if let Some(old_doc_state) = info.docs.get(doc_id) {
-                // If we got beheaded, skip this doc.
-                if new_doc_state
-                    .last_acked_heads
-                    .as_ref()
-                    .is_some_and(|h| h.len() == 0)
-                    && old_doc_state
-                        .last_acked_heads
-                        .as_ref()
-                        .is_some_and(|h| h.len() > 0)
-                {
-                    continue;
-                }
-            }
-            info.docs.insert(doc_id.clone(), new_doc_state.clone());
-        }
-        info
+    /// Returns the server's sync state for a single document.
+    pub fn get_doc_state(&self, doc_id: &DocumentId) -> Option<PeerDocState> {
+        self.state.read().unwrap().docs.get(doc_id).cloned()
     }
 }
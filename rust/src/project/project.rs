@@ -1,22 +1,33 @@
-use crate::diff::differ::ProjectDiff;
+use crate::diff::diff_cache::{DEFAULT_DIFF_CACHE_BYTES, DEFAULT_DIFF_DISK_CACHE_BYTES, DiffCache};
+use crate::diff::differ::{Differ, ProjectDiff};
 use crate::fs::file_utils::FileSystemEvent;
 use crate::helpers::branch::Branch;
 use crate::helpers::history_ref::HistoryRef;
+use crate::helpers::lock_watch::{self, MainThreadStall};
+use crate::helpers::memory::MemoryReport;
+use crate::helpers::metrics::METRICS;
 use crate::helpers::spawn_utils::spawn_named_on;
 use crate::helpers::utils::CommitInfo;
 use crate::interop::godot_accessors::{
     EditorFilesystemAccessor, PatchworkConfigAccessor, PatchworkEditorAccessor,
 };
+use crate::project::branch_db::BranchDb;
 use crate::project::driver::Driver;
+use crate::project::history_reader::HistoryReader;
 use crate::project::main_thread_block::MainThreadBlock;
+use crate::project::ui_state::{UiState, UiStateDelta};
 use automerge::ChangeHash;
 use samod::{DocumentId, Url};
 use std::cell::RefCell;
 use std::path::PathBuf;
-use std::sync::Arc;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, Mutex as StdMutex};
+use std::time::Duration;
 use std::{collections::HashMap, str::FromStr};
 use tokio::runtime::Runtime;
+use tokio::select;
 use tokio::sync::{Mutex, OwnedMutexGuard, watch};
+use tokio_util::sync::CancellationToken;
 use tracing::instrument;
 
 /// Manages the state and operations of a Patchwork project within Godot.
@@ -40,17 +51,36 @@ pub struct Project {
     pub(super) history: Option<Vec<ChangeHash>>,
     pub(super) changes: HashMap<ChangeHash, CommitInfo>,
 
+    // What the UI was last told about, see [UiState]
+    pub(super) ui_state: UiState,
+
     // Cached diffs between refs
-    pub(super) diff_cache: RefCell<HashMap<(HistoryRef, HistoryRef), ProjectDiff>>,
+    pub(super) diff_cache: DiffCache,
+    // Diffs the UI asked for that weren't in memory, by refs. None while they're loaded or computed in the background.
+    diff_loads: Arc<StdMutex<HashMap<(HistoryRef, HistoryRef), Option<Arc<ProjectDiff>>>>>,
+    // Set once one of [diff_loads] is ready, so the UI can ask for it again
+    diff_loaded: Arc<AtomicBool>,
+    // Cancels the running diff prefetch, if any
+    prefetch_token: RefCell<CancellationToken>,
+    // Cancels the running prefetch of the branch tip's diff, which new changes start without cancelling the above
+    tip_prefetch_token: RefCell<CancellationToken>,
+    // Cancels the periodic metrics dump
+    metrics_token: CancellationToken,
 }
 
 /// The default server URL used for syncing Patchwork projects. Can be overridden by user or project configuration.
 const DEFAULT_SERVER_URL: &str = "24.199.97.236:8085";
 
+/// How often the metrics are written to `.patchwork/metrics.json`, in seconds. Can be overridden by user configuration; 0 disables it.
+const DEFAULT_METRICS_DUMP_INTERVAL: &str = "60";
+
 /// Notifications that can be emitted via process and consumed by GodotProject, in order to trigger signals to GDScript.
 pub enum GodotProjectSignal {
     CheckedOutBranch,
-    ChangesIngested,
+    /// The state shown in the UI changed. Only emitted for non-empty deltas.
+    StateChanged(UiStateDelta),
+    /// A diff that wasn't ready when the UI asked for it is ready now.
+    DiffLoaded,
 }
 
 impl Project {
@@ -73,7 +103,13 @@ impl Project {
             runtime,
             history: None,
             changes: HashMap::new(),
-            diff_cache: RefCell::new(HashMap::new()),
+            ui_state: UiState::default(),
+            diff_cache: DiffCache::new(DEFAULT_DIFF_CACHE_BYTES, None, 0),
+            diff_loads: Arc::new(StdMutex::new(HashMap::new())),
+            diff_loaded: Arc::new(AtomicBool::new(false)),
+            prefetch_token: RefCell::new(CancellationToken::new()),
+            tip_prefetch_token: RefCell::new(CancellationToken::new()),
+            metrics_token: CancellationToken::new(),
         }
     }
 
@@ -90,18 +126,153 @@ impl Project {
             history.push(change.hash);
             self.changes.insert(change.hash, change);
         }
+
+        // The branch tip moved, so its diff against the fork point is the next diff the user is likely to open.
+        // Peers can push changes every frame, so this has its own token rather than cancelling what the user started.
+        self.spawn_prefetch(&self.tip_prefetch_token, Vec::new(), true);
+    }
+
+    /// Returns the diff between two refs if it's ready. Otherwise, reads it from disk or computes it in the
+    /// background and returns None, so the main thread never waits on either; [GodotProjectSignal::DiffLoaded] is sent
+    /// once it's ready to ask for again.
+    pub fn get_cached_diff(&self, before: HistoryRef, after: HistoryRef) -> Option<Arc<ProjectDiff>> {
+        if let Some(diff) = self.diff_cache.get(&before, &after) {
+            return Some(diff);
+        }
+        let key = (before.clone(), after.clone());
+        {
+            let mut diff_loads = self.diff_loads.lock().unwrap();
+            match diff_loads.get(&key) {
+                // Still loading.
+                Some(None) => return None,
+                // Too big for the memory cache, so it's only handed over once.
+                Some(Some(_)) => return diff_loads.remove(&key).flatten(),
+                None => {
+                    diff_loads.insert(key.clone(), None);
+                }
+            }
+        }
+
+        let driver = self.driver.clone();
+        let cache = self.diff_cache.clone();
+        let diff_loads = self.diff_loads.clone();
+        let diff_loaded = self.diff_loaded.clone();
+        spawn_named_on("Load diff", self.runtime.handle(), async move {
+            let load_cache = cache.clone();
+            let loaded = tokio::task::spawn_blocking(move || load_cache.load(&before, &after))
+                .await
+                .ok()
+                .flatten();
+            let diff = match loaded {
+                Some(diff) => Some(diff),
+                None => {
+                    // Only hold the driver lock long enough to grab the branch db, so we never hold up the main thread.
+                    let branch_db = driver.lock().await.as_ref().map(|driver| driver.get_branch_db());
+                    match branch_db {
+                        Some(branch_db) => {
+                            let (before, after) = key.clone();
+                            let diff = Arc::new(Differ::new(branch_db).get_diff(&before, &after).await);
+                            cache.insert(before.clone(), after.clone(), diff.clone());
+                            let persist_cache = cache.clone();
+                            let persisted = diff.clone();
+                            tokio::task::spawn_blocking(move || persist_cache.persist(&before, &after, &persisted));
+                            Some(diff)
+                        }
+                        None => None,
+                    }
+                }
+            };
+            let mut diff_loads = diff_loads.lock().unwrap();
+            match diff {
+                // Only keep the diffs the memory cache couldn't.
+                Some(diff) if cache.get(&key.0, &key.1).is_none() => {
+                    diff_loads.insert(key, Some(diff));
+                }
+                _ => {
+                    diff_loads.remove(&key);
+                }
+            }
+            diff_loaded.store(true, Ordering::Release);
+        });
+        None
+    }
+
+    /// The checked out branch, with the refs of its default diff: its latest synced ref against where it forked from,
+    /// or against the branch it's being merged into for a merge preview.
+    pub(super) async fn get_default_diff_refs(branch_db: &BranchDb) -> Option<(Branch, HistoryRef, HistoryRef)> {
+        let branch = branch_db.get_checked_out_ref().await?.branch().clone();
+        let state = branch_db.get_branch_state(&branch).await?;
+        let heads_after = branch_db.get_latest_ref_on_branch(&branch).await?.heads().clone();
+        // revert preview and regular branch both use forked_at
+        let heads_before = match &state.merge_into {
+            Some(merge_into) => merge_into.heads().clone(),
+            None => state.forked_from.as_ref()?.heads().clone(),
+        };
+        let before = HistoryRef::new(state.id.clone(), heads_before);
+        let after = HistoryRef::new(state.id.clone(), heads_after);
+        Some((state, before, after))
     }
 
-    pub fn get_cached_diff(&self, before: HistoryRef, after: HistoryRef) -> ProjectDiff {
-        self.diff_cache
-            .borrow_mut()
-            .entry((before.clone(), after.clone()))
-            .or_insert_with(|| self.get_diff(before, after))
-            .clone()
+    /// Computes diffs the user is likely to open next in the background, so they're already cached when asked for.
+    /// With [include_default], the checked out branch's default diff is prefetched before [pairs].
+    /// Cancels whatever was being prefetched before, since the user has moved on.
+    pub(super) fn prefetch_diffs(&self, pairs: Vec<(HistoryRef, HistoryRef)>, include_default: bool) {
+        self.spawn_prefetch(&self.prefetch_token, pairs, include_default);
+    }
+
+    /// Prefetches [pairs] like [Self::prefetch_diffs], cancelling the previous prefetch under [token_cell] only.
+    fn spawn_prefetch(
+        &self,
+        token_cell: &RefCell<CancellationToken>,
+        pairs: Vec<(HistoryRef, HistoryRef)>,
+        include_default: bool,
+    ) {
+        let token = CancellationToken::new();
+        token_cell.replace(token.clone()).cancel();
+        if pairs.is_empty() && !include_default {
+            return;
+        }
+
+        let driver = self.driver.clone();
+        let cache = self.diff_cache.clone();
+        spawn_named_on("Prefetch diffs", self.runtime.handle(), async move {
+            // Only hold the driver lock long enough to grab the branch db, so we never hold up the main thread.
+            let Some(branch_db) = driver.lock().await.as_ref().map(|driver| driver.get_branch_db()) else {
+                return;
+            };
+            let mut pairs = pairs;
+            if include_default
+                && let Some((_, before, after)) = Self::get_default_diff_refs(&branch_db).await
+            {
+                pairs.insert(0, (before, after));
+            }
+            let differ = Differ::new_speculative(branch_db);
+
+            for (before, after) in pairs {
+                // Diffs persisted in an earlier session only need to be read back into memory.
+                let load_cache = cache.clone();
+                let (load_before, load_after) = (before.clone(), after.clone());
+                let loaded = tokio::task::spawn_blocking(move || load_cache.load(&load_before, &load_after)).await;
+                if matches!(loaded, Ok(Some(_))) {
+                    continue;
+                }
+                let diff = select! {
+                    _ = token.cancelled() => return,
+                    diff = differ.get_diff(&before, &after) => Arc::new(diff),
+                };
+                tracing::debug!("Prefetched diff {:?} -> {:?}", before, after);
+                cache.insert(before.clone(), after.clone(), diff.clone());
+                let persist_cache = cache.clone();
+                tokio::task::spawn_blocking(move || persist_cache.persist(&before, &after, &diff));
+
+                // Stay low priority; let anything the user is actually waiting on run first.
+                tokio::task::yield_now().await;
+            }
+        });
     }
 
     pub fn clear_diff_cache(&self) {
-        self.diff_cache.borrow_mut().clear();
+        self.diff_cache.clear();
     }
 
     // Do not run this on anything except the main thread!
@@ -112,12 +283,6 @@ impl Project {
             || PatchworkEditorAccessor::unsaved_files_open());
     }
 
-    pub fn get_diff(&self, before: HistoryRef, after: HistoryRef) -> ProjectDiff {
-        self.with_driver_blocking("Get diff", |driver| async move {
-            driver.as_ref().unwrap().get_diff(&before, &after).await
-        })
-    }
-
     pub fn start(&mut self) {
         if self.driver.blocking_lock().is_some() {
             tracing::error!("Driver is already started!");
@@ -125,6 +290,27 @@ impl Project {
         }
 
         let storage_dir = self.project_dir.join(".patchwork");
+
+        // Diffs between fixed points in history never change, so by default we keep them across sessions.
+        let persist_diffs = PatchworkConfigAccessor::get_user_value("persist_diff_cache", "true") != "false";
+        self.diff_cache = DiffCache::new(
+            DEFAULT_DIFF_CACHE_BYTES,
+            persist_diffs.then(|| storage_dir.join("diff_cache")),
+            DEFAULT_DIFF_DISK_CACHE_BYTES,
+        );
+        let metrics_path = storage_dir.join("metrics.json");
+        let warn_ms = |key, default: u64| {
+            PatchworkConfigAccessor::get_user_value(key, &default.to_string())
+                .parse::<u64>()
+                .unwrap_or(default)
+        };
+        lock_watch::set_thresholds(
+            warn_ms("lock_hold_warn_ms", lock_watch::DEFAULT_LOCK_HOLD_WARN_MS),
+            warn_ms("main_thread_stall_warn_ms", lock_watch::DEFAULT_MAIN_THREAD_STALL_WARN_MS),
+        );
+        lock_watch::set_capture_backtraces(
+            PatchworkConfigAccessor::get_user_value("lock_hold_backtraces", "false") == "true",
+        );
         let server_url = {
             let project = PatchworkConfigAccessor::get_project_value("server_url", "");
             let user = PatchworkConfigAccessor::get_user_value("server_url", "");
@@ -190,6 +376,7 @@ impl Project {
 
         let project_dir = self.project_dir.clone();
         let username = PatchworkConfigAccessor::get_user_value("user_name", "");
+        let binary_bundles = PatchworkConfigAccessor::get_project_value("binary_bundles", "false") == "true";
         let block = self.main_thread_block.clone();
 
         // TODO: Don't block on main thread for checkin
@@ -208,6 +395,9 @@ impl Project {
                         saved_branch_id
                     )
                     .await;
+                    if binary_bundles {
+                        driver.as_ref().unwrap().enable_binary_bundles().await;
+                    }
                     let metadata = driver.as_ref().unwrap().get_metadata_doc().await;
                     (driver, metadata)
                 }),
@@ -227,11 +417,91 @@ impl Project {
         );
         self.changes_rx = Some(driver.get_changes_rx());
         self.checked_out_ref_rx = Some(driver.get_ref_rx());
+        HistoryReader::set_current(Some(HistoryReader::new(
+            driver.get_branch_db(),
+            self.runtime.handle().clone(),
+        )));
 
         *self.driver.blocking_lock() = Some(driver);
+        self.start_metrics_dump(metrics_path);
+    }
+
+    /// Periodically writes the metrics to the storage dir, so regressions in the field can be spotted from the file.
+    fn start_metrics_dump(&mut self, path: PathBuf) {
+        let interval = PatchworkConfigAccessor::get_user_value(
+            "metrics_dump_interval",
+            DEFAULT_METRICS_DUMP_INTERVAL,
+        )
+        .parse::<u64>()
+        .unwrap_or(0);
+        if interval == 0 {
+            return;
+        }
+        let token = CancellationToken::new();
+        std::mem::replace(&mut self.metrics_token, token.clone()).cancel();
+        let driver = self.driver.clone();
+        let diff_cache = self.diff_cache.clone();
+        spawn_named_on("Dump metrics", self.runtime.handle(), async move {
+            loop {
+                select! {
+                    _ = token.cancelled() => break,
+                    _ = tokio::time::sleep(Duration::from_secs(interval)) => {}
+                }
+                // Docs are slow to measure, so the dump keeps whatever they last measured.
+                Self::collect_memory_report(&driver, &diff_cache, false)
+                    .await
+                    .publish();
+                let path = path.clone();
+                let result = tokio::task::spawn_blocking(move || METRICS.dump(&path)).await;
+                if let Ok(Err(e)) = result {
+                    tracing::warn!("Couldn't write metrics: {e}");
+                }
+            }
+        });
+    }
+
+    /// Measures the memory held by each subsystem, and publishes it to the metrics.
+    /// With [measure_docs], this saves every doc to measure it, which blocks for a while on big projects.
+    pub fn get_memory_report(&self, measure_docs: bool) -> MemoryReport {
+        let driver = self.driver.clone();
+        let diff_cache = self.diff_cache.clone();
+        let _stall = MainThreadStall::start("Get memory report");
+        let report = self
+            .runtime
+            .block_on(spawn_named_on("Get memory report", self.runtime.handle(), async move {
+                Self::collect_memory_report(&driver, &diff_cache, measure_docs).await
+            }))
+            .unwrap();
+        report.publish();
+        report
+    }
+
+    async fn collect_memory_report(
+        driver: &Mutex<Option<Driver>>,
+        diff_cache: &DiffCache,
+        measure_docs: bool,
+    ) -> MemoryReport {
+        // Measuring can take a while, so don't hold the driver lock the main thread waits on meanwhile.
+        let reporter = driver.lock().await.as_ref().map(Driver::memory_reporter);
+        let mut report = match reporter {
+            Some(reporter) => reporter.get_memory_report(measure_docs).await,
+            None => MemoryReport::default(),
+        };
+        report.diff_cache = diff_cache.memory_usage();
+        report
     }
 
     pub fn stop(&mut self) {
+        self.prefetch_token.borrow().cancel();
+        self.tip_prefetch_token.borrow().cancel();
+        self.metrics_token.cancel();
+        HistoryReader::set_current(None);
+        // Large saves held back for a slow connection only live in memory, so commit them before the repo stops.
+        self.with_driver_blocking("Flush pending changes", |driver| async move {
+            if let Some(driver) = driver.as_ref() {
+                driver.flush_pending_changes().await;
+            }
+        });
         self.driver.blocking_lock().take();
         self.history = None;
     }
@@ -262,6 +532,7 @@ impl Project {
     {
         let driver = self.driver.clone();
         let name_clone = name.to_string();
+        let _stall = MainThreadStall::start(name);
         self.runtime
             .block_on(spawn_named_on(name, self.runtime.handle(), async move {
                 tracing::trace!("Starting block on {name_clone}...");
@@ -277,6 +548,7 @@ impl Project {
     pub fn process(&mut self, _delta: f64) -> (Vec<FileSystemEvent>, Vec<GodotProjectSignal>) {
         tracing::trace!("Running project process...");
         let fs_changes = {
+            let _stall = MainThreadStall::start("Blocking guard");
             let mut driver_guard = self.driver.blocking_lock();
             if driver_guard.is_none() {
                 return (Vec::new(), Vec::new());
@@ -310,20 +582,21 @@ impl Project {
             let rx = self.changes_rx.as_mut().unwrap();
             if self.history.is_none() || rx.has_changed().unwrap_or(false) {
                 rx.mark_unchanged();
-                signals.push(GodotProjectSignal::ChangesIngested);
                 Some(rx.borrow().clone())
             } else {
                 None
             }
         };
 
+        let changes_ingested = changes.is_some();
         if let Some(changes) = changes {
             self.ingest_changes(changes);
         }
 
         // Check to see if we need to produce a CheckedOutBranch signal
         let rx = self.checked_out_ref_rx.as_mut().unwrap();
-        if rx.has_changed().unwrap_or(false) {
+        let checked_out_branch = rx.has_changed().unwrap_or(false);
+        if checked_out_branch {
             let doc_id = rx
                 .borrow()
                 .as_ref()
@@ -334,6 +607,18 @@ impl Project {
             rx.mark_unchanged();
         }
 
+        if self.diff_loaded.swap(false, Ordering::AcqRel) {
+            signals.push(GodotProjectSignal::DiffLoaded);
+        }
+
+        // What the UI shows only changes along with new changes or a checkout, so only look at it then.
+        if changes_ingested || checked_out_branch {
+            let delta = self.refresh_ui_state();
+            if !delta.is_empty() {
+                signals.insert(0, GodotProjectSignal::StateChanged(delta));
+            }
+        }
+
         tracing::trace!("Done with process.");
         (fs_changes, signals)
     }
@@ -1,18 +1,20 @@
 use std::collections::{HashMap, HashSet};
+use std::sync::Arc;
 
 use automerge::ChangeHash;
 use samod::DocumentId;
 
-use crate::{diff::differ::ProjectDiff, fs::file_utils::FileContent, helpers::history_ref::HistoryRef};
+use crate::{diff::differ::ProjectDiff, fs::file_utils::FileContent, helpers::history_ref::HistoryRef, project::connection::ConnectionStats};
 
 /// Represents synchronization status for a project.
+#[derive(Debug, Clone, PartialEq)]
 pub enum SyncStatus {
     /// The server is disconnected, but we have no idea if we have extra changes.
     Unknown,
     /// The server is disconnected, and we know how many changes we haven't pushed.
     Disconnected(usize),
-    /// The server is currently syncing our changes.
-    Syncing,
+    /// The server is currently syncing our changes, this fast.
+    Syncing(ConnectionStats),
     /// The server is up to date with our changes, or the project is not started.
     UpToDate
 }
@@ -140,7 +142,9 @@ pub trait BranchViewModel {
 /// API surface for a Diff exposed to the UI.
 pub trait DiffViewModel {
 	/// Get the [DiffWrapper] containing the diff data.
-	fn get_diff(&self) -> &ProjectDiff;
+	fn get_diff(&self) -> Arc<ProjectDiff>;
 	/// Get the display title of the diff.
 	fn get_title(&self) -> &String;
+	/// Whether the diff is still being loaded. It's empty until then; `diff_loaded` is emitted once it's ready.
+	fn is_loading(&self) -> bool;
 }
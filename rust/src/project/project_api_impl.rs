@@ -1,4 +1,5 @@
 use std::collections::{HashMap, HashSet};
+use std::sync::Arc;
 
 use automerge::ChangeHash;
 use samod::DocumentId;
@@ -7,6 +8,7 @@ use crate::{
     diff::differ::ProjectDiff,
     fs::file_utils::FileContent,
     helpers::{
+        branch::Branch,
         history_ref::HistoryRef,
         utils::{
             BranchWrapper, CommitInfo, DiffWrapper, exact_human_readable_timestamp,
@@ -227,26 +229,17 @@ impl ProjectViewModel for Project {
             return SyncStatus::UpToDate;
         }
 
-        let Some((info, ref_)) =
-            self.with_driver_blocking("Print sync debug", |driver| async move {
-                let info = driver.as_ref()?.get_connection_info().await?;
-                let ref_ = driver
-                    .as_ref()?
-                    .get_branch_db()
-                    .get_checked_out_ref()
-                    .await?;
-                Some((info, ref_))
+        let Some((info, ref_, status, stats)) =
+            self.with_driver_blocking("Get sync status", |driver| async move {
+                let driver = driver.as_ref()?;
+                let info = driver.get_connection_info().await?;
+                let ref_ = driver.get_branch_db().get_checked_out_ref().await?;
+                let status = driver.get_peer_doc_state(ref_.branch()).await?;
+                Some((info, ref_, status, driver.get_connection_stats()))
             })
         else {
             return SyncStatus::Unknown;
         };
-
-        let Some(branch) = self.get_checked_out_branch_state() else {
-            return SyncStatus::Unknown;
-        };
-        let Some(status) = info.docs.get(&branch.id) else {
-            return SyncStatus::Unknown;
-        };
         let is_connected = info.last_received.is_some();
         if status
             .last_acked_heads
@@ -260,7 +253,7 @@ impl ProjectViewModel for Project {
         }
 
         if is_connected {
-            return SyncStatus::Syncing;
+            return SyncStatus::Syncing(stats);
         }
 
         let unsynced_count = self.changes.iter().filter(|(_hash, c)| !c.synced).count();
@@ -272,10 +265,18 @@ impl ProjectViewModel for Project {
         if !self.has_project() {
             return;
         }
+        let branch = self.get_checked_out_branch_state();
+        let branch_id = branch.as_ref().map(|branch| branch.id.clone());
         let info = self.with_driver_blocking("Print sync debug", |driver| async move {
-            driver.as_ref()?.get_connection_info().await
+            let driver = driver.as_ref()?;
+            let info = driver.get_connection_info().await?;
+            let status = match branch_id {
+                Some(id) => driver.get_peer_doc_state(&id).await,
+                None => None,
+            };
+            Some((info, status))
         });
-        let Some(info) = info else {
+        let Some((info, status)) = info else {
             tracing::debug!("Sync info UNAVAILABLE!!!");
             return;
         };
@@ -286,8 +287,8 @@ impl ProjectViewModel for Project {
         tracing::debug!("last received: {:?}", info.last_received);
         tracing::debug!("last sent: {:?}", info.last_sent);
 
-        if let Some(branch) = self.get_checked_out_branch_state() {
-            if let Some(status) = info.docs.get(&branch.id) {
+        if let Some(branch) = branch {
+            if let Some(status) = status {
                 tracing::debug!("\t{}:", branch.name);
                 tracing::debug!("\tacked heads: {:?}", status.last_acked_heads);
                 tracing::debug!("\tsent heads: {:?}", status.last_sent_heads);
@@ -374,21 +375,9 @@ impl ProjectViewModel for Project {
     }
 
     fn get_default_diff(&self) -> Option<impl DiffViewModel> {
-        let heads_before;
-
-        let (branch_state, heads_after) =
+        let (branch_state, before, after) =
             self.with_driver_blocking("Get default diff", |driver| async move {
-                let branch_db = driver.as_ref()?.get_branch_db();
-
-                let branch = branch_db.get_checked_out_ref().await?.branch().clone();
-
-                let state = branch_db.get_branch_state(&branch).await?;
-                let synced_heads = branch_db
-                    .get_latest_ref_on_branch(&branch)
-                    .await?
-                    .heads()
-                    .clone();
-                Some((state, synced_heads))
+                Project::get_default_diff_refs(&driver.as_ref()?.get_branch_db()).await
             })?;
 
         // There is no default diff for the main branch!
@@ -396,14 +385,6 @@ impl ProjectViewModel for Project {
             return None;
         }
 
-        if self.is_merge_preview_branch_active() {
-            heads_before = branch_state.merge_into.as_ref()?.heads();
-        }
-        // revert preview and regular branch both use forked_at
-        else {
-            heads_before = branch_state.forked_from.as_ref()?.heads();
-        }
-
         // generate the summary
         let title;
         if self.is_merge_preview_branch_active() {
@@ -419,7 +400,7 @@ impl ProjectViewModel for Project {
                 .get_branch(&branch_state.forked_from.as_ref()?.branch())?
                 .get_name();
             // assume reverted_to is always just 1 hash
-            let short_heads = &branch_state.reverted_to?.heads().first()?.to_string()[..7];
+            let short_heads = &branch_state.reverted_to.as_ref()?.heads().first()?.to_string()[..7];
             title = format!(
                 "Showing changes for {} reverted to {}",
                 source_name, short_heads
@@ -434,45 +415,49 @@ impl ProjectViewModel for Project {
             );
         }
 
-        let before = HistoryRef::new(branch_state.id.clone(), heads_before.clone());
-        let after = HistoryRef::new(branch_state.id.clone(), heads_after.clone());
+        let diff = self.get_cached_diff(before, after);
+
+        // From the default diff, the user is most likely to click on one of the latest commits.
+        if !self.is_merge_preview_branch_active() && !self.is_revert_preview_branch_active() {
+            let history = self.get_branch_history();
+            let latest = history
+                .iter()
+                .rev()
+                .take(PREFETCH_LATEST_COMMITS)
+                .filter_map(|hash| self.get_change_diff_refs(*hash, &history, &branch_state))
+                .collect();
+            self.prefetch_diffs(latest, false);
+        }
 
         Some(DiffWrapper {
-            diff: self.get_cached_diff(before, after),
+            loading: diff.is_none(),
+            diff: diff.unwrap_or_default(),
             title,
         })
     }
 
     fn get_diff(&self, selected_hash: ChangeHash) -> Option<impl DiffViewModel> {
         let change = self.changes.get(&selected_hash)?;
-        if change.is_setup() {
-            return None;
-        }
-        let heads_before;
-        let heads_after = vec![change.hash];
-
         let history = self.get_branch_history();
-        let mut prev_hash = None;
-        for (i, el) in history.iter().enumerate() {
-            if *el == selected_hash {
-                prev_hash = history.get(i - 1).copied();
-                break;
-            }
-        }
-
         let branch_state = self.get_checked_out_branch_state()?;
-
-        if let Some(prev_hash) = prev_hash {
-            heads_before = vec![prev_hash];
-        } else {
-            heads_before = branch_state.forked_from.as_ref()?.heads().clone();
+        let (before, after) = self.get_change_diff_refs(selected_hash, &history, &branch_state)?;
+        let diff = self.get_cached_diff(before, after);
+
+        // Users tend to step through history one commit at a time, so get the neighbours ready.
+        if let Some(index) = history.iter().position(|hash| *hash == selected_hash) {
+            let neighbours = [index.checked_sub(1), index.checked_add(1)]
+                .into_iter()
+                .flatten()
+                .filter_map(|i| history.get(i))
+                .filter_map(|hash| self.get_change_diff_refs(*hash, &history, &branch_state))
+                .collect();
+            // The default branch diff goes first: it's where the user lands when they leave history.
+            self.prefetch_diffs(neighbours, true);
         }
 
-        let before = HistoryRef::new(branch_state.id.clone(), heads_before);
-        let after = HistoryRef::new(branch_state.id.clone(), heads_after);
-
         Some(DiffWrapper {
-            diff: self.get_cached_diff(before, after),
+            loading: diff.is_none(),
+            diff: diff.unwrap_or_default(),
             title: format!(
                 "Showing changes from {} - {}",
                 change.get_summary(),
@@ -539,6 +524,40 @@ impl ProjectViewModel for Project {
     }
 }
 
+/// How many of the latest commits to prefetch diffs for when showing the default diff.
+const PREFETCH_LATEST_COMMITS: usize = 3;
+
+impl Project {
+    /// Returns the refs to diff for a single commit on the checked out branch: the commit against the one before it,
+    /// or against the fork point if it's the first commit on the branch.
+    fn get_change_diff_refs(
+        &self,
+        hash: ChangeHash,
+        history: &[ChangeHash],
+        branch_state: &Branch,
+    ) -> Option<(HistoryRef, HistoryRef)> {
+        let change = self.changes.get(&hash)?;
+        if change.is_setup() {
+            return None;
+        }
+
+        let prev_hash = history
+            .iter()
+            .position(|el| *el == hash)
+            .and_then(|i| i.checked_sub(1))
+            .and_then(|i| history.get(i));
+        let heads_before = match prev_hash {
+            Some(prev_hash) => vec![*prev_hash],
+            None => branch_state.forked_from.as_ref()?.heads().clone(),
+        };
+
+        Some((
+            HistoryRef::new(branch_state.id.clone(), heads_before),
+            HistoryRef::new(branch_state.id.clone(), vec![hash]),
+        ))
+    }
+}
+
 impl ChangeViewModel for CommitInfo {
     fn get_hash(&self) -> ChangeHash {
         self.hash
@@ -626,11 +645,15 @@ impl BranchViewModel for BranchWrapper {
 }
 
 impl DiffViewModel for DiffWrapper {
-    fn get_diff(&self) -> &ProjectDiff {
-        &self.diff
+    fn get_diff(&self) -> Arc<ProjectDiff> {
+        self.diff.clone()
     }
 
     fn get_title(&self) -> &String {
         &self.title
     }
+
+    fn is_loading(&self) -> bool {
+        self.loading
+    }
 }
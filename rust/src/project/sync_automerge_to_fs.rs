@@ -5,7 +5,7 @@ use tracing::instrument;
 
 use crate::{
     fs::file_utils::{FileContent, FileSystemEvent},
-    helpers::history_ref::HistoryRef,
+    helpers::{history_ref::HistoryRef, metrics::METRICS},
     project::branch_db::BranchDb,
 };
 
@@ -41,6 +41,8 @@ impl SyncAutomergeToFileSystem {
             "Our current ref is different than the requested ref. Attempting to checkout {:?}",
             goal_ref
         );
+        METRICS.checkouts.increment();
+        let _timer = METRICS.checkout_duration.start_timer();
 
         let Some(changes) = self
             .branch_db
@@ -77,6 +79,12 @@ impl SyncAutomergeToFileSystem {
             .into_iter()
             .filter_map(|(event, written)| written.then_some(event))
             .collect();
+        for event in &results {
+            match event {
+                FileSystemEvent::FileDeleted(_) => METRICS.files_deleted.increment(),
+                _ => METRICS.files_written.increment(),
+            }
+        }
 
         tracing::info!("Wrote {:?} files!", results.len());
 
@@ -100,6 +108,7 @@ impl SyncAutomergeToFileSystem {
                     "Skipping creating file {:?} because it already exists, and the hash is the same.",
                     path
                 );
+                METRICS.writes_skipped.increment();
                 return false;
             }
             tracing::warn!(
@@ -150,6 +159,7 @@ impl SyncAutomergeToFileSystem {
                 "Skipping writing file {:?} because the hash is the same.",
                 path
             );
+            METRICS.writes_skipped.increment();
             return false;
         }
 
@@ -1,14 +1,26 @@
-use std::{path::PathBuf, sync::Arc};
+use std::{mem, path::PathBuf, sync::{Arc, Mutex as StdMutex}};
 
 use futures::StreamExt;
+use indexmap::IndexMap;
+use samod::DocumentId;
 use tokio::{select, sync::Mutex, task::JoinSet};
 use tokio_util::sync::CancellationToken;
 use tracing::instrument;
 
 use crate::{
-    fs::file_utils::{FileContent, FileSystemEvent}, helpers::spawn_utils::spawn_named, project::{branch_db::BranchDb, fs_watcher::FileSystemWatcher}
+    fs::file_utils::{FileContent, FileSystemEvent}, helpers::{memory::{HeapSize, MemoryUsage}, metrics::METRICS, spawn_utils::spawn_named}, project::{branch_db::BranchDb, connection::ConnectionMonitor, fs_watcher::{FileHashes, FileSystemWatcher, file_hashes_memory_usage}}
 };
 
+/// Binary files bigger than this wait for room on the connection before they're committed.
+const LARGE_UPLOAD_BYTES: usize = 1024 * 1024;
+
+/// Large binary files waiting for room on the connection, with the branch they were saved on.
+#[derive(Debug, Default)]
+struct HeldBack {
+    branch: Option<DocumentId>,
+    changes: Vec<(String, FileContent)>,
+}
+
 /// Tracks changes using [FileSystemWatcher], handles the changes, and tracks them as pending.
 /// Call `commit` to commit them.
 #[derive(Debug)]
@@ -19,7 +31,14 @@ pub struct SyncFileSystemToAutomerge {
     // TODO (Lilith) Maybe do stream instead? This works for now though
     // Stream is good though because I ***think*** we can poll with now_or_never
     pending_changes: Arc<Mutex<Vec<(String, FileContent)>>>,
+    /// Large binary files held back from a commit. They only ever go to the branch they were saved on.
+    held_back: Mutex<HeldBack>,
+    /// The memory held by [Self::pending_changes] and [Self::held_back], kept up to date as changes come and go,
+    /// so measuring it doesn't need their locks.
+    pending_usage: Arc<StdMutex<MemoryUsage>>,
+    file_hashes: FileHashes,
     branch_db: BranchDb,
+    connection_monitor: Arc<ConnectionMonitor>,
     token: CancellationToken,
 }
 
@@ -30,11 +49,15 @@ impl Drop for SyncFileSystemToAutomerge {
 }
 
 impl SyncFileSystemToAutomerge {
-    pub fn new(branch_db: BranchDb) -> Self {
+    pub fn new(branch_db: BranchDb, connection_monitor: Arc<ConnectionMonitor>) -> Self {
         let pending_changes = Arc::new(Mutex::new(Vec::new()));
+        let pending_usage = Arc::new(StdMutex::new(MemoryUsage::default()));
         let token = CancellationToken::new();
 
+        let file_hashes = FileHashes::default();
+        let file_hashes_clone = file_hashes.clone();
         let pending_changes_clone = pending_changes.clone();
+        let pending_usage_clone = pending_usage.clone();
         let branch_db_clone = branch_db.clone();
         let token_clone = token.clone();
 
@@ -43,6 +66,7 @@ impl SyncFileSystemToAutomerge {
             let changes = FileSystemWatcher::start_watching(
                 branch_db_clone.get_project_dir().clone(),
                 branch_db_clone.clone(),
+                file_hashes_clone,
             )
             .await;
             tokio::pin!(changes);
@@ -56,10 +80,12 @@ impl SyncFileSystemToAutomerge {
                             FileSystemEvent::FileModified(path, content) => (path, content),
                             FileSystemEvent::FileDeleted(path) => (path, FileContent::Deleted),
                         };
-                        pending_changes_clone
-                            .lock()
-                            .await
-                            .push((branch_db_clone.localize_path(&path), content));
+                        let path = branch_db_clone.localize_path(&path);
+                        let size = path.len() + content.heap_size();
+                        let mut pending_changes = pending_changes_clone.lock().await;
+                        pending_changes.push((path, content));
+                        pending_usage_clone.lock().unwrap().add(size);
+                        METRICS.pending_fs_changes.set(pending_changes.len() as i64);
                     },
                     _ = token_clone.cancelled() => { break; }
                 }
@@ -68,22 +94,45 @@ impl SyncFileSystemToAutomerge {
 
         Self {
             pending_changes,
+            held_back: Mutex::new(HeldBack::default()),
+            pending_usage,
+            file_hashes,
             token,
             branch_db,
+            connection_monitor,
         }
     }
 
+    /// Returns the memory held by the filesystem watcher, and by the changes waiting to be committed.
+    pub async fn memory_usage(&self) -> (MemoryUsage, MemoryUsage) {
+        let watcher = file_hashes_memory_usage(&self.file_hashes).await;
+        let pending = *self.pending_usage.lock().unwrap();
+        (watcher, pending)
+    }
+
     /// Make a commit of all watched, pending changes from the filesystem to automerge.
-    /// Returns true on success.
+    /// Large binary files wait for room on the connection. Returns true on success.
     #[instrument(skip_all)]
     pub async fn commit(&self) -> bool {
+        self.commit_changes(false).await
+    }
+
+    /// Commits every pending change, held back files included, without waiting for room on the connection.
+    /// Held back files only live in memory, so this runs before shutdown to keep the user's saves.
+    #[instrument(skip_all)]
+    pub async fn flush(&self) -> bool {
+        self.commit_changes(true).await
+    }
+
+    async fn commit_changes(&self, ignore_backpressure: bool) -> bool {
         // Because we always change the checked out ref after committing, we need to lock this in write mode.
         let r = self.branch_db.get_checked_out_ref_mut();
         let mut checked_out_ref = r.write().await;
 
         let mut pending_changes = self.pending_changes.lock().await;
+        let mut held_back = self.held_back.lock().await;
 
-        if pending_changes.is_empty() {
+        if pending_changes.is_empty() && held_back.changes.is_empty() {
             return false;
         }
 
@@ -101,25 +150,121 @@ impl SyncFileSystemToAutomerge {
             return false;
         }
 
-        let new_ref = self
-            .branch_db
-            .commit_fs_changes(
-                pending_changes.clone(),
-                &checked_out_ref.as_ref().unwrap(),
-                None,
-                false,
-            )
-            .await;
-        if let Some(new_ref) = new_ref {
-            tracing::info!("Successfully made a commit! {:?}", new_ref);
-            pending_changes.clear();
-            *checked_out_ref = Some(new_ref);
-            return true;
-        } else {
+        // Files held back on another branch were saved there, so they must not land on this one.
+        let branch = checked_out_ref.as_ref().unwrap().branch().clone();
+        if held_back.branch.as_ref() != Some(&branch) {
+            self.flush_held_back(&mut held_back).await;
+            held_back.branch = Some(branch);
+        }
+
+        // Held back files go first, so newer changes to the same files win.
+        let mut changes = mem::take(&mut held_back.changes);
+        changes.append(&mut pending_changes);
+        let (small_changes, large_changes) =
+            self.take_ready_changes(changes, &mut held_back.changes, ignore_backpressure);
+        METRICS
+            .pending_fs_changes
+            .set(held_back.changes.len() as i64);
+        // Only held back binaries are left, so this is cheap.
+        let mut pending_usage = MemoryUsage::default();
+        for (path, content) in held_back.changes.iter() {
+            pending_usage.add(path.len() + content.heap_size());
+        }
+        *self.pending_usage.lock().unwrap() = pending_usage;
+
+        // Small changes are committed first, so they're sent ahead of the large files rather than queued behind them.
+        let mut committed = false;
+        for changes in [small_changes, large_changes] {
+            if changes.is_empty() {
+                continue;
+            }
+            let new_ref = self
+                .branch_db
+                .commit_fs_changes(changes, &checked_out_ref.as_ref().unwrap(), None, false)
+                .await;
+            if let Some(new_ref) = new_ref {
+                tracing::info!("Successfully made a commit! {:?}", new_ref);
+                *checked_out_ref = Some(new_ref);
+                committed = true;
+            }
+        }
+        if !committed {
             tracing::info!("Did not commit pending files!");
-            pending_changes.clear();
-            return false;
         }
+        return committed;
+    }
+
+    /// Commits files held back on a branch that's no longer checked out to that branch, without waiting for room on the
+    /// connection. Drops them if the branch is gone.
+    async fn flush_held_back(&self, held_back: &mut HeldBack) {
+        let changes = mem::take(&mut held_back.changes);
+        let Some(branch) = held_back.branch.take() else {
+            return;
+        };
+        if changes.is_empty() {
+            return;
+        }
+        let Some(ref_) = self.branch_db.get_latest_ref_on_branch(&branch).await else {
+            tracing::warn!(
+                "Dropping {} held back files, because their branch {:?} is gone",
+                changes.len(),
+                branch
+            );
+            return;
+        };
+        tracing::info!(
+            "Committing {} held back files to {:?} before leaving it",
+            changes.len(),
+            branch
+        );
+        if self
+            .branch_db
+            .commit_fs_changes(changes, &ref_, None, false)
+            .await
+            .is_none()
+        {
+            tracing::info!("Did not commit held back files!");
+        }
+    }
+
+    /// Splits changes into those ready to commit: every small change, and the large binary files the connection has
+    /// room for. Large files it doesn't have room for go to [held_back], so they don't crowd out the small ones.
+    /// With [ignore_backpressure], every large file is ready.
+    fn take_ready_changes(
+        &self,
+        changes: Vec<(String, FileContent)>,
+        held_back: &mut Vec<(String, FileContent)>,
+        ignore_backpressure: bool,
+    ) -> (Vec<(String, FileContent)>, Vec<(String, FileContent)>) {
+        // Keep only the latest change to each file, so a file that's held back can't overwrite a newer change to it later.
+        let latest: IndexMap<String, FileContent> = changes.into_iter().collect();
+        let mut small_changes = Vec::new();
+        let mut large_changes = Vec::new();
+        for (path, content) in latest {
+            let size = match &content {
+                FileContent::Binary(bytes) if bytes.len() > LARGE_UPLOAD_BYTES => bytes.len(),
+                _ => {
+                    small_changes.push((path, content));
+                    continue;
+                }
+            };
+            if ignore_backpressure
+                || self
+                    .connection_monitor
+                    .try_reserve(size as u64, large_changes.is_empty())
+            {
+                large_changes.push((path, content));
+            } else {
+                held_back.push((path, content));
+            }
+        }
+        if !held_back.is_empty() {
+            tracing::debug!(
+                "Holding back {} large files until the connection catches up",
+                held_back.len()
+            );
+        }
+        (small_changes, large_changes)
     }
 
     /// Make an initial commit of ALL files from the filesystem to automerge.
@@ -0,0 +1,189 @@
+use std::collections::{HashMap, HashSet};
+
+use automerge::ChangeHash;
+use samod::DocumentId;
+
+use crate::{
+    helpers::{branch::Branch, utils::BranchWrapper},
+    project::{
+        project::Project,
+        project_api::{BranchViewModel, ProjectViewModel, SyncStatus},
+    },
+};
+
+/// A branch as the UI shows it.
+#[derive(Debug, Clone, PartialEq)]
+pub struct UiBranch {
+    pub branch: BranchWrapper,
+    pub is_loaded: bool,
+}
+
+/// The parts of the project the UI shows, as of one [Project::process] call.
+/// Consecutive states are diffed into a [UiStateDelta], so the UI only has to touch what changed.
+#[derive(Debug, Default)]
+pub struct UiState {
+    /// Bumped every time the state is refreshed.
+    pub version: u64,
+    pub main_branch: Option<DocumentId>,
+    pub branches: HashMap<DocumentId, UiBranch>,
+    history: Vec<ChangeHash>,
+    /// The summary and sync state of each change in [Self::history], which is what the history list shows.
+    changes: HashMap<ChangeHash, (String, bool)>,
+    sync_status: Option<SyncStatus>,
+}
+
+/// What changed between two versions of the [UiState].
+#[derive(Debug, Default)]
+pub struct UiStateDelta {
+    pub from_version: u64,
+    pub to_version: u64,
+    pub main_branch: Option<DocumentId>,
+    pub main_branch_changed: bool,
+    pub branches_added: Vec<DocumentId>,
+    pub branches_updated: Vec<DocumentId>,
+    pub branches_removed: Vec<DocumentId>,
+    /// The new history doesn't start with the old one, e.g. after a checkout, so it has to be shown from scratch.
+    pub history_reset: bool,
+    /// Changes appended to the history, oldest first.
+    pub changes_appended: Vec<ChangeHash>,
+    /// Changes already in the history whose summary or sync state changed.
+    pub changes_updated: Vec<ChangeHash>,
+    /// The new sync status, if it changed.
+    pub sync_status: Option<SyncStatus>,
+}
+
+impl UiStateDelta {
+    pub fn is_empty(&self) -> bool {
+        !self.main_branch_changed
+            && self.branches_added.is_empty()
+            && self.branches_updated.is_empty()
+            && self.branches_removed.is_empty()
+            && !self.history_reset
+            && self.changes_appended.is_empty()
+            && self.changes_updated.is_empty()
+            && self.sync_status.is_none()
+    }
+}
+
+impl UiState {
+    /// Replaces this state with the next one, and returns what changed.
+    fn advance(&mut self, next: UiState) -> UiStateDelta {
+        let mut delta = UiStateDelta {
+            from_version: self.version,
+            to_version: self.version + 1,
+            main_branch: next.main_branch.clone(),
+            main_branch_changed: next.main_branch != self.main_branch,
+            ..Default::default()
+        };
+
+        for (id, branch) in &next.branches {
+            match self.branches.get(id) {
+                None => delta.branches_added.push(id.clone()),
+                Some(old) if old != branch => delta.branches_updated.push(id.clone()),
+                Some(_) => {}
+            }
+        }
+        delta.branches_removed = self
+            .branches
+            .keys()
+            .filter(|id| !next.branches.contains_key(*id))
+            .cloned()
+            .collect();
+
+        if next.history.starts_with(&self.history) {
+            delta.changes_appended = next.history[self.history.len()..].to_vec();
+            delta.changes_updated = self
+                .history
+                .iter()
+                .filter(|hash| self.changes.get(hash) != next.changes.get(hash))
+                .cloned()
+                .collect();
+        } else {
+            delta.history_reset = true;
+        }
+
+        if next.sync_status != self.sync_status {
+            delta.sync_status = next.sync_status.clone();
+        }
+
+        // Nothing to show, so keep the version and the UI stays in step without hearing about it.
+        if delta.is_empty() {
+            delta.to_version = delta.from_version;
+        }
+        *self = UiState {
+            version: delta.to_version,
+            ..next
+        };
+        delta
+    }
+}
+
+impl Project {
+    pub fn get_ui_state(&self) -> &UiState {
+        &self.ui_state
+    }
+
+    /// Reads the current [UiState], advances [Project::ui_state] to it, and returns what changed.
+    pub(super) fn refresh_ui_state(&mut self) -> UiStateDelta {
+        let (main_branch, states) =
+            self.with_driver_blocking("Read UI state", |driver| async move {
+                let Some(driver) = driver.as_ref() else {
+                    return (None, Vec::new());
+                };
+                let main_branch = driver.get_main_branch().await;
+                let branch_db = driver.get_branch_db();
+                let mut states = Vec::new();
+                for state in branch_db.get_branch_states().await {
+                    let is_loaded = branch_db.is_branch_loaded(&state.id).await;
+                    states.push((state, is_loaded));
+                }
+                (main_branch, states)
+            });
+
+        let history = self.history.clone().unwrap_or_default();
+        let changes = history
+            .iter()
+            .filter_map(|hash| {
+                let change = self.changes.get(hash)?;
+                Some((*hash, (change.summary.clone(), change.synced)))
+            })
+            .collect();
+        let next = UiState {
+            version: 0,
+            main_branch,
+            branches: ui_branches(states),
+            history,
+            changes,
+            sync_status: Some(self.get_sync_status()),
+        };
+        self.ui_state.advance(next)
+    }
+}
+
+/// Builds the branch tree from the flat list of branch states, with children sorted by name like [Project::get_branch].
+fn ui_branches(states: Vec<(Branch, bool)>) -> HashMap<DocumentId, UiBranch> {
+    let ids: HashSet<DocumentId> = states.iter().map(|(state, _)| state.id.clone()).collect();
+    let mut children: HashMap<DocumentId, Vec<(String, DocumentId)>> = HashMap::new();
+    for (state, _) in &states {
+        if let Some(forked_from) = &state.forked_from
+            && ids.contains(forked_from.branch())
+        {
+            children
+                .entry(forked_from.branch().clone())
+                .or_default()
+                .push((state.name.to_lowercase(), state.id.clone()));
+        }
+    }
+    states
+        .into_iter()
+        .map(|(state, is_loaded)| {
+            let mut branch_children = children.remove(&state.id).unwrap_or_default();
+            branch_children.sort_by(|a, b| a.0.cmp(&b.0));
+            let branch = BranchWrapper {
+                state,
+                children: branch_children.into_iter().map(|(_, id)| id).collect(),
+            };
+            (branch.get_id(), UiBranch { branch, is_loaded })
+        })
+        .collect()
+}